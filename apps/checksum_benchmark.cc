@@ -0,0 +1,89 @@
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+using Kernel = InternetChecksum::Kernel;
+
+constexpr size_t total_bytes = size_t{1} << 30;  // summed per kernel and size
+
+const vector<size_t> sizes = {20, 64, 576, 1500, 65536};
+
+//! Checksum `total_bytes` in pieces of `size` bytes
+//! \returns Gbit/s, and (through `result`) a combination of the checksums
+double run(const string &data, const size_t size, uint64_t &result) {
+    const size_t repetitions = total_bytes / size;
+
+    const auto first_time = high_resolution_clock::now();
+    for (size_t i = 0; i < repetitions; i++) {
+        InternetChecksum check;
+        check.add(string_view(data).substr(i % 2, size));  // half unaligned
+        result += check.value();
+    }
+    const auto final_time = high_resolution_clock::now();
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    return repetitions * size * 8.0 / double(duration);
+}
+
+void program_body() {
+    const vector<pair<string, Kernel>> kernels = {{"bytewise", Kernel::Bytewise},
+                                                  {"word", Kernel::Word},
+                                                  {"sse4", Kernel::SSE4},
+                                                  {"avx2", Kernel::AVX2}};
+
+    auto rd = get_random_generator();
+    string data(sizes.back() + 1, 0);
+    for (auto &c : data) {
+        c = char(rd());
+    }
+
+    cout << "CS144 Internet checksum benchmark: " << (total_bytes >> 20)
+         << " MiB per kernel and size\n";
+    cout << "  kernel";
+    for (const auto size : sizes) {
+        cout << setw(10) << size << " B";
+    }
+    cout << "   (Gbit/s)\n";
+
+    uint64_t expected = 0;
+    for (const auto &[name, kernel] : kernels) {
+        if (not InternetChecksum::supported(kernel)) {
+            cout << setw(8) << name << "   (not supported by this CPU)\n";
+            continue;
+        }
+        InternetChecksum::use_kernel(kernel);
+
+        cout << fixed << setprecision(2) << setw(8) << name;
+        uint64_t result = 0;
+        for (const auto size : sizes) {
+            cout << setw(12) << run(data, size, result) << flush;
+        }
+        cout << "\n";
+
+        if (kernel == Kernel::Bytewise) {
+            expected = result;
+        } else if (result != expected) {
+            throw runtime_error(name + ": checksums differ from the bytewise kernel's");
+        }
+    }
+}
+
+int main() {
+    try {
+        program_body();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include "ethernet_frame.hh"
+#include "packet_builder.hh"
+#include "tcp_over_ip.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/uio.h>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t payload_size = 1000;  // a full TCPSegment, as TCPConfig::MAX_PAYLOAD_SIZE
+constexpr size_t n_packets = 2'000'000;
+
+//! Calls to operator new so far, to count allocations per packet
+static size_t allocations = 0;
+
+void *operator new(const size_t size) {
+    allocations++;
+    void *ret = malloc(size);
+    if (ret == nullptr) {
+        throw bad_alloc();
+    }
+    return ret;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+//! Wrap the segment in an IPv4 datagram and an Ethernet frame, serialized as BufferLists
+size_t serialize_lists(TCPSegment &seg,
+                       const FourTuple &id,
+                       EthernetFrame &frame,
+                       PacketBuilder &) {
+    frame.payload() = TCPOverIPv4Adapter::wrap_tcp_in_ip(seg, id).serialize();
+    const BufferList serialized = frame.serialize();
+    return BufferViewList(serialized).as_iovecs().size();
+}
+
+//! Build the same frame in one PacketBuilder
+size_t build_in_place(TCPSegment &seg,
+                      const FourTuple &id,
+                      EthernetFrame &frame,
+                      PacketBuilder &packet) {
+    TCPOverIPv4Adapter::wrap_tcp_in_ip(seg, id, packet);
+    frame.serialize(packet);
+    const Buffer built = packet.release();
+    return BufferViewList(built.str()).as_iovecs().size();
+}
+
+template <typename SerializeT>
+void run(const string &name, const SerializeT &serialize) {
+    TCPSegment seg;
+    seg.header().ack = true;
+    seg.set_payload(Buffer{string(payload_size, 'x')});
+    const FourTuple id{0x0a000001, 0x0a000002, 1234, 80};
+    EthernetFrame frame;
+    frame.header().type = EthernetHeader::TYPE_IPv4;
+    PacketBuilder packet;
+
+    size_t iovecs = 0;
+    const size_t first_allocations = allocations;
+    const auto first_time = high_resolution_clock::now();
+    for (size_t i = 0; i < n_packets; i++) {
+        seg.header().seqno = WrappingInt32{uint32_t(i * payload_size)};
+        iovecs += serialize(seg, id, frame, packet);
+    }
+    const auto final_time = high_resolution_clock::now();
+    const size_t n_allocations = allocations - first_allocations;
+
+    if (iovecs == 0) {
+        throw runtime_error(name + ": nothing serialized");
+    }
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    cout << fixed << setprecision(2);
+    cout << setw(7) << name << "   " << setw(8) << double(duration) / n_packets << " ns/packet   "
+         << setw(6) << double(n_allocations) / n_packets << " allocations/packet   " << setw(4)
+         << double(iovecs) / n_packets << " iovecs/packet\n";
+}
+
+void program_body() {
+    cout << "CS144 packet serialization benchmark: " << n_packets << " TCP/IPv4/Ethernet frames of "
+         << payload_size << "-byte segments\n";
+    run("lists", serialize_lists);
+    run("builder", build_in_place);
+}
+
+int main() {
+    try {
+        program_body();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#include "prefix_table.hh"
+#include "router.hh"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_prefixes = 1'000'000;
+constexpr size_t n_lookups = 20'000'000;
+constexpr size_t n_scans = 200;  // lookups by linear scan, as the Router used to do them
+constexpr size_t n_updates = 100'000;
+constexpr size_t n_churn_readers = 2;
+constexpr auto churn_time = seconds{1};
+
+struct Prefix {
+    uint32_t address;
+    uint8_t length;
+};
+
+uint32_t mask(const uint8_t length) { return length == 0 ? 0 : ~0U << (32 - length); }
+
+//! A table shaped like a full BGP table: most prefixes are /24s, and few are shorter than /16
+vector<Prefix> synthetic_table() {
+    // {length, thousandths of the prefixes}
+    constexpr array<pair<uint8_t, unsigned>, 12> shape{{{8, 0},
+                                                        {12, 1},
+                                                        {16, 15},
+                                                        {18, 20},
+                                                        {19, 30},
+                                                        {20, 50},
+                                                        {21, 55},
+                                                        {22, 100},
+                                                        {23, 100},
+                                                        {24, 600},
+                                                        {28, 15},
+                                                        {32, 14}}};
+    mt19937 rd{144};
+    vector<Prefix> ret;
+    ret.reserve(n_prefixes);
+    for (size_t i = 0; i < 16; i++) {
+        ret.push_back({static_cast<uint32_t>(rd()) & mask(8), 8});
+    }
+    for (const auto &[length, thousandths] : shape) {
+        for (size_t i = 0; i < n_prefixes * thousandths / 1000; i++) {
+            ret.push_back({static_cast<uint32_t>(rd()) & mask(length), length});
+        }
+    }
+    shuffle(ret.begin(), ret.end(), rd);
+    return ret;
+}
+
+template <typename T>
+double ns_since(const T &start, const size_t count) {
+    return double(duration_cast<nanoseconds>(high_resolution_clock::now() - start).count()) /
+           double(count);
+}
+
+void program_body() {
+    const auto prefixes = synthetic_table();
+    cout << "CS144 longest-prefix-match benchmark: " << prefixes.size() << " prefixes\n";
+    cout << fixed << setprecision(1);
+
+    // the Router builds its table through add_route()
+    {
+        Router router{Router::DEFAULT_BURST_SIZE, PrefixTable::FULL_TABLE_CHUNKS};
+        auto *const log = cerr.rdbuf(nullptr);  // add_route() prints every route
+        const auto start = high_resolution_clock::now();
+        for (const auto &prefix : prefixes) {
+            router.add_route(prefix.address, prefix.length, {}, 0);
+        }
+        const double ns = ns_since(start, prefixes.size());
+        cerr.rdbuf(log);
+        cout << "  Router::add_route     " << setw(10) << ns << " ns/route\n";
+    }
+
+    PrefixTable table{PrefixTable::FULL_TABLE_CHUNKS};
+    {
+        const auto start = high_resolution_clock::now();
+        for (size_t i = 0; i < prefixes.size(); i++) {
+            table.insert(prefixes[i].address, prefixes[i].length, i);
+        }
+        table.publish();
+        cout << "  PrefixTable::insert   " << setw(10) << ns_since(start, prefixes.size())
+             << " ns/route\n";
+    }
+    cout << "  table size            " << setw(10) << double(table.bytes()) / double(1 << 20)
+         << " MiB\n";
+
+    mt19937 rd{2021};
+    vector<uint32_t> addresses(1 << 16);
+    for (auto &address : addresses) {
+        address = rd();
+    }
+
+    {
+        size_t found = 0;
+        const auto start = high_resolution_clock::now();
+        for (size_t i = 0; i < n_lookups; i++) {
+            found += table.lookup(addresses[i % addresses.size()]).has_value();
+        }
+        const double ns = ns_since(start, n_lookups);
+        cout << "  PrefixTable::lookup   " << setw(10) << ns << " ns/lookup   ("
+             << 100.0 * double(found) / double(n_lookups) << "% matched)\n";
+    }
+
+    {
+        const auto start = high_resolution_clock::now();
+        for (size_t i = 0; i < n_scans; i++) {
+            const uint32_t address = addresses[i];
+            int best = -1;
+            size_t best_index = 0;
+            for (size_t j = 0; j < prefixes.size(); j++) {
+                if (((address ^ prefixes[j].address) & mask(prefixes[j].length)) == 0 and
+                    prefixes[j].length >= best) {
+                    best = prefixes[j].length;
+                    best_index = j;
+                }
+            }
+            if (table.lookup(address) != (best < 0 ? optional<uint32_t>{} : best_index)) {
+                throw runtime_error("PrefixTable disagrees with linear scan");
+            }
+        }
+        cout << "  linear scan           " << setw(10) << ns_since(start, n_scans)
+             << " ns/lookup\n";
+    }
+
+    // readers on other threads, while the writer replaces /24s as fast as it can
+    {
+        vector<Prefix> churned;
+        copy_if(prefixes.begin(), prefixes.end(), back_inserter(churned), [](const auto &prefix) {
+            return prefix.length == 24;
+        });
+        size_t updates = 0;
+        const auto update = [&] {
+            const auto &prefix = churned[(updates * 7919) % churned.size()];
+            table.erase(prefix.address, prefix.length);
+            table.insert(prefix.address, prefix.length, updates % PrefixTable::MAX_VALUE);
+            table.publish();
+            updates++;
+        };
+        {
+            const auto start = high_resolution_clock::now();
+            while (updates < n_updates) {
+                update();
+            }
+            const double ns = ns_since(start, n_updates);
+            cout << "  erase+insert+publish  " << setw(10) << ns << " ns/update   (no readers)\n";
+        }
+
+        atomic<bool> stop{false};
+        atomic<size_t> lookups{0};
+        vector<thread> readers;
+        for (size_t i = 0; i < n_churn_readers; i++) {
+            readers.emplace_back([&, offset = i * 4096] {
+                EpochDomain::Reader reader{table.epochs()};
+                size_t found = 0, count = 0;
+                while (not stop) {
+                    const EpochDomain::Guard guard{reader};
+                    const auto snapshot = table.snapshot();
+                    for (size_t j = 0; j < 256; j++) {
+                        found += snapshot.lookup(addresses[(offset + count++) % addresses.size()])
+                                     .has_value();
+                    }
+                }
+                lookups += count + found % 2;  // use `found`, so the lookups are not optimized out
+            });
+        }
+
+        updates = 0;
+        const auto start = high_resolution_clock::now();
+        while (high_resolution_clock::now() - start < churn_time) {
+            update();
+        }
+        const double update_ns = ns_since(start, updates);
+        stop = true;
+        for (auto &reader : readers) {
+            reader.join();
+        }
+        const double lookup_ns = ns_since(start, lookups / n_churn_readers);
+        cout << "  during churn          " << setw(10) << update_ns << " ns/update   "
+             << lookup_ns << " ns/lookup on each of " << n_churn_readers << " readers\n";
+    }
+}
+
+int main() {
+    try {
+        program_body();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+#include "arp_message.hh"
+#include "router.hh"
+#include "sharded_router.hh"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_interfaces = 4;  // datagrams come in on the first (or all, for ShardedRouter)
+constexpr size_t n_routes = 100'000;
+constexpr size_t n_destinations = 65'536;
+constexpr size_t few_flows = 256;  // long-lived flows, which the flow cache should catch
+constexpr size_t arrivals = 256;  // datagrams that arrive between calls to route()
+constexpr size_t n_datagrams = arrivals * 8'000;
+constexpr size_t payload_size = 64;
+constexpr array<size_t, 5> burst_sizes{1, 8, 32, 64, 256};
+
+EthernetAddress interface_ethernet_address(const size_t n) {
+    return {0x02, 0, 0, 0, 0, static_cast<uint8_t>(n)};
+}
+
+EthernetAddress next_hop_ethernet_address(const size_t n) {
+    return {0x02, 0, 0, 0, 1, static_cast<uint8_t>(n)};
+}
+
+uint32_t interface_ip(const size_t n) { return 0x0a000001 | static_cast<uint32_t>(n) << 16; }
+
+uint32_t next_hop_ip(const size_t n) { return 0x0a000002 | static_cast<uint32_t>(n) << 16; }
+
+//! Routes to random prefixes through the next hops, and a default route through the last one
+vector<Router::Route> synthetic_routes() {
+    mt19937 rd{144};
+    vector<Router::Route> ret;
+    ret.reserve(n_routes + 1);
+    for (size_t i = 0; i < n_routes; i++) {
+        const uint8_t length = uniform_int_distribution<int>{16, 24}(rd);
+        const size_t out = 1 + rd() % (n_interfaces - 1);
+        const uint32_t prefix = static_cast<uint32_t>(rd()) & (~0U << (32 - length));
+        ret.push_back({prefix, length, Address::from_ipv4_numeric(next_hop_ip(out)), out});
+    }
+    const size_t last = n_interfaces - 1;
+    ret.push_back({0, 0, Address::from_ipv4_numeric(next_hop_ip(last)), last});
+    return ret;
+}
+
+vector<InternetDatagram> synthetic_traffic() {
+    mt19937 rd{2021};
+    vector<InternetDatagram> ret;
+    ret.reserve(n_destinations);
+    for (size_t i = 0; i < n_destinations; i++) {
+        InternetDatagram dgram;
+        dgram.header().src = 0xc0a80001;
+        dgram.header().dst = rd();
+        dgram.header().len = IPv4Header::LENGTH + payload_size;
+        dgram.payload() = string(payload_size, 'x');
+        ret.push_back(dgram);
+    }
+    return ret;
+}
+
+//! The datagram in a frame to interface `n`
+EthernetFrame datagram_frame(const size_t n, const InternetDatagram &dgram) {
+    EthernetFrame frame;
+    frame.header().src = next_hop_ethernet_address(n);
+    frame.header().dst = interface_ethernet_address(n);
+    frame.header().type = EthernetHeader::TYPE_IPv4;
+    frame.payload() = dgram.serialize().concatenate();
+    return frame;
+}
+
+//! An ARP reply from next hop `n`, so that interface `n` knows its Ethernet address
+EthernetFrame arp_reply(const size_t n) {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = next_hop_ethernet_address(n);
+    arp.sender_ip_address = next_hop_ip(n);
+    arp.target_ethernet_address = interface_ethernet_address(n);
+    arp.target_ip_address = interface_ip(n);
+
+    EthernetFrame frame;
+    frame.header().src = next_hop_ethernet_address(n);
+    frame.header().dst = interface_ethernet_address(n);
+    frame.header().type = EthernetHeader::TYPE_ARP;
+    frame.payload() = arp.serialize();
+    return frame;
+}
+
+//! Route `n_datagrams` to the first `n_flows` destinations of `traffic` through a Router
+void route_traffic(const vector<Router::Route> &routes,
+                   const vector<InternetDatagram> &traffic,
+                   const size_t burst_size,
+                   const size_t n_flows) {
+    Router router{burst_size, PrefixTable::FULL_TABLE_CHUNKS};
+    auto *const log = cerr.rdbuf(nullptr);  // interfaces print their addresses
+    for (size_t n = 0; n < n_interfaces; n++) {
+        router.add_interface(
+            {interface_ethernet_address(n), Address::from_ipv4_numeric(interface_ip(n))});
+        router.interface(n).recv_frame(arp_reply(n));
+        router.interface(n).frames_out() = {};
+    }
+    cerr.rdbuf(log);
+    router.replace_routes(routes);
+
+    size_t forwarded = 0;
+    auto &in = router.interface(0).datagrams_out();
+    const auto start = high_resolution_clock::now();
+    for (size_t sent = 0; sent < n_datagrams; sent += arrivals) {
+        for (size_t i = 0; i < arrivals; i++) {
+            in.push(traffic[(sent + i) % n_flows]);
+        }
+        router.route();
+        for (size_t n = 1; n < n_interfaces; n++) {
+            auto &out = router.interface(n).frames_out();
+            forwarded += out.size();
+            out = {};
+        }
+    }
+    const double seconds = duration<double>(high_resolution_clock::now() - start).count();
+
+    if (forwarded != n_datagrams) {
+        throw runtime_error("router forwarded " + to_string(forwarded) + " of " +
+                            to_string(n_datagrams) + " datagrams");
+    }
+    cout << "  Router, burst " << setw(3) << burst_size << ", " << setw(5) << n_flows
+         << " flows  " << setw(8) << double(n_datagrams) / seconds / 1e6 << " Mpps  " << setw(8)
+         << seconds * 1e9 / double(n_datagrams) << " ns/datagram  (flow cache hits "
+         << setw(6) << 100.0 * double(router.flow_cache_hits()) / double(n_datagrams) << "%)\n";
+}
+
+void program_body() {
+    const auto routes = synthetic_routes();
+    const auto traffic = synthetic_traffic();
+    cout << "CS144 router benchmark: " << routes.size() << " routes, " << n_destinations
+         << " destinations, " << payload_size << "-byte payloads\n";
+    cout << fixed << setprecision(2);
+
+    for (const size_t burst_size : burst_sizes) {
+        route_traffic(routes, traffic, burst_size, traffic.size());
+    }
+    route_traffic(routes, traffic, Router::DEFAULT_BURST_SIZE, few_flows);
+
+    // the same traffic through a ShardedRouter, arriving on every interface from one thread
+    {
+        atomic<size_t> forwarded{0};
+        ShardedRouter router{[&](const size_t, ShardedRouter::Frames &frames) {
+                                 for (const auto &frame : frames) {
+                                     forwarded += frame.header().type == EthernetHeader::TYPE_IPv4;
+                                 }
+                             },
+                             PrefixTable::FULL_TABLE_CHUNKS};
+        auto *const log = cerr.rdbuf(nullptr);
+        for (size_t n = 0; n < n_interfaces; n++) {
+            router.add_interface(
+                {interface_ethernet_address(n), Address::from_ipv4_numeric(interface_ip(n))});
+        }
+        cerr.rdbuf(log);
+        router.replace_routes(routes);
+        router.start();
+        for (size_t n = 0; n < n_interfaces; n++) {
+            router.deliver(n, arp_reply(n));
+        }
+
+        vector<EthernetFrame> frames;
+        frames.reserve(traffic.size());
+        for (size_t i = 0; i < traffic.size(); i++) {
+            frames.push_back(datagram_frame(i % n_interfaces, traffic[i]));
+        }
+
+        const auto start = high_resolution_clock::now();
+        for (size_t sent = 0; sent < n_datagrams; sent++) {
+            const size_t i = sent % frames.size();
+            EthernetFrame frame = frames[i];
+            while (not router.deliver(i % n_interfaces, move(frame))) {
+                this_thread::yield();
+            }
+        }
+        const auto give_up = high_resolution_clock::now() + seconds{10};
+        while (forwarded < n_datagrams and high_resolution_clock::now() < give_up) {
+            this_thread::yield();
+        }
+        const double elapsed = duration<double>(high_resolution_clock::now() - start).count();
+        router.stop();
+
+        if (forwarded != n_datagrams) {
+            throw runtime_error("sharded router forwarded " + to_string(forwarded) + " of " +
+                                to_string(n_datagrams) + " datagrams");
+        }
+        cout << "  ShardedRouter, " << n_interfaces << " workers " << setw(8)
+             << double(n_datagrams) / elapsed / 1e6 << " Mpps  " << setw(8)
+             << elapsed * 1e9 / double(n_datagrams) << " ns/datagram\n";
+    }
+}
+
+int main() {
+    try {
+        program_body();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
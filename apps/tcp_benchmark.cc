@@ -15,9 +15,8 @@ void move_segments(TCPConnection &x,
                    TCPConnection &y,
                    vector<TCPSegment> &segments,
                    const bool reorder) {
-    while (not x.segments_out().empty()) {
-        segments.emplace_back(move(x.segments_out().front()));
-        x.segments_out().pop();
+    for (auto &seg : x.segments_out().drain()) {
+        segments.emplace_back(move(seg));
     }
     if (reorder) {
         for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
@@ -102,6 +101,13 @@ void main_loop(const bool reorder) {
     cout << "CPU-limited throughput" << (reorder ? " with reordering: " : "                : ")
          << gigabits_per_second << " Gbit/s\n";
 
+    for (const auto &[name, conn] : {make_pair("sender", &x), make_pair("receiver", &y)}) {
+        const auto fast = conn->fast_path_segments();
+        const auto total = fast + conn->slow_path_segments();
+        cout << "    header prediction (" << name << "): " << fast << " of " << total
+             << " segments on fast path (" << (total ? 100.0 * fast / total : 0.0) << "%)\n";
+    }
+
     while (x.active() or y.active()) {
         loop();
     }
@@ -35,7 +35,9 @@ static void show_usage(const char *argv0, const char *msg) {
          << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
          << "   -d <tapdev>     Connect to tap <tapdev>                         " << TAP_DFLT
-         << "\n\n"
+         << "\n"
+         << "   -r <iface>      Use a packet ring on Ethernet interface <iface> instead\n"
+         << "                   of a tap (e.g. one end of a veth pair)\n\n"
 
          << "   -h              Show this message.\n\n";
 
@@ -52,10 +54,12 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
     }
 }
 
-static tuple<TCPConfig, FdAdapterConfig, Address, string> get_config(int argc, char **argv) {
+static tuple<TCPConfig, FdAdapterConfig, Address, string, string> get_config(int argc,
+                                                                            char **argv) {
     TCPConfig c_fsm{};
     FdAdapterConfig c_filt{};
     string tapdev = TAP_DFLT;
+    string ring_interface;
 
     int curr = 1;
 
@@ -94,6 +98,11 @@ static tuple<TCPConfig, FdAdapterConfig, Address, string> get_config(int argc, c
             tapdev = argv[curr + 1];
             curr += 2;
 
+        } else if (strncmp("-r", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -r requires one argument.");
+            ring_interface = argv[curr + 1];
+            curr += 2;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -110,7 +119,15 @@ static tuple<TCPConfig, FdAdapterConfig, Address, string> get_config(int argc, c
 
     Address next_hop{next_hop_address, "0"};
 
-    return make_tuple(c_fsm, c_filt, next_hop, tapdev);
+    return make_tuple(c_fsm, c_filt, next_hop, tapdev, ring_interface);
+}
+
+template <typename SocketT>
+static void run(SocketT &tcp_socket, const TCPConfig &c_fsm, const FdAdapterConfig &c_filt) {
+    tcp_socket.connect(c_fsm, c_filt);
+
+    bidirectional_stream_copy(tcp_socket);
+    tcp_socket.wait_until_closed();
 }
 
 int main(int argc, char **argv) {
@@ -130,16 +147,18 @@ int main(int argc, char **argv) {
             0x02;  // "10" in last two binary digits marks a private Ethernet address
         local_ethernet_address.at(0) &= 0xfe;
 
-        auto [c_fsm, c_filt, next_hop, tap_dev_name] = get_config(argc, argv);
-
-        TCPOverIPv4OverEthernetSpongeSocket tcp_socket(
-            TCPOverIPv4OverEthernetAdapter(TCPOverIPv4OverEthernetAdapter(
-                TapFD(tap_dev_name), local_ethernet_address, c_filt.source, next_hop)));
-
-        tcp_socket.connect(c_fsm, c_filt);
+        auto [c_fsm, c_filt, next_hop, tap_dev_name, ring_interface] = get_config(argc, argv);
 
-        bidirectional_stream_copy(tcp_socket);
-        tcp_socket.wait_until_closed();
+        if (not ring_interface.empty()) {
+            TCPOverIPv4OverPacketRingSpongeSocket tcp_socket(TCPOverIPv4OverPacketRingAdapter(
+                PacketRing(ring_interface), local_ethernet_address, c_filt.source, next_hop));
+            run(tcp_socket, c_fsm, c_filt);
+        } else {
+            TCPOverIPv4OverEthernetSpongeSocket tcp_socket(
+                TCPOverIPv4OverEthernetAdapter(TCPOverIPv4OverEthernetAdapter(
+                    TapFD(tap_dev_name), local_ethernet_address, c_filt.source, next_hop)));
+            run(tcp_socket, c_fsm, c_filt);
+        }
     } catch (const exception &e) {
         cerr << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
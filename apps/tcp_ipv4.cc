@@ -40,6 +40,9 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+         << "   -o              Offload checksums and segmentation to the       (no offload)\n"
+         << "                   kernel (IFF_VNET_HDR); ignores -Lu and -Ld.\n\n"
+
          << "   -h              Show this message.\n\n";
 
     if (msg != nullptr) {
@@ -55,13 +58,14 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
     }
 }
 
-static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char **argv) {
+static tuple<TCPConfig, FdAdapterConfig, bool, char *, bool> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
     FdAdapterConfig c_filt{};
     char *tundev = nullptr;
 
     int curr = 1;
     bool listen = false;
+    bool offload = false;
 
     string source_address = LOCAL_ADDRESS_DFLT;
     string source_port = to_string(uint16_t(random_device()()));
@@ -112,6 +116,10 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
                 static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-o", argv[curr], 3) == 0) {
+            offload = true;
+            curr += 1;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -134,7 +142,22 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
         c_filt.source = {source_address, source_port};
     }
 
-    return make_tuple(c_fsm, c_filt, listen, tundev);
+    return make_tuple(c_fsm, c_filt, listen, tundev, offload);
+}
+
+template <typename SocketT>
+static void run(SocketT &tcp_socket,
+                const TCPConfig &c_fsm,
+                const FdAdapterConfig &c_filt,
+                const bool listen) {
+    if (listen) {
+        tcp_socket.listen_and_accept(c_fsm, c_filt);
+    } else {
+        tcp_socket.connect(c_fsm, c_filt);
+    }
+
+    bidirectional_stream_copy(tcp_socket);
+    tcp_socket.wait_until_closed();
 }
 
 int main(int argc, char **argv) {
@@ -144,18 +167,17 @@ int main(int argc, char **argv) {
             return EXIT_FAILURE;
         }
 
-        auto [c_fsm, c_filt, listen, tun_dev_name] = get_config(argc, argv);
-        LossyTCPOverIPv4SpongeSocket tcp_socket(LossyTCPOverIPv4OverTunFdAdapter(
-            TCPOverIPv4OverTunFdAdapter(TunFD(tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name))));
-
-        if (listen) {
-            tcp_socket.listen_and_accept(c_fsm, c_filt);
+        auto [c_fsm, c_filt, listen, tun_dev_name, offload] = get_config(argc, argv);
+        const string tun_dev = tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name;
+        if (offload) {
+            TCPOverIPv4OffloadSpongeSocket tcp_socket(
+                TCPOverIPv4OverTunOffloadAdapter(TunFD(tun_dev, false, true)));
+            run(tcp_socket, c_fsm, c_filt, listen);
         } else {
-            tcp_socket.connect(c_fsm, c_filt);
+            LossyTCPOverIPv4SpongeSocket tcp_socket(
+                LossyTCPOverIPv4OverTunFdAdapter(TCPOverIPv4OverTunFdAdapter(TunFD{tun_dev})));
+            run(tcp_socket, c_fsm, c_filt, listen);
         }
-
-        bidirectional_stream_copy(tcp_socket);
-        tcp_socket.wait_until_closed();
     } catch (const exception &e) {
         cerr << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
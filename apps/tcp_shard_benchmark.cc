@@ -0,0 +1,214 @@
+#include "sharded_tcp_engine.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t n_connections = 1024;
+constexpr size_t segments_per_connection = 128;
+constexpr size_t payload_size = TCPConfig::MAX_PAYLOAD_SIZE;
+constexpr uint16_t server_port = 80;
+
+const WrappingInt32 server_isn{0};
+
+FourTuple connection_id(const size_t i) {
+    const uint32_t client_ip = 0x0a000000 | static_cast<uint32_t>(i >> 8);
+    const uint16_t client_port = static_cast<uint16_t>(10000 + i);
+    return {0x0a800001, client_ip, server_port, client_port};
+}
+
+//! A segment from client `i`, `offset` sequence numbers into its stream
+TCPSegment client_segment(const size_t i, const uint64_t offset, const uint64_t ack_offset = 1) {
+    TCPSegment seg;
+    seg.header().seqno = WrappingInt32{static_cast<uint32_t>(i * 7919)} + offset;
+    seg.header().ack = true;
+    seg.header().ackno = server_isn + ack_offset;
+    seg.header().win = numeric_limits<uint16_t>::max();
+    return seg;
+}
+
+//! The segments that many clients send to one server, interleaved across connections
+vector<pair<FourTuple, TCPSegment>> make_trace() {
+    const Buffer payload{string(payload_size, 'x')};
+
+    vector<pair<FourTuple, TCPSegment>> trace;
+    trace.reserve(n_connections * (segments_per_connection + 3));
+
+    vector<FourTuple> ids;
+    for (size_t i = 0; i < n_connections; i++) {
+        ids.push_back(connection_id(i));
+    }
+    const auto segment = [](const size_t i, const uint64_t offset) {
+        return client_segment(i, offset);
+    };
+
+    for (size_t i = 0; i < n_connections; i++) {
+        TCPSegment syn = segment(i, 0);
+        syn.header().syn = true;
+        syn.header().ack = false;
+        trace.emplace_back(ids[i], move(syn));
+    }
+    for (size_t i = 0; i < n_connections; i++) {
+        trace.emplace_back(ids[i], segment(i, 1));
+    }
+    for (size_t k = 0; k < segments_per_connection; k++) {
+        for (size_t i = 0; i < n_connections; i++) {
+            TCPSegment seg = segment(i, 1 + k * payload_size);
+            seg.mutable_payload() = payload;
+            trace.emplace_back(ids[i], move(seg));
+        }
+    }
+    for (size_t i = 0; i < n_connections; i++) {
+        TCPSegment fin = segment(i, 1 + segments_per_connection * payload_size);
+        fin.header().fin = true;
+        trace.emplace_back(ids[i], move(fin));
+    }
+
+    return trace;
+}
+
+//! Each client's acknowledgment of the server's FIN
+vector<pair<FourTuple, TCPSegment>> make_final_acks() {
+    vector<pair<FourTuple, TCPSegment>> acks;
+    for (size_t i = 0; i < n_connections; i++) {
+        acks.emplace_back(connection_id(i),
+                          client_segment(i, 2 + segments_per_connection * payload_size, 2));
+    }
+    return acks;
+}
+
+//! Per-shard application state, padded so shards don't share cache lines
+struct alignas(64) ShardState {
+    vector<FourTuple> open{};
+    atomic<uint64_t> bytes_received{0};
+    atomic<uint64_t> segments_sent{0};
+    atomic<size_t> connections{0};
+};
+
+void run(const size_t n_shards) {
+    auto trace = make_trace();
+    const uint64_t expected_bytes = n_connections * segments_per_connection * payload_size;
+
+    vector<ShardState> states(n_shards);
+
+    // the application: accept, drain every inbound stream, and close at EOF
+    const auto serve = [&](const size_t shard, TCPEngine &engine) {
+        auto &state = states[shard];
+        while (auto id = engine.accept(server_port)) {
+            state.open.push_back(*id);
+        }
+        uint64_t bytes = 0;
+        for (auto it = state.open.begin(); it != state.open.end();) {
+            auto &inbound = engine.connection(*it).inbound_stream();
+            bytes += inbound.read(inbound.buffer_size()).size();
+            if (inbound.eof()) {
+                engine.close(*it);
+                *it = state.open.back();
+                state.open.pop_back();
+            } else {
+                ++it;
+            }
+        }
+        state.bytes_received.fetch_add(bytes, memory_order_relaxed);
+        state.connections.store(engine.size(), memory_order_relaxed);
+    };
+
+    const auto discard = [&](const size_t shard, ShardedTCPEngine::Batch &batch) {
+        states[shard].segments_sent.fetch_add(batch.size(), memory_order_relaxed);
+    };
+
+    ShardedTCPEngine engine{n_shards, discard, serve};
+    TCPConfig config;
+    config.fixed_isn = WrappingInt32{0};
+    engine.listen(server_port, config, n_connections);
+    engine.start();
+
+    const auto first_time = high_resolution_clock::now();
+
+    for (auto &[id, seg] : trace) {
+        while (not engine.deliver(id, move(seg))) {
+            this_thread::yield();
+        }
+    }
+
+    const auto received = [&] {
+        uint64_t total = 0;
+        for (const auto &state : states) {
+            total += state.bytes_received.load(memory_order_relaxed);
+        }
+        return total;
+    };
+    while (received() < expected_bytes) {
+        if (high_resolution_clock::now() - first_time > seconds(60)) {
+            throw runtime_error("timed out: received " + to_string(received()) + " of " +
+                                to_string(expected_bytes) + " bytes");
+        }
+        this_thread::yield();
+    }
+
+    const auto final_time = high_resolution_clock::now();
+
+    // let every connection finish closing, so none is torn down uncleanly
+    for (auto &[id, seg] : make_final_acks()) {
+        while (not engine.deliver(id, move(seg))) {
+            this_thread::yield();
+        }
+    }
+    const auto open_connections = [&] {
+        size_t total = 0;
+        for (const auto &state : states) {
+            total += state.connections.load(memory_order_relaxed);
+        }
+        return total;
+    };
+    while (open_connections() > 0) {
+        this_thread::yield();
+    }
+    engine.stop();
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    const double gigabits_per_second = expected_bytes * 8.0 / double(duration);
+    const double segments_per_second = trace.size() * 1e9 / double(duration);
+
+    uint64_t segments_sent = 0;
+    for (const auto &state : states) {
+        segments_sent += state.segments_sent.load(memory_order_relaxed);
+    }
+
+    cout << fixed << setprecision(2);
+    cout << setw(6) << n_shards << "   " << setw(8) << gigabits_per_second << " Gbit/s   "
+         << setw(8) << segments_per_second / 1e6 << " Mseg/s   (" << segments_sent
+         << " segments sent)\n";
+}
+
+void program_body(const size_t max_shards) {
+    cout << "CS144 TCP shard scaling benchmark: " << n_connections << " connections, "
+         << n_connections * segments_per_connection * payload_size / (1024 * 1024) << " MiB\n";
+    cout << "shards   throughput        segments\n";
+    for (size_t n = 1; n <= max_shards; n *= 2) {
+        run(n);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        const size_t max_shards =
+            argc > 1 ? stoul(argv[1]) : max(1U, thread::hardware_concurrency());
+        program_body(max_shards);
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -32,6 +32,9 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+         << "   -u              Move datagrams through io_uring.                (plain syscalls)\n"
+         << "   -o              Batch datagrams with UDP GSO/GRO offload.       (sendmmsg)\n\n"
+
          << "   -h              Show this message and quit.\n\n";
 
     if (msg != nullptr) {
@@ -47,12 +50,14 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
     }
 }
 
-static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv) {
+static tuple<TCPConfig, FdAdapterConfig, bool, bool, bool> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
     FdAdapterConfig c_filt{};
 
     int curr = 1;
     bool listen = false;
+    bool uring = false;
+    bool offload = false;
 
     while (argc - curr > 2) {
         if (strncmp("-l", argv[curr], 3) == 0) {
@@ -85,6 +90,14 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
                 static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-u", argv[curr], 3) == 0) {
+            uring = true;
+            curr += 1;
+
+        } else if (strncmp("-o", argv[curr], 3) == 0) {
+            offload = true;
+            curr += 1;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -103,7 +116,22 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
         c_filt.destination = {argv[argc - 2], argv[argc - 1]};
     }
 
-    return make_tuple(c_fsm, c_filt, listen);
+    return make_tuple(c_fsm, c_filt, listen, uring, offload);
+}
+
+template <typename SocketT>
+static void run(SocketT &tcp_socket,
+                const TCPConfig &c_fsm,
+                const FdAdapterConfig &c_filt,
+                const bool listen) {
+    if (listen) {
+        tcp_socket.listen_and_accept(c_fsm, c_filt);
+    } else {
+        tcp_socket.connect(c_fsm, c_filt);
+    }
+
+    bidirectional_stream_copy(tcp_socket);
+    tcp_socket.wait_until_closed();
 }
 
 int main(int argc, char **argv) {
@@ -114,23 +142,24 @@ int main(int argc, char **argv) {
         }
 
         // handle configuration and UDP setup from cmdline arguments
-        auto [c_fsm, c_filt, listen] = get_config(argc, argv);
+        auto [c_fsm, c_filt, listen, uring, offload] = get_config(argc, argv);
 
         // build a TCP FSM on top of the UDP socket
         UDPSocket udp_sock;
         if (listen) {
             udp_sock.bind(c_filt.source);
         }
-        LossyTCPOverUDPSpongeSocket tcp_socket(
-            LossyTCPOverUDPSocketAdapter(TCPOverUDPSocketAdapter(move(udp_sock))));
-        if (listen) {
-            tcp_socket.listen_and_accept(c_fsm, c_filt);
+        if (uring) {
+            LossyTCPOverUDPUringSpongeSocket tcp_socket(
+                LossyTCPOverUDPUringAdapter(TCPOverUDPUringAdapter(move(udp_sock))));
+            run(tcp_socket, c_fsm, c_filt, listen);
         } else {
-            tcp_socket.connect(c_fsm, c_filt);
+            const auto mode = offload ? TCPOverUDPSocketAdapter::Mode::Offload
+                                      : TCPOverUDPSocketAdapter::Mode::Batch;
+            LossyTCPOverUDPSpongeSocket tcp_socket(
+                LossyTCPOverUDPSocketAdapter(TCPOverUDPSocketAdapter(move(udp_sock), mode)));
+            run(tcp_socket, c_fsm, c_filt, listen);
         }
-
-        bidirectional_stream_copy(tcp_socket);
-        tcp_socket.wait_until_closed();
     } catch (const exception &e) {
         cerr << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
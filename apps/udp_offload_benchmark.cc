@@ -0,0 +1,140 @@
+#include "socket.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t payload_size = 1020;  // a full TCPSegment plus its header, as tcp_udp sends
+constexpr size_t batch_size = 32;
+constexpr size_t n_batches = 20000;
+
+//! Wait until `sock` has something to receive, or fail if the datagrams were lost
+void wait_readable(const UDPSocket &sock) {
+    pollfd pfd{sock.fd_num(), POLLIN, 0};
+    if (SystemCall("poll", ::poll(&pfd, 1, 1000)) == 0) {
+        throw runtime_error("timed out waiting for datagrams (dropped?)");
+    }
+}
+
+//! One datagram at a time, with sendto() and recv()
+size_t plain_batch(UDPSocket &sender,
+                   UDPSocket &receiver,
+                   const Address &destination,
+                   const vector<BufferViewList> &payloads) {
+    for (const auto &payload : payloads) {
+        sender.sendto(destination, payload);
+    }
+    UDPSocket::received_datagram datagram{{nullptr, 0}, ""};
+    size_t bytes = 0;
+    for (size_t i = 0; i < payloads.size(); i++) {
+        receiver.recv(datagram);
+        bytes += datagram.payload.size();
+    }
+    return bytes;
+}
+
+//! One syscall per batch each way, with sendmmsg() and recvmmsg()
+size_t mmsg_batch(UDPSocket &sender,
+                  UDPSocket &receiver,
+                  const Address &destination,
+                  const vector<BufferViewList> &payloads) {
+    sender.send_batch(destination, payloads);
+    vector<UDPSocket::received_datagram> datagrams;
+    static UDPSocket::batch_storage storage{batch_size};  // allocated once, like an adapter's
+    while (datagrams.size() < payloads.size()) {
+        if (receiver.recv_batch(datagrams, storage) == 0) {
+            wait_readable(receiver);
+        }
+    }
+    size_t bytes = 0;
+    for (const auto &datagram : datagrams) {
+        bytes += datagram.payload.size();
+    }
+    return bytes;
+}
+
+//! One syscall per batch each way, with the kernel segmenting (GSO) and coalescing (GRO)
+size_t gso_batch(UDPSocket &sender,
+                 UDPSocket &receiver,
+                 const Address &destination,
+                 const vector<BufferViewList> &payloads) {
+    sender.send_segmented(destination, payloads);
+    UDPSocket::received_segments segments{{nullptr, 0}, {}};
+    size_t received = 0;
+    size_t bytes = 0;
+    while (received < payloads.size()) {
+        receiver.recv_segments(segments);
+        if (segments.payloads.empty()) {
+            wait_readable(receiver);
+        }
+        received += segments.payloads.size();
+        for (const auto &payload : segments.payloads) {
+            bytes += payload.size();
+        }
+    }
+    return bytes;
+}
+
+template <typename BatchT>
+void run(const string &name, const BatchT &batch, const bool gro = false) {
+    UDPSocket sender, receiver;
+    sender.bind(Address{"127.0.0.1", 0});
+    receiver.bind(Address{"127.0.0.1", 0});
+    receiver.set_gro(gro);
+    const Address destination = receiver.local_address();
+
+    vector<string> storage;
+    for (size_t i = 0; i < batch_size; i++) {
+        storage.emplace_back(payload_size, char('a' + i % 26));
+    }
+    const vector<BufferViewList> payloads(storage.begin(), storage.end());
+
+    const auto first_time = high_resolution_clock::now();
+    size_t bytes = 0;
+    for (size_t i = 0; i < n_batches; i++) {
+        bytes += batch(sender, receiver, destination, payloads);
+    }
+    const auto final_time = high_resolution_clock::now();
+
+    if (bytes != n_batches * batch_size * payload_size) {
+        throw runtime_error(name + ": received " + to_string(bytes) + " bytes, expected " +
+                            to_string(n_batches * batch_size * payload_size));
+    }
+
+    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+    const double gigabits_per_second = bytes * 8.0 / double(duration);
+    const double datagrams_per_second = n_batches * batch_size * 1e9 / double(duration);
+
+    cout << fixed << setprecision(2);
+    cout << setw(6) << name << "   " << setw(8) << gigabits_per_second << " Gbit/s   " << setw(8)
+         << datagrams_per_second / 1e6 << " Mdgram/s\n";
+}
+
+void program_body() {
+    cout << "CS144 UDP loopback benchmark: " << n_batches << " batches of " << batch_size << " x "
+         << payload_size << "-byte datagrams\n";
+    cout << "  mode   throughput        datagrams\n";
+    run("plain", plain_batch);
+    run("mmsg", mmsg_batch);
+    run("gso", gso_batch, true);
+}
+
+int main() {
+    try {
+        program_body();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -43,6 +43,28 @@ add_test(NAME arp_network_interface    COMMAND net_interface)
 
 add_test(NAME router_test    COMMAND network_simulator)
 
+add_test(NAME t_connection_table     COMMAND connection_table)
+add_test(NAME t_tcp_engine           COMMAND tcp_engine)
+add_test(NAME t_sharded_tcp_engine   COMMAND sharded_tcp_engine)
+add_test(NAME t_sharded_router       COMMAND sharded_router)
+add_test(NAME t_multi_queue_tun      COMMAND multi_queue_tun)
+add_test(NAME t_route_table          COMMAND route_table)
+add_test(NAME t_router_flow_cache    COMMAND router_flow_cache)
+add_test(NAME t_timing_wheel         COMMAND timing_wheel)
+add_test(NAME t_eventloop            COMMAND eventloop)
+add_test(NAME t_packet_io_uring      COMMAND packet_io_uring)
+add_test(NAME t_socket_batch         COMMAND socket_batch)
+add_test(NAME t_socket_offload       COMMAND socket_offload)
+add_test(NAME t_packet_ring          COMMAND packet_ring)
+add_test(NAME t_checksum             COMMAND checksum)
+add_test(NAME t_packet_builder       COMMAND packet_builder)
+add_test(NAME t_buffer_pool          COMMAND buffer_pool)
+add_test(NAME t_small_vector         COMMAND small_vector)
+add_test(NAME t_segment_queue        COMMAND segment_queue)
+add_test(NAME t_prefix_table         COMMAND prefix_table)
+add_test(NAME t_header_parser        COMMAND header_parser)
+add_test(NAME t_tun_offload          COMMAND tun_offload)
+
 add_test(NAME t_tcp_parser           COMMAND tcp_parser "${PROJECT_SOURCE_DIR}/tests/ipv4_parser.data")
 add_test(NAME t_ipv4_parser          COMMAND ipv4_parser "${PROJECT_SOURCE_DIR}/tests/ipv4_parser.data")
 add_test(NAME t_active_close         COMMAND fsm_active_close)
@@ -1,5 +1,7 @@
 #include "byte_stream.hh"
 
+#include "util.hh"
+
 #include <algorithm>
 #include <cassert>
 #include <cstring>
@@ -20,7 +22,7 @@ using namespace std;
 
 ByteStream::ByteStream(const size_t capacity) { buf_.init(capacity); }
 
-size_t ByteStream::write(const string &data) {
+size_t ByteStream::write(string_view data) {
     assert(!input_ended_);
     size_t count = 0;
     size_t data_size = data.size();
@@ -63,6 +65,16 @@ std::string ByteStream::read(const size_t len) {
     return result;
 }
 
+//! \param[out] destination must have room for "len" bytes
+//! \param[in] len bytes will be popped and copied
+//! \param[in,out] checksum has the bytes added to it (e.g., for a TCP payload),
+//! so they are read only once
+void ByteStream::read(char *destination, const size_t len, InternetChecksum &checksum) {
+    assert(len <= buffer_size());
+    buf_.copy_front(destination, len, checksum);
+    pop_output(len);
+}
+
 void ByteStream::end_input() {
     if (buffer_empty()) {
         eof_ = true;
@@ -114,26 +126,26 @@ void RingBuffer::init(const size_t capacity) {
     inner_data_ = new char[capacity];
 }
 
-void RingBuffer::push_back(const std::string &data, const size_t len) {
+void RingBuffer::push_back(std::string_view data, const size_t len) {
     assert(remaining_size() >= len);
     assert(data.size() >= len);
-    auto data_ptr = const_cast<char *>(data.c_str());
+    auto data_ptr = data.data();
     if (tail_ >= head_) {
         // it must be not full, or the assertion should have failed.
         size_t tail_remaining_size = capacity_ - tail_;
         if (tail_remaining_size >= len) {
             std::memcpy(
-                static_cast<void *>(inner_data_ + tail_), static_cast<void *>(data_ptr), len);
+                static_cast<void *>(inner_data_ + tail_), static_cast<const void *>(data_ptr), len);
         } else {
             std::memcpy(static_cast<void *>(inner_data_ + tail_),
-                        static_cast<void *>(data_ptr),
+                        static_cast<const void *>(data_ptr),
                         tail_remaining_size);
             std::memcpy(static_cast<void *>(inner_data_),
-                        static_cast<void *>(data_ptr + tail_remaining_size),
+                        static_cast<const void *>(data_ptr + tail_remaining_size),
                         len - tail_remaining_size);
         }
     } else {
-        std::memcpy(static_cast<void *>(inner_data_ + tail_), static_cast<void *>(data_ptr), len);
+        std::memcpy(static_cast<void *>(inner_data_ + tail_), static_cast<const void *>(data_ptr), len);
     }
     tail_ = (tail_ + len) % capacity_;
     if (tail_ == head_ && len > 0) {
@@ -167,8 +179,20 @@ std::string RingBuffer::peek_front(const size_t len) const {
     return result;
 }
 
+void RingBuffer::copy_front(char *destination, const size_t len, InternetChecksum &checksum) const {
+    assert(size() >= len);
+    const size_t head_remaining_size = capacity_ - head_;
+    if (head_remaining_size >= len) {
+        checksum.copy_and_add(destination, {inner_data_ + head_, len});
+    } else {
+        checksum.copy_and_add(destination, {inner_data_ + head_, head_remaining_size});
+        checksum.copy_and_add(destination + head_remaining_size,
+                              {inner_data_, len - head_remaining_size});
+    }
+}
+
 /* ------- private ------- */
-void ByteStream::push_str(const std::string &data, const size_t len) {
+void ByteStream::push_str(std::string_view data, const size_t len) {
     assert(data.size() >= len);
     assert(remaining_capacity() >= len);
     buf_.push_back(data, len);
@@ -2,8 +2,10 @@
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 
 #include <string>
+#include <string_view>
 
 class ByteStream;
+class InternetChecksum;
 
 /**
  * This class doesn't keep the "Modern C++" style
@@ -34,8 +36,9 @@ class RingBuffer {
     size_t size() const { return full_ ? capacity_ : (tail_ - head_ + capacity_) % capacity_; }
     size_t capacity() const { return capacity_; }
     size_t remaining_size() const { return capacity_ - size(); }
-    void push_back(const std::string &data, const size_t len);
+    void push_back(std::string_view data, const size_t len);
     std::string peek_front(const size_t len) const;
+    void copy_front(char *destination, const size_t len, InternetChecksum &checksum) const;
     void pop_front(const size_t len);
 };
 
@@ -53,7 +56,7 @@ class ByteStream {
     // that's a sign that you probably want to keep exploring
     // different approaches.
 
-    void push_str(const std::string &data, const size_t len);
+    void push_str(std::string_view data, const size_t len);
 
     bool error_{};  //!< Flag indicating that the stream suffered an error.
     size_t bytes_written_{0};
@@ -72,7 +75,7 @@ class ByteStream {
     //! Write a string of bytes into the stream. Write as many
     //! as will fit, and return how many were written.
     //! \returns the number of bytes accepted into the stream
-    size_t write(const std::string &data);
+    size_t write(std::string_view data);
 
     //! \returns the number of additional bytes that the stream has space for
     size_t remaining_capacity() const;
@@ -98,6 +101,10 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read the next "len" bytes of the stream into `destination`, adding
+    //! them to `checksum` as they are copied
+    void read(char *destination, const size_t len, InternetChecksum &checksum);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -33,6 +33,15 @@ NetworkInterface::NetworkInterface(const EthernetAddress &ethernet_address,
 //! \param[in] next_hop the IP address of the interface to send it to (typically a router or default gateway, but may also be another host if directly connected to the same network as the destination)
 //! (Note: the Address type can be converted to a uint32_t (raw 32-bit IP address) with the Address::ipv4_numeric() method.)
 void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Address &next_hop) {
+    send_datagrams(&dgram, 1, next_hop);
+}
+
+//! \param[in] dgrams the IPv4 datagrams to be sent, in order
+//! \param[in] count the number of datagrams
+//! \param[in] next_hop the IP address of the interface to send them all to
+void NetworkInterface::send_datagrams(const InternetDatagram *dgrams,
+                                      const size_t count,
+                                      const Address &next_hop) {
     // convert IP address of next hop to raw 32-bit representation (used in ARP header)
     const uint32_t next_hop_ip = next_hop.ipv4_numeric();
 
@@ -43,21 +52,21 @@ void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Addres
     auto it = ip_eth_map_.find(next_hop_ip);
 
     if (it != ip_eth_map_.end()) {
-        /* found, send it directly */
+        /* found, send them directly */
         header.dst = it->second.addr;
         header.type = EthernetHeader::TYPE_IPv4;
-        frame.payload() = dgram.serialize();
-        frames_out_.push(frame);
+        for (size_t i = 0; i < count; i++) {
+            EthernetFrame data_frame;
+            data_frame.header() = header;
+            data_frame.payload() = dgrams[i].serialize();
+            frames_out_.push(std::move(data_frame));
+        }
     } else {
         /* not found, ARP */
-        /* 1. enqueue the ip datagram */
-        auto eth_it = waiting_dgrams_.find(next_hop_ip);
-        if (eth_it != waiting_dgrams_.end()) {
-            eth_it->second.push(dgram);
-        } else {
-            std::queue<InternetDatagram> waiting_queue;
-            waiting_queue.push(dgram);
-            waiting_dgrams_.emplace(next_hop_ip, waiting_queue);
+        /* 1. enqueue the ip datagrams */
+        auto &waiting_queue = waiting_dgrams_[next_hop_ip];
+        for (size_t i = 0; i < count; i++) {
+            waiting_queue.push(dgrams[i]);
         }
         /* 2. broadcast ARP */
         auto time_it = ip_waiting_time_map_.find(next_hop_ip);
@@ -85,6 +94,15 @@ void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Addres
     }
 }
 
+//! \param[in] ip the raw 32-bit IP address to look up
+optional<EthernetAddress> NetworkInterface::known_ethernet_address(const uint32_t ip) const {
+    const auto it = ip_eth_map_.find(ip);
+    if (it == ip_eth_map_.end()) {
+        return nullopt;
+    }
+    return it->second.addr;
+}
+
 //! \param[in] frame the incoming Ethernet frame
 optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &frame) {
     const auto &header = frame.header();
@@ -108,6 +126,10 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
         auto const sender_eth_addr = arp_msg.sender_ethernet_address;
         auto const sender_ip_addr = arp_msg.sender_ip_address;
         // Warning: Here, I didn't consider more corner cases.
+        const auto known = ip_eth_map_.find(sender_ip_addr);
+        if (known == ip_eth_map_.end() or known->second.addr != sender_eth_addr) {
+            arp_generation_++;
+        }
         ip_eth_map_[sender_ip_addr] = RememberedEthAddr{sender_eth_addr, 0};
         auto it = ip_waiting_time_map_.find(sender_ip_addr);
         if (it != ip_waiting_time_map_.end()) {
@@ -164,6 +186,7 @@ void NetworkInterface::tick(const size_t ms_since_last_tick) {
         if (it->second.time > 30000) {
             // out-of-date
             it = ip_eth_map_.erase(it);
+            arp_generation_++;
         } else {
             ++it;
         }
@@ -51,6 +51,9 @@ class NetworkInterface {
     std::unordered_map<uint32_t, RememberedEthAddr> ip_eth_map_{};
     std::unordered_map<uint32_t, size_t> ip_waiting_time_map_{};
 
+    //! changes whenever `ip_eth_map_` learns, changes or forgets a mapping
+    uint64_t arp_generation_{0};
+
   public:
     //! \brief Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer) addresses
     NetworkInterface(const EthernetAddress &ethernet_address, const Address &ip_address);
@@ -58,12 +61,28 @@ class NetworkInterface {
     //! \brief Access queue of Ethernet frames awaiting transmission
     std::queue<EthernetFrame> &frames_out() { return frames_out_; }
 
+    //! \brief The interface's own Ethernet address
+    const EthernetAddress &ethernet_address() const { return ethernet_address_; }
+
+    //! \brief The Ethernet address that ARP has learned for `ip`, if it knows one
+    std::optional<EthernetAddress> known_ethernet_address(const uint32_t ip) const;
+
+    //! \brief A number that changes whenever a learned Ethernet address does (or is forgotten),
+    //! so that a caller can tell whether one it kept is still good
+    uint64_t arp_generation() const { return arp_generation_; }
+
     //! \brief Sends an IPv4 datagram, encapsulated in an Ethernet frame (if it knows the Ethernet destination address).
 
     //! Will need to use [ARP](\ref rfc::rfc826) to look up the Ethernet destination address for the next hop
     //! ("Sending" is accomplished by pushing the frame onto the frames_out queue.)
     void send_datagram(const InternetDatagram &dgram, const Address &next_hop);
 
+    //! \brief Sends `count` IPv4 datagrams to the same next hop, as send_datagram() would one
+    //! at a time, but looking up (or requesting) the next hop's Ethernet address just once.
+    void send_datagrams(const InternetDatagram *dgrams,
+                        const size_t count,
+                        const Address &next_hop);
+
     //! \brief Receives an Ethernet frame and responds appropriately.
 
     //! If type is IPv4, returns the datagram.
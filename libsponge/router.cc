@@ -1,6 +1,10 @@
 #include "router.hh"
 
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
 
 using namespace std;
 
@@ -18,6 +22,20 @@ using namespace std;
 template <typename... Targs>
 void DUMMY_CODE(Targs &&.../* unused */) {}
 
+Router::Router(const size_t burst_size, const size_t max_route_chunks)
+    : _routes(max_route_chunks), _burst_size(burst_size) {
+    if (burst_size == 0 or burst_size > MAX_BURST_SIZE) {
+        throw runtime_error("Router: burst size must be from 1 to " + to_string(MAX_BURST_SIZE));
+    }
+    _burst.reserve(burst_size);
+    _burst_dsts.reserve(burst_size);
+    _burst_next_hops.reserve(burst_size);
+    _egresses.reserve(burst_size);
+    _egress_group.reserve(burst_size);
+    _misses.reserve(burst_size);
+    _miss_dsts.reserve(burst_size);
+}
+
 //! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
 //! \param[in] prefix_length For this route to be applicable, how many high-order (most-significant) bits of the route_prefix will need to match the corresponding bits of the datagram's destination address?
 //! \param[in] next_hop The IP address of the next hop. Will be empty if the network is directly attached to the router (in which case, the next hop address should be the datagram's final destination).
@@ -31,51 +49,125 @@ void Router::add_route(const uint32_t route_prefix,
          << " on interface " << interface_num << "\n";
 
     // Your code here.
-    _routes.push_back({route_prefix, prefix_length, next_hop, interface_num});
+    _routes.add(route_prefix, prefix_length, next_hop, interface_num);
+}
+
+bool Router::remove_route(const uint32_t route_prefix, const uint8_t prefix_length) {
+    return _routes.remove(route_prefix, prefix_length);
 }
 
-//! \param[in] dgram The datagram to be routed
-void Router::route_one_datagram(InternetDatagram &dgram) {
+//! \details The new routes are published together, so route() sees either all of the old ones
+//! or all of the new ones.
+void Router::replace_routes(const vector<Route> &routes) { _routes.replace(routes); }
+
+//! \details Datagrams that hit in the flow cache go out first. The rest are looked up
+//! together, and go out in groups, in order of interface and next hop, with the datagrams in
+//! each group in the order they arrived. Datagrams to one destination either all hit or all
+//! miss, so no flow is reordered.
+void Router::route_burst(const PrefixTable::Snapshot &table, const uint64_t generation) {
     // Your code here.
-    auto &header = dgram.header();
-    if (header.ttl <= 1) {
-        return;
+    _misses.clear();
+    _miss_dsts.clear();
+    for (size_t i = 0; i < _burst.size(); i++) {
+        const auto &entry = flow_cache_slot(_burst_dsts[i]);
+        if (entry.dst == _burst_dsts[i] and entry.route_generation == generation and
+            entry.arp_generation == _interfaces[entry.interface_num].arp_generation()) {
+            EthernetFrame frame;
+            frame.header() = entry.header;
+            frame.payload() = _burst[i].serialize();
+            _interfaces[entry.interface_num].frames_out().push(move(frame));
+        } else {
+            _misses.push_back(i);
+            _miss_dsts.push_back(_burst_dsts[i]);
+        }
     }
-    --header.ttl;
-    uint32_t dst_ip = header.dst;
-
-    uint8_t max_prefix_len = 0;
-    int idx = -1;
-    for (size_t i = 0; i < _routes.size(); ++i) {
-        const auto &route = _routes[i];
-
-        uint32_t mask = ((1U << route.prefix_length) - 1) << (32 - route.prefix_length);
-        if ((mask & dst_ip) == route.route_prefix) {
-            if (route.prefix_length >= max_prefix_len) {
-                max_prefix_len = route.prefix_length;
-                idx = i;
-            }
+    _flow_cache_hits += _burst.size() - _misses.size();
+    _flow_cache_misses += _misses.size();
+
+    _burst_next_hops.resize(_misses.size());
+    table.lookup(_miss_dsts.data(), _miss_dsts.size(), _burst_next_hops.data());
+
+    _egresses.clear();
+    for (size_t m = 0; m < _misses.size(); m++) {
+        if (not _burst_next_hops[m].has_value()) {
+            continue;
+        }
+        const size_t i = _misses[m];
+        const auto value = *_burst_next_hops[m];
+        const auto &next_hop = _routes.next_hop(value, _burst[i]);
+        _egresses.push_back({next_hop.interface_num,
+                             next_hop.ip.value_or(_burst_dsts[i]),
+                             i,
+                             not _routes.multipath(value)});
+    }
+    sort(_egresses.begin(), _egresses.end(), [](const Egress &a, const Egress &b) {
+        return tie(a.interface_num, a.next_hop_ip, a.index) <
+               tie(b.interface_num, b.next_hop_ip, b.index);
+    });
+
+    for (auto first = _egresses.cbegin(); first != _egresses.cend();) {
+        const auto last = find_if(first, _egresses.cend(), [&](const Egress &egress) {
+            return egress.interface_num != first->interface_num or
+                   egress.next_hop_ip != first->next_hop_ip;
+        });
+        _egress_group.clear();
+        for (auto it = first; it != last; it++) {
+            _egress_group.push_back(move(_burst[it->index]));
         }
+        interface(first->interface_num)
+            .send_datagrams(_egress_group.data(),
+                            _egress_group.size(),
+                            Address::from_ipv4_numeric(first->next_hop_ip));
+        remember(first, last, generation);
+        first = last;
     }
-    if (idx == -1) {
+}
+
+//! \details Nothing is remembered if the next hop's Ethernet address is not known yet: its
+//! datagrams are waiting for ARP.
+void Router::remember(const vector<Egress>::const_iterator first,
+                      const vector<Egress>::const_iterator last,
+                      const uint64_t generation) {
+    const auto &out = interface(first->interface_num);
+    const auto ethernet_address = out.known_ethernet_address(first->next_hop_ip);
+    if (not ethernet_address.has_value()) {
         return;
     }
-    if (_routes[idx].next_hop.has_value()) {
-        interface(_routes[idx].interface_num).send_datagram(dgram, _routes[idx].next_hop.value());
-    } else {
-        interface(_routes[idx].interface_num)
-            .send_datagram(dgram, Address::from_ipv4_numeric(dst_ip));
+    const EthernetHeader header{
+        *ethernet_address, out.ethernet_address(), EthernetHeader::TYPE_IPv4};
+    for (auto it = first; it != last; it++) {
+        if (it->cacheable) {
+            const uint32_t dst = _burst_dsts[it->index];
+            flow_cache_slot(dst) = {
+                dst, generation, out.arp_generation(), first->interface_num, header};
+        }
     }
 }
 
+//! \details Datagrams whose TTL runs out are dropped as they are taken into a burst, so the
+//! rest of the pipeline only sees ones to forward.
 void Router::route() {
+    // the generation first, so that it is no newer than the snapshot
+    const uint64_t generation = _routes.generation();
+    const EpochDomain::Guard guard{_reader};
+    const auto table = _routes.snapshot();
     // Go through all the interfaces, and route every incoming datagram to its proper outgoing
     // interface.
     for (auto &interface : _interfaces) {
         auto &queue = interface.datagrams_out();
         while (not queue.empty()) {
-            route_one_datagram(queue.front());
-            queue.pop();
+            _burst.clear();
+            _burst_dsts.clear();
+            for (size_t taken = 0; taken < _burst_size and not queue.empty(); taken++) {
+                auto &dgram = queue.front();
+                if (as_const(dgram).header().ttl > 1) {
+                    dgram.decrement_ttl();
+                    _burst_dsts.push_back(as_const(dgram).header().dst);
+                    _burst.push_back(move(dgram));
+                }
+                queue.pop();
+            }
+            route_burst(table, generation);
         }
     }
 }
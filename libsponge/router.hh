@@ -2,9 +2,13 @@
 #define SPONGE_LIBSPONGE_ROUTER_HH
 
 #include "network_interface.hh"
+#include "prefix_table.hh"
+#include "route_table.hh"
 
+#include <cstdint>
 #include <optional>
 #include <queue>
+#include <vector>
 
 //! \brief A wrapper for NetworkInterface that makes the host-side
 //! interface asynchronous: instead of returning received datagrams
@@ -40,25 +44,103 @@ class AsyncNetworkInterface : public NetworkInterface {
 
 //! \brief A router that has multiple network interfaces and
 //! performs longest-prefix-match routing between them.
+//! \details The routes can be changed (by one thread at a time) while another thread is in
+//! route(): the changes take effect at its next call, without holding it up.
+//!
+//! route() forwards datagrams in bursts, a vector at a time rather than one by one: it takes
+//! up to a burst's worth from an interface, looks up all of their routes together (overlapping
+//! the lookups' cache misses), groups them by egress interface and next hop, and hands each
+//! group to its interface in one go.
+//!
+//! A flow cache sits in front of the route lookups. It is direct-mapped by destination address,
+//! and each entry holds the egress interface and a prebuilt Ethernet header, addressed to the
+//! next hop. A datagram whose destination hits in the cache is framed and queued at once,
+//! without a route lookup or an ARP lookup. Entries carry the generation of the routes and
+//! of their interface's ARP cache that they were worked out from, so any change to either
+//! makes them miss. Multipath routes choose by flow rather than by destination, so they are
+//! never cached.
 class Router {
-    struct Route {
-        uint32_t route_prefix;
-        uint8_t prefix_length;
-        std::optional<Address> next_hop;
+  public:
+    //! A forwarding rule, as given to add_route()
+    using Route = RouteTable::Route;
+
+    //! One of a multipath route's paths, as given to add_multipath_route()
+    using Path = RouteTable::Path;
+
+  private:
+    //! Where one datagram of a burst goes
+    struct Egress {
         size_t interface_num;
+        uint32_t next_hop_ip;
+        size_t index;    //!< in `_burst`
+        bool cacheable;  //!< its route is not a multipath one
     };
 
+    //! Where datagrams to one destination went
+    struct FlowCacheEntry {
+        uint32_t dst{};
+        uint64_t route_generation{0};  //!< of the routes it was worked out from (0: empty)
+        uint64_t arp_generation{0};    //!< of its interface's ARP cache, when it was filled
+        size_t interface_num{0};
+        EthernetHeader header{};  //!< for the datagrams' frames
+    };
+
+  public:
+    static constexpr size_t DEFAULT_BURST_SIZE = 64;  //!< datagrams route() forwards together
+    static constexpr size_t MAX_BURST_SIZE = 256;
+    static constexpr size_t FLOW_CACHE_BITS = 12;  //!< the flow cache has 2^FLOW_CACHE_BITS slots
+
+  private:
     //! The router's collection of network interfaces
     std::vector<AsyncNetworkInterface> _interfaces{};
 
-    std::vector<Route> _routes{};
+    RouteTable _routes;
+
+    //! route()'s registration to read `_routes`
+    EpochDomain::Reader _reader{_routes.epochs()};
+
+    size_t _burst_size;
 
-    //! Send a single datagram from the appropriate outbound interface to the next hop,
-    //! as specified by the route with the longest prefix_length that matches the
-    //! datagram's destination address.
-    void route_one_datagram(InternetDatagram &dgram);
+    //! \name Scratch space for one burst, kept between bursts so as not to allocate
+    //!@{
+    std::vector<InternetDatagram> _burst{};
+    std::vector<uint32_t> _burst_dsts{};                                //!< destination of each
+    std::vector<std::optional<PrefixTable::Value>> _burst_next_hops{};  //!< route of each
+    std::vector<Egress> _egresses{};
+    std::vector<InternetDatagram> _egress_group{};  //!< datagrams with the same egress, in order
+    std::vector<size_t> _misses{};                  //!< index of each that missed the flow cache
+    std::vector<uint32_t> _miss_dsts{};             //!< destination of each miss
+    //!@}
+
+    std::vector<FlowCacheEntry> _flow_cache =
+        std::vector<FlowCacheEntry>(size_t{1} << FLOW_CACHE_BITS);
+    size_t _flow_cache_hits{0};
+    size_t _flow_cache_misses{0};
+
+    //! The flow cache's slot for `dst`
+    FlowCacheEntry &flow_cache_slot(const uint32_t dst) {
+        return _flow_cache[(dst * 0x9e3779b1U) >> (32 - FLOW_CACHE_BITS)];
+    }
+
+    //! Send each datagram in `_burst` from the appropriate outbound interface to the next hop,
+    //! as specified by the route with the longest prefix_length that matches the datagram's
+    //! destination address.
+    //! \param[in] table is the routes to look up those missing from the flow cache
+    //! \param[in] generation is the routes' generation, no newer than `table`
+    void route_burst(const PrefixTable::Snapshot &table, const uint64_t generation);
+
+    //! Remember the egress of a group of datagrams just sent to the same next hop
+    void remember(const std::vector<Egress>::const_iterator first,
+                  const std::vector<Egress>::const_iterator last,
+                  const uint64_t generation);
 
   public:
+    //! \param[in] burst_size is the most datagrams route() takes from an interface at once,
+    //! from 1 to MAX_BURST_SIZE
+    //! \param[in] max_route_chunks is the most chunks the routes' PrefixTable can use
+    explicit Router(const size_t burst_size = DEFAULT_BURST_SIZE,
+                    const size_t max_route_chunks = PrefixTable::DEFAULT_MAX_CHUNKS);
+
     //! Add an interface to the router
     //! \param[in] interface an already-constructed network interface
     //! \returns The index of the interface after it has been added to the router
@@ -70,14 +152,41 @@ class Router {
     //! Access an interface by index
     AsyncNetworkInterface &interface(const size_t N) { return _interfaces.at(N); }
 
+    //! \name Route changes
+    //! Each takes effect all at once, and may be made while another thread is in route().
+    //!@{
+
     //! Add a route (a forwarding rule)
     void add_route(const uint32_t route_prefix,
                    const uint8_t prefix_length,
                    const std::optional<Address> next_hop,
                    const size_t interface_num);
 
+    //! \brief Add a route that spreads flows over equal-cost paths
+    //! \details Each flow (by addresses and ports) keeps to one path. Changing a prefix's paths
+    //! moves as few flows as it can.
+    void add_multipath_route(const uint32_t route_prefix,
+                             const uint8_t prefix_length,
+                             const std::vector<Path> &paths) {
+        _routes.add_multipath(route_prefix, prefix_length, paths);
+    }
+
+    //! \brief Remove the route for `route_prefix`/`prefix_length`
+    //! \returns `false` if there is no such route
+    bool remove_route(const uint32_t route_prefix, const uint8_t prefix_length);
+
+    //! Replace every route with `routes`
+    void replace_routes(const std::vector<Route> &routes);
+    //!@}
+
     //! Route packets between the interfaces
     void route();
+
+    //! \name Flow cache statistics
+    //!@{
+    size_t flow_cache_hits() const { return _flow_cache_hits; }      //!< datagrams that hit
+    size_t flow_cache_misses() const { return _flow_cache_misses; }  //!< datagrams that missed
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_ROUTER_HH
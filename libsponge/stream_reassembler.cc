@@ -25,7 +25,7 @@ StreamReassembler::StreamReassembler(const size_t capacity)
 //! \details This function accepts a substring (aka a segment) of bytes,
 //! possibly out-of-order, from the logical stream, and assembles any newly
 //! contiguous substrings and writes them into the output stream in order.
-void StreamReassembler::push_substring(const string &data, const size_t index, const bool eof) {
+void StreamReassembler::push_substring(string_view data, const size_t index, const bool eof) {
     size_t data_size = data.size();
     size_t data_end = index + data_size;
 
@@ -53,6 +53,13 @@ void StreamReassembler::push_substring(const string &data, const size_t index, c
         We just need to store the other part. */
     size_t begin = std::max(index, next_index_);
     size_t len = data_end - begin;
+    if (begin == next_index_ && datas_.empty()) {
+        /* Nothing is waiting to be assembled: write straight into the
+            stream (as much as fits), without storing a copy first. */
+        next_index_ += output_.write(data.substr(begin - index, len));
+        check_eof();
+        return;
+    }
     insert_without_overlap(data.substr(begin - index, len), begin);
     reassemble();
 }
@@ -1,5 +1,6 @@
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
 
@@ -29,6 +30,11 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
     if (!active_) {
         return;
     }
+    if (try_fast_path(seg)) {
+        ++fast_path_segments_;
+        return;
+    }
+    ++slow_path_segments_;
 
     auto const &header = seg.header();
 
@@ -123,6 +129,21 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
     }
 }
 
+optional<size_t> TCPConnection::next_timer_ms() const {
+    if (!active_) {
+        return nullopt;
+    }
+    auto next = sender_.ms_until_timeout();
+    if (linger_after_streams_finish_ && linger_begin_) {
+        const size_t linger_ms = 10 * cfg_.rt_timeout;
+        const size_t remaining = time_since_last_segment_received_ >= linger_ms
+                                     ? 0
+                                     : linger_ms - time_since_last_segment_received_;
+        next = next.has_value() ? min(next.value(), remaining) : remaining;
+    }
+    return next;
+}
+
 void TCPConnection::end_input_stream() {
     assert(active_);
     sender_.stream_in().end_input();
@@ -142,7 +163,7 @@ void TCPConnection::connect() {
     auto &out_header = seg_out.header();
     set_win(out_header);
 
-    segments_out_.push(seg_out);
+    segments_out_.push(move(seg_out));
     segs_out.pop();
     sent_syn_ = true;
     assert(segs_out.empty());
@@ -187,16 +208,11 @@ void TCPConnection::send_rst() {
     header.ackno = receiver_.ackno().value();
     set_win(header);
 
-    segments_out_.push(empty_seg);
+    segments_out_.push(move(empty_seg));
 }
 
 void TCPConnection::send_all() {
-    auto &segs_out = sender_.segments_out();
-    while (!segs_out.empty()) {
-        // char buf[200];
-        // sprintf(buf, "\x1b[1;31m-------\x1b[0m\n");
-        // cerr << buf;
-        auto &seg_out = segs_out.front();
+    for (auto &seg_out : sender_.segments_out().drain()) {
         auto &out_header = seg_out.header();
         /* record syn */
         if (out_header.syn) {
@@ -217,10 +233,59 @@ void TCPConnection::send_all() {
             abs_fin_seqno_ = 1 + sender_.stream_in().bytes_read() + 1 - 1;  // syn|data|fin
         }
         /* send */
-        segments_out_.push(seg_out);
-        /* clean queue */
-        segs_out.pop();
+        segments_out_.push(move(seg_out));
+    }
+}
+
+/**
+ * Header prediction (Van Jacobson): once the handshake is done, most
+ * segments are either a pure ACK or the next in-sequence data segment
+ * whose ACK tells the sender nothing new. Both are handled here without
+ * the SYN/RST/keep-alive checks of the generic path. Teardown is left to
+ * the generic path, except when delivered data completes the inbound
+ * stream ahead of an already-received FIN.
+ * Returns false (having done nothing) if the segment is not predicted.
+ */
+bool TCPConnection::try_fast_path(const TCPSegment &seg) {
+    auto const &header = seg.header();
+    if (!header.ack || header.syn || header.fin || header.rst || header.urg) {
+        return false;
+    }
+    /* our SYN has been acknowledged and the peer's SYN has been received */
+    if (!sent_syn_ || sender_.next_seqno_absolute() <= sender_.bytes_in_flight()) {
+        return false;
+    }
+    auto const ackno = receiver_.ackno();
+    if (!ackno.has_value() || header.seqno != ackno.value()) {
+        return false;
+    }
+
+    if (seg.payload().size() == 0) {
+        /* pure ACK; after our FIN, the generic path watches for it being acked */
+        if (sent_fin_) {
+            return false;
+        }
+        time_since_last_segment_received_ = 0;
+        sender_.ack_received(header.ackno, header.win);
+        sender_.fill_window();
+        send_all();
+        return true;
+    }
+
+    /* pure in-sequence data, nothing new for the sender */
+    if (receiver_.stream_out().input_ended() ||
+        !sender_.ack_is_redundant(header.ackno, header.win)) {
+        return false;
+    }
+    time_since_last_segment_received_ = 0;
+    receiver_.segment_received(seg);
+    sender_.send_empty_segment();
+    send_all();
+    if (receiver_.stream_out().input_ended()) {
+        check_not_need_to_linger();
+        try_to_end_cleanly();
     }
+    return true;
 }
 
 void TCPConnection::end_cleanly() {
@@ -12,6 +12,7 @@ class TCPConnection {
     void set_win(TCPHeader &header);
     void send_rst();
     void send_all();
+    bool try_fast_path(const TCPSegment &seg);
     void end_cleanly();
     void end_uncleanly();
     void try_to_end_cleanly();
@@ -26,7 +27,7 @@ class TCPConnection {
     TCPSender sender_{cfg_.send_capacity, cfg_.rt_timeout, cfg_.fixed_isn};
 
     //! outbound queue of segments that the TCPConnection wants sent
-    std::queue<TCPSegment> segments_out_{};
+    SegmentQueue segments_out_{};
 
     //! Should the TCPConnection stay active (and keep ACKing)
     //! for 10 * cfg_.rt_timeout milliseconds after both streams have ended,
@@ -41,6 +42,11 @@ class TCPConnection {
     bool fin_acked_{false};
     uint64_t abs_fin_seqno_{0};
 
+    //! number of segments handled by the header-prediction fast path
+    size_t fast_path_segments_{0};
+    //! number of segments handled by the generic path
+    size_t slow_path_segments_{0};
+
   public:
     //! \name "Input" interface for the writer
     //!@{
@@ -79,6 +85,14 @@ class TCPConnection {
     TCPState state() const { return {sender_, receiver_, active(), linger_after_streams_finish_}; };
     //!@}
 
+    //! \name Header-prediction statistics
+    //!@{
+    //! \brief number of received segments that took the fast path
+    size_t fast_path_segments() const { return fast_path_segments_; }
+    //! \brief number of received segments that took the generic path
+    size_t slow_path_segments() const { return slow_path_segments_; }
+    //!@}
+
     //! \name Methods for the owner or operating system to call
     //!@{
 
@@ -88,11 +102,15 @@ class TCPConnection {
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
+    //! \brief Milliseconds until the next timer (retransmission or linger) expires
+    //! \returns nothing if no timer is running, in which case tick() has no work to do
+    std::optional<size_t> next_timer_ms() const;
+
     //! \brief TCPSegments that the TCPConnection has enqueued for transmission.
     //! \note The owner or operating system will dequeue these and
     //! put each one into the payload of a lower-layer datagram (usually Internet datagrams (IP),
     //! but could also be user datagrams (UDP) or any other kind).
-    std::queue<TCPSegment> &segments_out() { return segments_out_; }
+    SegmentQueue &segments_out() { return segments_out_; }
 
     //! \brief Is the connection still alive in any way?
     //! \returns `true` if either stream is still running or if the TCPConnection is lingering
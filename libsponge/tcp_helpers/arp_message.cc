@@ -1,6 +1,7 @@
 #include "arp_message.hh"
 
 #include <arpa/inet.h>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
@@ -8,34 +9,30 @@ using namespace std;
 
 ParseResult ARPMessage::parse(const Buffer buffer) {
     NetParser p{buffer};
-
-    if (p.buffer().size() < ARPMessage::LENGTH) {
-        return ParseResult::PacketTooShort;
+    const HeaderView h = p.header(ARPMessage::LENGTH);
+    if (p.error()) {
+        return p.get_error();
     }
 
-    hardware_type = p.u16();
-    protocol_type = p.u16();
-    hardware_address_size = p.u8();
-    protocol_address_size = p.u8();
-    opcode = p.u16();
+    hardware_type = h.u16(0);
+    protocol_type = h.u16(2);
+    hardware_address_size = h.u8(4);
+    protocol_address_size = h.u8(5);
+    opcode = h.u16(6);
 
     if (not supported()) {
         return ParseResult::Unsupported;
     }
 
     // read sender addresses (Ethernet and IP)
-    for (auto &byte : sender_ethernet_address) {
-        byte = p.u8();
-    }
-    sender_ip_address = p.u32();
+    memcpy(sender_ethernet_address.data(), h.str().data() + 8, sender_ethernet_address.size());
+    sender_ip_address = h.u32(14);
 
     // read target addresses (Ethernet and IP)
-    for (auto &byte : target_ethernet_address) {
-        byte = p.u8();
-    }
-    target_ip_address = p.u32();
+    memcpy(target_ethernet_address.data(), h.str().data() + 18, target_ethernet_address.size());
+    target_ip_address = h.u32(24);
 
-    return p.get_error();
+    return ParseResult::NoError;
 }
 
 bool ARPMessage::supported() const {
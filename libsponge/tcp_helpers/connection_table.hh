@@ -0,0 +1,131 @@
+#ifndef SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
+#define SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
+
+#include "four_tuple.hh"
+
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//! \brief An open-addressing hash map from FourTuple to `T`
+//! \details Linear probing over a power-of-two array of slots, kept at most half full.
+//! Erasure uses backward-shift deletion, so there are no tombstones and lookups never
+//! slow down as connections come and go.
+//!
+//! Values are moved when the table grows or when an erasure shifts a neighbour, so
+//! anything that must stay put (e.g. a TCPConnection) should be stored behind a pointer.
+template <typename T>
+class ConnectionTable {
+  private:
+    struct Slot {
+        FourTuple key{};
+        std::optional<T> value{};
+    };
+
+    std::vector<Slot> _slots;
+    size_t _size{0};
+
+    size_t _mask() const { return _slots.size() - 1; }
+    size_t _home(const FourTuple &key) const { return key.hash() & _mask(); }
+
+    //! index of the slot holding `key`, or of the empty slot where it would go
+    size_t _probe(const FourTuple &key) const {
+        size_t i = _home(key);
+        while (_slots[i].value.has_value() and _slots[i].key != key) {
+            i = (i + 1) & _mask();
+        }
+        return i;
+    }
+
+    void _grow() {
+        std::vector<Slot> old(_slots.size() * 2);
+        old.swap(_slots);
+        for (auto &slot : old) {
+            if (slot.value.has_value()) {
+                auto &dst = _slots[_probe(slot.key)];
+                dst.key = slot.key;
+                dst.value = std::move(slot.value);
+            }
+        }
+    }
+
+  public:
+    //! \param[in] initial_capacity is rounded up to a power of two
+    explicit ConnectionTable(const size_t initial_capacity = 16) : _slots() {
+        size_t capacity = 2;
+        while (capacity < initial_capacity) {
+            capacity <<= 1;
+        }
+        _slots.resize(capacity);
+    }
+
+    //! \returns a pointer to the value for `key`, or nullptr if there is none
+    T *find(const FourTuple &key) {
+        auto &slot = _slots[_probe(key)];
+        return slot.value.has_value() ? &slot.value.value() : nullptr;
+    }
+
+    //! \returns a pointer to the value for `key`, or nullptr if there is none
+    const T *find(const FourTuple &key) const {
+        const auto &slot = _slots[_probe(key)];
+        return slot.value.has_value() ? &slot.value.value() : nullptr;
+    }
+
+    //! \brief Insert a value constructed from `args` unless `key` is already present
+    //! \returns the value for `key`, and whether it was newly inserted
+    template <typename... Targs>
+    std::pair<T *, bool> emplace(const FourTuple &key, Targs &&...args) {
+        if (2 * (_size + 1) > _slots.size()) {
+            _grow();
+        }
+        auto &slot = _slots[_probe(key)];
+        if (slot.value.has_value()) {
+            return {&slot.value.value(), false};
+        }
+        slot.key = key;
+        slot.value.emplace(std::forward<Targs>(args)...);
+        ++_size;
+        return {&slot.value.value(), true};
+    }
+
+    //! \returns `true` if `key` was present
+    bool erase(const FourTuple &key) {
+        size_t hole = _probe(key);
+        if (not _slots[hole].value.has_value()) {
+            return false;
+        }
+        // shift back every following entry whose home slot is not in (hole, j]
+        for (size_t j = (hole + 1) & _mask(); _slots[j].value.has_value(); j = (j + 1) & _mask()) {
+            const size_t home = _home(_slots[j].key);
+            const bool stays = hole < j ? (hole < home and home <= j) : (hole < home or home <= j);
+            if (not stays) {
+                _slots[hole].key = _slots[j].key;
+                _slots[hole].value = std::move(_slots[j].value);
+                hole = j;
+            }
+        }
+        _slots[hole].value.reset();
+        --_size;
+        return true;
+    }
+
+    //! \brief Call `f(key, value)` for every entry
+    //! \note `f` must not insert into or erase from the table
+    template <typename F>
+    void for_each(F &&f) {
+        for (auto &slot : _slots) {
+            if (slot.value.has_value()) {
+                f(static_cast<const FourTuple &>(slot.key), slot.value.value());
+            }
+        }
+    }
+
+    //! Number of entries
+    size_t size() const { return _size; }
+
+    //! Is the table empty?
+    bool empty() const { return _size == 0; }
+};
+
+#endif  // SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
@@ -22,3 +22,14 @@ BufferList EthernetFrame::serialize() const {
     ret.append(_payload);
     return ret;
 }
+
+//! \param[in,out] packet is either empty, and gets the payload copied in, or already holds the
+//! payload (e.g. from IPv4Datagram::serialize(PacketBuilder &)); the header is prepended
+void EthernetFrame::serialize(PacketBuilder &packet) const {
+    if (packet.size() == 0) {
+        for (const auto &buffer : _payload.buffers()) {
+            packet.append(buffer.str());
+        }
+    }
+    _header.serialize(packet.prepend(EthernetHeader::LENGTH));
+}
@@ -3,6 +3,7 @@
 
 #include "buffer.hh"
 #include "ethernet_header.hh"
+#include "packet_builder.hh"
 
 //! \brief Ethernet frame
 class EthernetFrame {
@@ -17,6 +18,9 @@ class EthernetFrame {
     //! \brief Serialize the frame to a string
     BufferList serialize() const;
 
+    //! \brief Serialize the frame into a PacketBuilder, in front of its payload
+    void serialize(PacketBuilder &packet) const;
+
     //! \name Accessors
     //!@{
     const EthernetHeader &header() const { return _header; }
@@ -2,50 +2,42 @@
 
 #include "util.hh"
 
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
 using namespace std;
 
 ParseResult EthernetHeader::parse(NetParser &p) {
-    if (p.buffer().size() < EthernetHeader::LENGTH) {
-        return ParseResult::PacketTooShort;
+    const HeaderView h = p.header(EthernetHeader::LENGTH);
+    if (p.error()) {
+        return p.get_error();
     }
 
-    /* read destination address */
-    for (auto &byte : dst) {
-        byte = p.u8();
-    }
-
-    /* read source address */
-    for (auto &byte : src) {
-        byte = p.u8();
-    }
+    /* read destination and source addresses */
+    memcpy(dst.data(), h.str().data(), dst.size());
+    memcpy(src.data(), h.str().data() + dst.size(), src.size());
 
     /* read the frame's type (e.g. IPv4, ARP, or something else) */
-    type = p.u16();
+    type = h.u16(dst.size() + src.size());
 
-    return p.get_error();
+    return ParseResult::NoError;
 }
 
 string EthernetHeader::serialize() const {
-    string ret;
-    ret.reserve(LENGTH);
-
-    /* write destination address */
-    for (auto &byte : dst) {
-        NetUnparser::u8(ret, byte);
-    }
+    string ret(LENGTH, 0);
+    serialize(ret.data());
+    return ret;
+}
 
-    /* write source address */
-    for (auto &byte : src) {
-        NetUnparser::u8(ret, byte);
-    }
+//! \param[out] destination is where to write the LENGTH bytes of the header
+void EthernetHeader::serialize(char *destination) const {
+    /* write destination and source addresses */
+    memcpy(destination, dst.data(), dst.size());
+    memcpy(destination + dst.size(), src.data(), src.size());
 
     /* write the frame's type (e.g. IPv4, ARP or something else) */
-    NetUnparser::u16(ret, type);
-
-    return ret;
+    NetUnparser::u16(destination + dst.size() + src.size(), type);
 }
 
 //! \returns A string with a textual representation of an Ethernet address
@@ -6,37 +6,32 @@
 
 using namespace std;
 
-//! \details This function first attempts to parse a TCP segment from the next UDP
-//! payload recv()d from the socket.
+//! \details Parses a TCP segment from a UDP payload and checks that it is related to the
+//! current connection. When a TCP connection has been established, this means checking that
+//! the datagram came from the configured destination.
 //!
-//! If this succeeds, it then checks that the received segment is related to the
-//! current connection. When a TCP connection has been established, this means
-//! checking that the source and destination ports in the TCP header are correct.
-//!
-//! If the TCP FSM is listening (i.e., TCPOverUDPSocketAdapter::_listen is `true`)
-//! and the TCP segment read from the wire includes a SYN, this function clears the
-//! `_listen` flag and calls calls connect() on the underlying UDP socket, with
-//! the result that future outgoing segments go to the sender of the SYN segment.
+//! If the TCP FSM is listening and the segment includes a SYN, this function clears the
+//! listening flag and makes the sender of the SYN the destination of future outgoing segments.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
-optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
-    auto datagram = _sock.recv();
-
+static optional<TCPSegment> accept_datagram(FdAdapterBase &adapter,
+                                            const Address &source,
+                                            Buffer payload) {
     // is it for us?
-    if (not listening() and (datagram.source_address != config().destination)) {
+    if (not adapter.listening() and (source != adapter.config().destination)) {
         return {};
     }
 
     // is the payload a valid TCP segment?
     TCPSegment seg;
-    if (ParseResult::NoError != seg.parse(move(datagram.payload), 0)) {
+    if (ParseResult::NoError != seg.parse(move(payload), 0)) {
         return {};
     }
 
     // should we target this source in all future replies?
-    if (listening()) {
+    if (adapter.listening()) {
         if (seg.header().syn and not seg.header().rst) {
-            config_mutable().destination = datagram.source_address;
-            set_listening(false);
+            adapter.config_mut().destination = source;
+            adapter.set_listening(false);
         } else {
             return {};
         }
@@ -45,13 +40,95 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
     return seg;
 }
 
-//! Serialize a TCP segment and send it as the payload of a UDP datagram.
+//! \param[in] sock is the socket to receive from and send on; it should be bound, if listening
+//! \param[in] mode is how to batch datagrams; Mode::Offload turns on GRO for the socket
+TCPOverUDPSocketAdapter::TCPOverUDPSocketAdapter(UDPSocket &&sock, const Mode mode)
+    : _sock(move(sock)), _mode(mode) {
+    if (_mode == Mode::Offload) {
+        _sock.set_gro(true);
+    }
+}
+
+//! \details Hands the next datagram of the last batch to accept_datagram(), which parses it and
+//! checks that it belongs to the connection. When the batch has been used up, it first
+//! receives the next one: every datagram waiting on the socket, up to BATCH_SIZE, or in
+//! Mode::Offload the next run of datagrams coalesced by GRO.
+//! \returns a std::optional<TCPSegment> that is empty if nothing arrived, or if the segment was
+//! invalid or unrelated
+optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
+    if (_mode == Mode::Offload) {
+        if (pending() == 0) {
+            _next_received = 0;
+            _sock.recv_segments(_segments);
+            if (_segments.payloads.empty()) {
+                return {};
+            }
+        }
+        return accept_datagram(
+            *this, _segments.source_address, _segments.payloads[_next_received++]);
+    }
+
+    if (pending() == 0) {
+        _received.clear();
+        _next_received = 0;
+        _sock.recv_batch(_received, _batch);
+        if (_received.empty()) {
+            return {};
+        }
+    }
+
+    auto &datagram = _received[_next_received++];
+    return accept_datagram(*this, datagram.source_address, move(datagram.payload));
+}
+
+//! Serialize a TCP segment and queue it to be sent as the payload of a UDP datagram.
 //! \param[in] seg is the TCP segment to write
 void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     seg.header().sport = config().source.port();
     seg.header().dport = config().destination.port();
-    _sock.sendto(config().destination, seg.serialize(0));
+    _unsent.push_back(seg.serialize(0));
+}
+
+//! \details Sends every queued segment to the current destination with UDPSocket::send_batch,
+//! or in Mode::Offload with UDPSocket::send_segmented.
+void TCPOverUDPSocketAdapter::flush() {
+    if (_unsent.empty()) {
+        return;
+    }
+    if (_mode == Mode::Offload) {
+        _sock.send_segmented(config().destination, {_unsent.begin(), _unsent.end()});
+    } else {
+        _sock.send_batch(config().destination, {_unsent.begin(), _unsent.end()});
+    }
+    _unsent.clear();
+}
+
+//! \param[in] sock is the socket to receive from and send on; it should be bound, if listening
+TCPOverUDPUringAdapter::TCPOverUDPUringAdapter(UDPSocket &&sock)
+    : _sock(move(sock)), _io(make_unique<UringPacketIO>(_sock, UringPacketIO::Kind::Socket)) {}
+
+//! \details Reaps completions from the ring only when no datagram is already pending, so
+//! draining a batch with repeated calls costs no syscalls. Filters segments like
+//! TCPOverUDPSocketAdapter::read.
+//! \returns a std::optional<TCPSegment> that is empty if nothing arrived, or if the segment was
+//! invalid or unrelated
+optional<TCPSegment> TCPOverUDPUringAdapter::read() {
+    auto packet = _io->receive();
+    if (not packet.has_value()) {
+        return {};
+    }
+    return accept_datagram(*this, packet->source.value(), move(packet->payload));
+}
+
+//! \param[in] seg is the TCP segment to queue; it is sent by the next flush()
+void TCPOverUDPUringAdapter::write(TCPSegment &seg) {
+    seg.header().sport = config().source.port();
+    seg.header().dport = config().destination.port();
+    _io->send(seg.serialize(0), config().destination);
 }
 
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
 template class LossyFdAdapter<TCPOverUDPSocketAdapter>;
+
+//! Specialize LossyFdAdapter to TCPOverUDPUringAdapter
+template class LossyFdAdapter<TCPOverUDPUringAdapter>;
@@ -2,14 +2,17 @@
 #define SPONGE_LIBSPONGE_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "io_uring.hh"
 #include "lossy_fd_adapter.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
 #include "tcp_header.hh"
 #include "tcp_segment.hh"
 
+#include <memory>
 #include <optional>
 #include <utility>
+#include <vector>
 
 //! \brief Basic functionality for file descriptor adaptors
 //! \details See TCPOverUDPSocketAdapter and TCPOverIPv4OverTunFdAdapter for more information.
@@ -40,23 +43,57 @@ class FdAdapterBase {
 
     //! Called periodically when time elapses
     void tick(const size_t) {}
+
+    //! Segments already received and ready to read() without waiting (for batching adapters)
+    size_t pending() const { return 0; }
+
+    //! Send any segments that write() queued (for batching adapters)
+    void flush() {}
 };
 
 //! \brief A FD adaptor that reads and writes TCP segments in UDP payloads
+//! \details Datagrams move in batches: read() receives every datagram waiting on the socket
+//! with one syscall and hands them out one at a time, and write() queues segments until flush()
+//! sends them all with one syscall. In Mode::Offload, the batches are instead runs of datagrams
+//! that the kernel segments on send (UDP GSO) and coalesces on receive (UDP GRO).
 class TCPOverUDPSocketAdapter : public FdAdapterBase {
+  public:
+    //! How datagrams are moved in batches
+    enum class Mode {
+        Batch,   //!< with recvmmsg/sendmmsg, one message per datagram
+        Offload  //!< with UDP GSO/GRO, one message per run of equal-sized datagrams
+    };
+
   private:
+    static constexpr size_t BATCH_SIZE = 64;  //!< most datagrams received per syscall
+
     UDPSocket _sock;
+    Mode _mode;
+    UDPSocket::batch_storage _batch{BATCH_SIZE};               //!< where batches are received
+    std::vector<UDPSocket::received_datagram> _received{};     //!< the last batch received
+    UDPSocket::received_segments _segments{{nullptr, 0}, {}};  //!< the last run (Offload)
+    size_t _next_received{0};                                  //!< next datagram to read()
+    std::vector<BufferList> _unsent{};                         //!< segments queued by write()
 
   public:
     //! Construct from a UDPSocket sliced into a FileDescriptor
-    explicit TCPOverUDPSocketAdapter(UDPSocket &&sock) : _sock(std::move(sock)) {}
+    explicit TCPOverUDPSocketAdapter(UDPSocket &&sock, const Mode mode = Mode::Batch);
 
     //! Attempts to read and return a TCP segment related to the current connection from a UDP payload
     std::optional<TCPSegment> read();
 
-    //! Writes a TCP segment into a UDP payload
+    //! Queues a TCP segment to be sent in a UDP payload
     void write(TCPSegment &seg);
 
+    //! Datagrams already received and ready to read()
+    size_t pending() const {
+        return (_mode == Mode::Offload ? _segments.payloads.size() : _received.size()) -
+               _next_received;
+    }
+
+    //! Send the segments queued by write()
+    void flush();
+
     //! Access the underlying UDP socket
     operator UDPSocket &() { return _sock; }
 
@@ -67,4 +104,42 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
 //! Typedef for TCPOverUDPSocketAdapter
 using LossyTCPOverUDPSocketAdapter = LossyFdAdapter<TCPOverUDPSocketAdapter>;
 
+//! \brief A FD adaptor that reads and writes TCP segments in UDP payloads through an io_uring
+//! \details Behaves like TCPOverUDPSocketAdapter, but datagrams are received and sent in batches
+//! by a UringPacketIO. An EventLoop should watch the adapter's FileDescriptor, which signals
+//! completions rather than the socket's own readiness.
+class TCPOverUDPUringAdapter : public FdAdapterBase {
+  private:
+    UDPSocket _sock;
+    std::unique_ptr<UringPacketIO> _io;
+
+  public:
+    //! Construct from a UDPSocket, which it then owns
+    explicit TCPOverUDPUringAdapter(UDPSocket &&sock);
+
+    //! Attempts to read and return a TCP segment related to the current connection from a UDP payload
+    std::optional<TCPSegment> read();
+
+    //! Queues a TCP segment to be sent in a UDP payload
+    void write(TCPSegment &seg);
+
+    //! Datagrams already received and ready to read()
+    size_t pending() const { return _io->pending(); }
+
+    //! Send the segments queued by write()
+    void flush() { _io->flush(); }
+
+    //! The descriptor to wait on: readable when the ring has completions
+    operator const FileDescriptor &() const { return _io->event_fd(); }
+
+    //! Access the underlying UDP socket
+    UDPSocket &socket() { return _sock; }
+
+    //! Access the io_uring engine (e.g., for its statistics)
+    const UringPacketIO &io() const { return *_io; }
+};
+
+//! Typedef for TCPOverUDPUringAdapter
+using LossyTCPOverUDPUringAdapter = LossyFdAdapter<TCPOverUDPUringAdapter>;
+
 #endif  // SPONGE_LIBSPONGE_FD_ADAPTER_HH
@@ -0,0 +1,91 @@
+#include "flow_hash.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+const array<uint8_t, ToeplitzHash::KEY_LENGTH> ToeplitzHash::DEFAULT_KEY = {
+    0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2, 0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3,
+    0x8f, 0xb0, 0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4, 0x77, 0xcb, 0x2d, 0xa3,
+    0x80, 0x30, 0xf2, 0x0c, 0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa};
+
+//! \details Input bit `i` (counting from the most significant bit of the first byte)
+//! contributes the 32 key bits starting at key bit `i` when it is set.
+ToeplitzHash::ToeplitzHash(const array<uint8_t, KEY_LENGTH> &key) {
+    const auto key_bit = [&](const size_t i) { return (key[i / 8] >> (7 - i % 8)) & 1; };
+
+    for (size_t pos = 0; pos < INPUT_LENGTH; pos++) {
+        // the 32-bit windows of the key seen by each bit of the byte at `pos`
+        array<uint32_t, 8> windows{};
+        for (size_t bit = 0; bit < 8; bit++) {
+            uint32_t window = 0;
+            for (size_t i = 0; i < 32; i++) {
+                window = (window << 1) | key_bit(pos * 8 + bit + i);
+            }
+            windows[bit] = window;
+        }
+
+        for (size_t value = 0; value < 256; value++) {
+            uint32_t result = 0;
+            for (size_t bit = 0; bit < 8; bit++) {
+                if (value & (0x80 >> bit)) {
+                    result ^= windows[bit];
+                }
+            }
+            _table[pos][value] = result;
+        }
+    }
+}
+
+uint32_t ToeplitzHash::operator()(const array<uint8_t, INPUT_LENGTH> &input) const {
+    uint32_t result = 0;
+    for (size_t pos = 0; pos < INPUT_LENGTH; pos++) {
+        result ^= _table[pos][input[pos]];
+    }
+    return result;
+}
+
+uint32_t ToeplitzHash::operator()(const FourTuple &id) const {
+    // (src ip, dst ip, src port, dst port) of an incoming segment, big-endian
+    const array<uint8_t, INPUT_LENGTH> input = {
+        uint8_t(id.remote_ip >> 24),
+        uint8_t(id.remote_ip >> 16),
+        uint8_t(id.remote_ip >> 8),
+        uint8_t(id.remote_ip),
+        uint8_t(id.local_ip >> 24),
+        uint8_t(id.local_ip >> 16),
+        uint8_t(id.local_ip >> 8),
+        uint8_t(id.local_ip),
+        uint8_t(id.remote_port >> 8),
+        uint8_t(id.remote_port),
+        uint8_t(id.local_port >> 8),
+        uint8_t(id.local_port),
+    };
+    return operator()(input);
+}
+
+uint32_t ToeplitzHash::operator()(const InternetDatagram &dgram) const {
+    const IPv4Header &header = dgram.header();
+    array<uint8_t, INPUT_LENGTH> input = {
+        uint8_t(header.src >> 24),
+        uint8_t(header.src >> 16),
+        uint8_t(header.src >> 8),
+        uint8_t(header.src),
+        uint8_t(header.dst >> 24),
+        uint8_t(header.dst >> 16),
+        uint8_t(header.dst >> 8),
+        uint8_t(header.dst),
+    };
+    const bool ported =
+        header.proto == IPv4Header::PROTO_TCP or header.proto == IPv4Header::PROTO_UDP;
+    if (ported and not header.mf and header.offset == 0) {
+        // the ports are the payload's first four bytes, in however many buffers
+        size_t pos = 8;
+        for (const auto &buffer : dgram.payload().buffers()) {
+            const auto bytes = buffer.str().substr(0, INPUT_LENGTH - pos);
+            copy(bytes.begin(), bytes.end(), input.begin() + pos);
+            pos += bytes.size();
+        }
+    }
+    return operator()(input);
+}
@@ -0,0 +1,47 @@
+#ifndef SPONGE_LIBSPONGE_FLOW_HASH_HH
+#define SPONGE_LIBSPONGE_FLOW_HASH_HH
+
+#include "four_tuple.hh"
+#include "ipv4_datagram.hh"
+
+#include <array>
+#include <cstdint>
+
+//! \brief The Toeplitz hash used by NICs for receive-side scaling (RSS)
+//! \details The hash input is (src ip, dst ip, src port, dst port) of a received segment in
+//! network byte order, i.e. (remote, local) for a FourTuple. For a given key, the result
+//! matches what an RSS-capable NIC would compute, so software steering and hardware queues
+//! can agree on which flows go where.
+//!
+//! Rather than walking the key bit by bit, the constructor precomputes the contribution of
+//! every possible byte value at every input position, so hashing a 4-tuple takes 12 table
+//! lookups.
+class ToeplitzHash {
+  public:
+    static constexpr size_t KEY_LENGTH = 40;  //!< length of an RSS key in bytes
+    static constexpr size_t INPUT_LENGTH = 12;  //!< bytes of IPv4 addresses and TCP ports
+
+    //! The key from Microsoft's RSS specification (also the default of many NIC drivers)
+    static const std::array<uint8_t, KEY_LENGTH> DEFAULT_KEY;
+
+  private:
+    std::array<std::array<uint32_t, 256>, INPUT_LENGTH> _table{};
+
+  public:
+    //! Precompute the lookup table for `key`
+    explicit ToeplitzHash(const std::array<uint8_t, KEY_LENGTH> &key = DEFAULT_KEY);
+
+    //! Hash 12 bytes of input
+    uint32_t operator()(const std::array<uint8_t, INPUT_LENGTH> &input) const;
+
+    //! Hash the connection as its incoming segments would be hashed by a NIC
+    uint32_t operator()(const FourTuple &id) const;
+
+    //! \brief Hash the flow a datagram belongs to
+    //! \details TCP and UDP datagrams are hashed by their addresses and ports. Others, and
+    //! fragments (only the first of which carries the ports), are hashed by their addresses
+    //! alone, so that every fragment of a datagram hashes alike.
+    uint32_t operator()(const InternetDatagram &dgram) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_FLOW_HASH_HH
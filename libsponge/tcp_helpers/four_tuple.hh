@@ -0,0 +1,40 @@
+#ifndef SPONGE_LIBSPONGE_FOUR_TUPLE_HH
+#define SPONGE_LIBSPONGE_FOUR_TUPLE_HH
+
+#include "address.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+//! \brief Identifies one TCP connection: local and remote IPv4 address and port
+//! \details For an incoming segment, the remote half is the (src ip, src port) of the
+//! datagram and the local half is its (dst ip, dst port); for an outgoing segment
+//! it is the other way around.
+struct FourTuple {
+    uint32_t local_ip{0};     //!< local IPv4 address (host byte order)
+    uint32_t remote_ip{0};    //!< remote IPv4 address (host byte order)
+    uint16_t local_port{0};   //!< local TCP port
+    uint16_t remote_port{0};  //!< remote TCP port
+
+    //! Construct from a pair of Address objects
+    static FourTuple from_addresses(const Address &local, const Address &remote) {
+        return {local.ipv4_numeric(), remote.ipv4_numeric(), local.port(), remote.port()};
+    }
+
+    //! A well-mixed 64-bit hash of all four fields
+    uint64_t hash() const {
+        uint64_t h = (uint64_t(local_ip) << 32) | remote_ip;
+        h ^= ((uint64_t(local_port) << 16) | remote_port) * 0x9e3779b97f4a7c15ULL;
+        h *= 0xff51afd7ed558ccdULL;
+        return h ^ (h >> 32);
+    }
+
+    bool operator==(const FourTuple &other) const {
+        return local_ip == other.local_ip and remote_ip == other.remote_ip and
+               local_port == other.local_port and remote_port == other.remote_port;
+    }
+
+    bool operator!=(const FourTuple &other) const { return not operator==(other); }
+};
+
+#endif  // SPONGE_LIBSPONGE_FOUR_TUPLE_HH
@@ -8,6 +8,8 @@
 
 using namespace std;
 
+//! \details A header parsed without error has a good checksum, which serialize() can keep as long
+//! as it reproduces the header exactly: so not if it has options or the reserved flag bit set.
 ParseResult IPv4Datagram::parse(const Buffer buffer) {
     NetParser p{buffer};
     _header.parse(p);
@@ -17,6 +19,8 @@ ParseResult IPv4Datagram::parse(const Buffer buffer) {
         return ParseResult::PacketTooShort;
     }
 
+    _cksum_ready = not p.error() and _header.hlen * 4 == IPv4Header::LENGTH and
+                   (buffer.at(6) & 0x80) == 0;
     return p.get_error();
 }
 
@@ -25,17 +29,52 @@ BufferList IPv4Datagram::serialize() const {
         throw runtime_error("IPv4Datagram::serialize: payload is wrong size");
     }
 
+    string header_string(4 * _header.hlen, 0);
+    _serialize_header(header_string.data());
+
+    BufferList ret;
+    ret.append(move(header_string));
+    ret.append(_payload);
+    return ret;
+}
+
+//! \param[in,out] packet is either empty, and gets the payload copied in, or already holds the
+//! payload (e.g. from TCPSegment::serialize(PacketBuilder &, uint32_t)); the header is prepended
+void IPv4Datagram::serialize(PacketBuilder &packet) const {
+    if (packet.size() == 0) {
+        for (const auto &buffer : _payload.buffers()) {
+            packet.append(buffer.str());
+        }
+    }
+    if (packet.size() != _header.payload_length()) {
+        throw runtime_error("IPv4Datagram::serialize: payload is wrong size");
+    }
+
+    _serialize_header(packet.prepend(4 * _header.hlen));
+}
+
+//! \details The checksum is taken over the header as written, then patched in.
+void IPv4Datagram::_serialize_header(char *destination) const {
+    if (_cksum_ready) {
+        _header.serialize(destination);
+        return;
+    }
+
     IPv4Header header_out = _header;
     header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
+    header_out.serialize(destination);
 
     // calculate checksum -- taken over header only
     InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
+    check.add({destination, size_t(4 * header_out.hlen)});
+    NetUnparser::u16(destination + CHECKSUM_OFFSET, check.value());
+}
 
-    BufferList ret;
-    ret.append(header_out.serialize());
-    ret.append(_payload);
-    return ret;
+//! \details The TTL shares a 16-bit word of the header with the protocol number, so the checksum
+//! only needs to account for the change in that word.
+void IPv4Datagram::decrement_ttl() {
+    const uint16_t old_word = (_header.ttl << 8) | _header.proto;
+    _header.ttl--;
+    const uint16_t new_word = (_header.ttl << 8) | _header.proto;
+    _header.cksum = InternetChecksum::update(_header.cksum, old_word, new_word);
 }
@@ -3,12 +3,19 @@
 
 #include "buffer.hh"
 #include "ipv4_header.hh"
+#include "packet_builder.hh"
 
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram
 class IPv4Datagram {
   private:
     IPv4Header _header{};
     BufferList _payload{};
+    bool _cksum_ready{false};  //!< `_header.cksum` is right for the header as it stands
+
+    static constexpr size_t CHECKSUM_OFFSET = 10;  //!< of the checksum field in the header
+
+    //! Write the header, with its checksum, to `destination`
+    void _serialize_header(char *destination) const;
 
   public:
     //! \brief Parse the segment from a string
@@ -17,10 +24,20 @@ class IPv4Datagram {
     //! \brief Serialize the segment to a string
     BufferList serialize() const;
 
+    //! \brief Serialize the datagram into a PacketBuilder, in front of its payload
+    void serialize(PacketBuilder &packet) const;
+
+    //! \brief Decrement the TTL, patching the header checksum instead of recomputing it
+    void decrement_ttl();
+
     //! \name Accessors
+    //! \note Changing the header through header() makes serialize() recompute its checksum.
     //!@{
     const IPv4Header &header() const { return _header; }
-    IPv4Header &header() { return _header; }
+    IPv4Header &header() {
+        _cksum_ready = false;
+        return _header;
+    }
 
     const BufferList &payload() const { return _payload; }
     BufferList &payload() { return _payload; }
@@ -3,6 +3,7 @@
 #include "util.hh"
 
 #include <arpa/inet.h>
+#include <cstring>
 #include <iomanip>
 #include <sstream>
 
@@ -21,30 +22,30 @@ using namespace std;
 //! - there is less data in the full datagram than the `len` field claims
 //! - the checksum is bad
 ParseResult IPv4Header::parse(NetParser &p) {
-    Buffer original_serialized_version = p.buffer();
+    const string_view original_serialized_version = p.buffer().str();
 
-    const size_t data_size = p.buffer().size();
+    const size_t data_size = original_serialized_version.size();
     if (data_size < IPv4Header::LENGTH) {
         return ParseResult::PacketTooShort;
     }
 
-    const uint8_t first_byte = p.u8();
-    ver = first_byte >> 4;     // version
-    hlen = first_byte & 0x0f;  // header length
-    tos = p.u8();              // type of service
-    len = p.u16();             // length
-    id = p.u16();              // id
+    const HeaderView h = p.header(IPv4Header::LENGTH);
+    ver = h.u8(0) >> 4;     // version
+    hlen = h.u8(0) & 0x0f;  // header length
+    tos = h.u8(1);          // type of service
+    len = h.u16(2);         // length
+    id = h.u16(4);          // id
 
-    const uint16_t fo_val = p.u16();
+    const uint16_t fo_val = h.u16(6);
     df = static_cast<bool>(fo_val & 0x4000);  // don't fragment
     mf = static_cast<bool>(fo_val & 0x2000);  // more fragments
     offset = fo_val & 0x1fff;                 // offset
 
-    ttl = p.u8();     // ttl
-    proto = p.u8();   // proto
-    cksum = p.u16();  // checksum
-    src = p.u32();    // source address
-    dst = p.u32();    // destination address
+    ttl = h.u8(8);      // ttl
+    proto = h.u8(9);    // proto
+    cksum = h.u16(10);  // checksum
+    src = h.u32(12);    // source address
+    dst = h.u32(16);    // destination address
 
     if (data_size < 4 * hlen) {
         return ParseResult::PacketTooShort;
@@ -66,7 +67,7 @@ ParseResult IPv4Header::parse(NetParser &p) {
     }
 
     InternetChecksum check;
-    check.add({original_serialized_version.str().data(), size_t(4 * hlen)});
+    check.add(original_serialized_version.substr(0, 4 * hlen));
     if (check.value()) {
         return ParseResult::BadChecksum;
     }
@@ -76,6 +77,14 @@ ParseResult IPv4Header::parse(NetParser &p) {
 
 //! Serialize the IPv4Header to a string (does not recompute the checksum)
 string IPv4Header::serialize() const {
+    string ret(4 * hlen, 0);
+    serialize(ret.data());
+    return ret;
+}
+
+//! \param[out] destination is where to write the `4 * hlen` bytes of the header (any options are
+//! zeroed); the checksum is not recomputed
+void IPv4Header::serialize(char *destination) const {
     // sanity checks
     if (ver != 4) {
         throw runtime_error("wrong IP version");
@@ -84,29 +93,24 @@ string IPv4Header::serialize() const {
         throw runtime_error("IP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * hlen);
-
     const uint8_t first_byte = (ver << 4) | (hlen & 0xf);
-    NetUnparser::u8(ret, first_byte);  // version and header length
-    NetUnparser::u8(ret, tos);         // type of service
-    NetUnparser::u16(ret, len);        // length
-    NetUnparser::u16(ret, id);         // id
+    NetUnparser::u8(destination, first_byte);  // version and header length
+    NetUnparser::u8(destination + 1, tos);     // type of service
+    NetUnparser::u16(destination + 2, len);    // length
+    NetUnparser::u16(destination + 4, id);     // id
 
     const uint16_t fo_val = (df ? 0x4000 : 0) | (mf ? 0x2000 : 0) | (offset & 0x1fff);
-    NetUnparser::u16(ret, fo_val);  // flags and offset
-
-    NetUnparser::u8(ret, ttl);    // time to live
-    NetUnparser::u8(ret, proto);  // protocol number
+    NetUnparser::u16(destination + 6, fo_val);  // flags and offset
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    NetUnparser::u8(destination + 8, ttl);    // time to live
+    NetUnparser::u8(destination + 9, proto);  // protocol number
 
-    NetUnparser::u32(ret, src);  // src address
-    NetUnparser::u32(ret, dst);  // dst address
+    NetUnparser::u16(destination + 10, cksum);  // checksum
 
-    ret.resize(4 * hlen);  // expand header to advertised size
+    NetUnparser::u32(destination + 12, src);  // src address
+    NetUnparser::u32(destination + 16, dst);  // dst address
 
-    return ret;
+    memset(destination + LENGTH, 0, 4 * hlen - LENGTH);  // expand header to advertised size
 }
 
 uint16_t IPv4Header::payload_length() const { return len - 4 * hlen; }
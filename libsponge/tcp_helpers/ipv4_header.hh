@@ -10,6 +10,7 @@ struct IPv4Header {
         20;  //!< [IPv4](\ref rfc::rfc791) header length, not including options
     static constexpr uint8_t DEFAULT_TTL = 128;  //!< A reasonable default TTL value
     static constexpr uint8_t PROTO_TCP = 6;      //!< Protocol number for [tcp](\ref rfc::rfc793)
+    static constexpr uint8_t PROTO_UDP = 17;     //!< Protocol number for [udp](\ref rfc::rfc768)
 
     //! \struct IPv4Header
     //! ~~~{.txt}
@@ -53,6 +54,9 @@ struct IPv4Header {
     //! Serialize the IP fields
     std::string serialize() const;
 
+    //! Serialize the IP fields in place
+    void serialize(char *destination) const;
+
     //! Length of the payload
     uint16_t payload_length() const;
 
@@ -72,6 +72,8 @@ class LossyFdAdapter {
     void tick(const size_t ms_since_last_tick) {
         _adapter.tick(ms_since_last_tick);
     }  //!< FdAdapterBase::tick passthrough
+    size_t pending() const { return _adapter.pending(); }  //!< FdAdapterBase::pending passthrough
+    void flush() { _adapter.flush(); }                      //!< FdAdapterBase::flush passthrough
     //!@}
 };
 
@@ -0,0 +1,162 @@
+#include "route_table.hh"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+void RouteTable::add(const uint32_t route_prefix,
+                     const uint8_t prefix_length,
+                     const optional<Address> &next_hop,
+                     const size_t interface_num) {
+    lock_guard<mutex> lock{_mutex};
+    _table.insert(route_prefix, prefix_length, _next_hop_index(next_hop, interface_num));
+    _table.publish();
+    _generation++;
+}
+
+void RouteTable::add_multipath(const uint32_t route_prefix,
+                               const uint8_t prefix_length,
+                               const vector<Path> &paths) {
+    if (paths.empty() or paths.size() > GROUP_BUCKETS) {
+        throw runtime_error("RouteTable: a multipath route needs from 1 to " +
+                            to_string(GROUP_BUCKETS) + " paths");
+    }
+    lock_guard<mutex> lock{_mutex};
+    vector<uint16_t> next_hops;
+    for (const auto &path : paths) {
+        const auto index =
+            static_cast<uint16_t>(_next_hop_index(path.next_hop, path.interface_num));
+        if (find(next_hops.begin(), next_hops.end(), index) == next_hops.end()) {
+            next_hops.push_back(index);
+        }
+    }
+
+    optional<Buckets> old;
+    const auto value = _table.find(route_prefix, prefix_length);
+    if (value.has_value() and (*value & GROUP)) {
+        old = _groups[*value & ~GROUP];
+    } else if (value.has_value()) {
+        old.emplace();
+        old->fill(static_cast<uint16_t>(*value));
+    }
+
+    const PrefixTable::Value route = next_hops.size() == 1
+                                         ? next_hops.front()
+                                         : GROUP | _group_index(_rebalance(old, next_hops));
+    _table.insert(route_prefix, prefix_length, route);
+    _table.publish();
+    _generation++;
+}
+
+bool RouteTable::remove(const uint32_t route_prefix, const uint8_t prefix_length) {
+    lock_guard<mutex> lock{_mutex};
+    if (not _table.erase(route_prefix, prefix_length)) {
+        return false;
+    }
+    _table.publish();
+    _generation++;
+    return true;
+}
+
+//! \details The new routes are published together, so a reader sees either all of the old ones
+//! or all of the new ones.
+void RouteTable::replace(const vector<Route> &routes) {
+    lock_guard<mutex> lock{_mutex};
+    vector<PrefixTable::Entry> entries;
+    entries.reserve(routes.size());
+    for (const auto &route : routes) {
+        entries.push_back({route.route_prefix,
+                           route.prefix_length,
+                           _next_hop_index(route.next_hop, route.interface_num)});
+    }
+    _table.replace(entries);
+    _generation++;
+}
+
+//! \details A next hop is written before the table that refers to it is published, and
+//! `_next_hops` never reallocates, so readers can use it without holding the lock.
+uint32_t RouteTable::_next_hop_index(const optional<Address> &next_hop,
+                                     const size_t interface_num) {
+    optional<uint32_t> ip;
+    if (next_hop.has_value()) {
+        ip = next_hop->ipv4_numeric();
+    }
+    const auto [it, inserted] =
+        _next_hop_indices.try_emplace({ip, interface_num}, _next_hops.size());
+    if (inserted) {
+        if (_next_hops.size() == MAX_NEXT_HOPS) {
+            _next_hop_indices.erase(it);
+            throw runtime_error("RouteTable: too many next hops");
+        }
+        _next_hops.push_back({ip, interface_num});
+    }
+    return it->second;
+}
+
+uint32_t RouteTable::_group_index(const Buckets &buckets) {
+    const auto [it, inserted] = _group_indices.try_emplace(buckets, _groups.size());
+    if (inserted) {
+        if (_groups.size() == MAX_GROUPS) {
+            _group_indices.erase(it);
+            throw runtime_error("RouteTable: too many next-hop groups");
+        }
+        _groups.push_back(buckets);
+    }
+    return it->second;
+}
+
+//! \details Each next hop's share is GROUP_BUCKETS divided by their number, and the remainder
+//! goes one each to those that held the most buckets before. A bucket keeps its next hop if
+//! that is still in the group and short of its share; the others are handed to the next hops
+//! still short of theirs.
+RouteTable::Buckets RouteTable::_rebalance(const optional<Buckets> &old,
+                                           const vector<uint16_t> &next_hops) {
+    const size_t n = next_hops.size();
+    const auto position = [&](const uint16_t next_hop) {
+        return size_t(find(next_hops.begin(), next_hops.end(), next_hop) - next_hops.begin());
+    };
+
+    vector<size_t> held(n);
+    if (old.has_value()) {
+        for (const uint16_t next_hop : *old) {
+            const size_t k = position(next_hop);
+            if (k < n) {
+                held[k]++;
+            }
+        }
+    }
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b) {
+        return held[a] > held[b];
+    });
+    vector<size_t> share(n, GROUP_BUCKETS / n);
+    for (size_t i = 0; i < GROUP_BUCKETS % n; i++) {
+        share[order[i]]++;
+    }
+
+    Buckets buckets{};
+    vector<size_t> filled(n);
+    vector<size_t> unassigned;
+    for (size_t bucket = 0; bucket < GROUP_BUCKETS; bucket++) {
+        const size_t k = old.has_value() ? position((*old)[bucket]) : n;
+        if (k < n and filled[k] < share[k]) {
+            buckets[bucket] = next_hops[k];
+            filled[k]++;
+        } else {
+            unassigned.push_back(bucket);
+        }
+    }
+    size_t k = 0;
+    for (const size_t bucket : unassigned) {
+        while (filled[k] == share[k]) {
+            k++;
+        }
+        buckets[bucket] = next_hops[k];
+        filled[k]++;
+    }
+    return buckets;
+}
@@ -0,0 +1,168 @@
+#ifndef SPONGE_LIBSPONGE_ROUTE_TABLE_HH
+#define SPONGE_LIBSPONGE_ROUTE_TABLE_HH
+
+#include "address.hh"
+#include "epoch.hh"
+#include "flow_hash.hh"
+#include "ipv4_datagram.hh"
+#include "prefix_table.hh"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//! \brief A router's forwarding rules: which interface, and which next hop, each destination
+//! address goes to
+//! \details The longest matching prefix of an address is found in a PrefixTable, whose values
+//! index a list of the distinct next hops. Changes may come from any thread (they are
+//! serialized by a mutex), and each takes effect all at once. Any number of threads may look
+//! up routes meanwhile without waiting, each within a Guard of its own EpochDomain::Reader.
+//!
+//! A multipath route spreads its traffic over several equal-cost paths (ECMP). Its value in
+//! the PrefixTable indexes a group of GROUP_BUCKETS buckets, each holding one of the paths'
+//! next hops, and a datagram goes to the bucket its flow hashes to. Every datagram of a flow
+//! therefore takes the same path. The buckets are resilient: when the paths of a route change,
+//! only the buckets that must move to keep the shares even do, so only the flows in those
+//! buckets change paths. Adding a fourth path to three moves a quarter of the flows, all of
+//! them onto the new path, and removing a path moves only the flows that were on it.
+class RouteTable {
+  public:
+    //! A forwarding rule
+    struct Route {
+        uint32_t route_prefix;
+        uint8_t prefix_length;
+        std::optional<Address> next_hop;
+        size_t interface_num;
+    };
+
+    //! One of a multipath route's paths
+    struct Path {
+        std::optional<Address> next_hop;
+        size_t interface_num;
+    };
+
+    //! Where a route sends its datagrams
+    struct NextHop {
+        std::optional<uint32_t> ip;  //!< none if the network is directly attached
+        size_t interface_num;
+    };
+
+    static constexpr size_t GROUP_BUCKETS = 256;  //!< buckets a multipath route hashes flows to
+
+  private:
+    static constexpr size_t MAX_NEXT_HOPS = 1 << 16;
+    static constexpr size_t MAX_GROUPS = 1 << 12;
+    static constexpr PrefixTable::Value GROUP = 1U << 30;  //!< value indexes `_groups`
+
+    //! The index in `_next_hops` of each bucket's next hop
+    using Buckets = std::array<uint16_t, GROUP_BUCKETS>;
+
+    //! Every distinct next hop of any route so far, never reallocated or shrunk, so that
+    //! readers can use it while routes are added
+    std::vector<NextHop> _next_hops{};
+
+    //! index into `_next_hops` of each next hop (by IP address, or none) and interface
+    std::map<std::pair<std::optional<uint32_t>, size_t>, uint32_t> _next_hop_indices{};
+
+    //! Every distinct group of any multipath route so far, never reallocated or shrunk
+    std::vector<Buckets> _groups{};
+
+    //! index into `_groups` of each group
+    std::map<Buckets, uint32_t> _group_indices{};
+
+    //! For each address, the index into `_next_hops` of the longest prefix that matches it, or
+    //! `GROUP` plus an index into `_groups`
+    PrefixTable _table;
+
+    //! Hashes the flows of multipath routes
+    ToeplitzHash _hash{};
+
+    //! Held while the routes are being changed
+    std::mutex _mutex{};
+
+    //! Advanced after each change is published
+    std::atomic<uint64_t> _generation{1};
+
+    //! The index of a next hop in `_next_hops`, adding it if it is new
+    uint32_t _next_hop_index(const std::optional<Address> &next_hop, const size_t interface_num);
+
+    //! The index of a group in `_groups`, adding it if it is new
+    uint32_t _group_index(const Buckets &buckets);
+
+    //! \brief Share the buckets out evenly among `next_hops`
+    //! \param[in] old is the buckets before, if any, so that as few of them as can be move
+    static Buckets _rebalance(const std::optional<Buckets> &old,
+                              const std::vector<uint16_t> &next_hops);
+
+  public:
+    //! \param[in] max_chunks is the most chunks the PrefixTable of routes can use
+    explicit RouteTable(const size_t max_chunks = PrefixTable::DEFAULT_MAX_CHUNKS)
+        : _table(max_chunks) {
+        _next_hops.reserve(MAX_NEXT_HOPS);
+        _groups.reserve(MAX_GROUPS);
+    }
+
+    RouteTable(const RouteTable &other) = delete;
+    RouteTable &operator=(const RouteTable &other) = delete;
+
+    //! \name Changes
+    //!@{
+
+    //! Add a route, replacing any with the same prefix
+    void add(const uint32_t route_prefix,
+             const uint8_t prefix_length,
+             const std::optional<Address> &next_hop,
+             const size_t interface_num);
+
+    //! \brief Add a multipath route, replacing any with the same prefix
+    //! \details If the prefix already had a route, its flows keep their paths as far as they can.
+    //! \param[in] paths are the route's equal-cost paths, from 1 to GROUP_BUCKETS of them
+    void add_multipath(const uint32_t route_prefix,
+                       const uint8_t prefix_length,
+                       const std::vector<Path> &paths);
+
+    //! \brief Remove the route for `route_prefix`/`prefix_length`
+    //! \returns `false` if there is no such route
+    bool remove(const uint32_t route_prefix, const uint8_t prefix_length);
+
+    //! Replace every route with `routes`
+    void replace(const std::vector<Route> &routes);
+    //!@}
+
+    //! \name Lookups
+    //!@{
+
+    //! The domain that readers must enter before taking a snapshot()
+    EpochDomain &epochs() { return _table.epochs(); }
+
+    //! \brief The current routes, for a reader inside epochs()
+    //! \details A lookup in the snapshot finds the index of a next_hop().
+    PrefixTable::Snapshot snapshot() const { return _table.snapshot(); }
+
+    //! \brief A number that changes each time the routes do, and is never 0
+    //! \details Read before taking a snapshot(), it is no newer than the snapshot: anything
+    //! worked out from the snapshot is out of date once the number changes.
+    uint64_t generation() const { return _generation.load(); }
+
+    //! Is the route with a value found in a snapshot() a multipath one, whose next hop depends
+    //! on the flow and not just the destination?
+    bool multipath(const PrefixTable::Value value) const { return value & GROUP; }
+
+    //! \brief The next hop of `dgram`, whose route has a value found in a snapshot()
+    //! \details The datagram is only hashed if its route is a multipath one.
+    const NextHop &next_hop(const PrefixTable::Value value, const InternetDatagram &dgram) const {
+        if (value & GROUP) {
+            return _next_hops[_groups[value & ~GROUP][_hash(dgram) % GROUP_BUCKETS]];
+        }
+        return _next_hops[value];
+    }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_ROUTE_TABLE_HH
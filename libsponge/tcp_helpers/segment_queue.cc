@@ -0,0 +1,40 @@
+#include "segment_queue.hh"
+
+#include <utility>
+
+using namespace std;
+
+//! popped segments at the front worth moving the rest down for, in a queue that never empties
+static constexpr size_t RECLAIM_THRESHOLD = 64;
+
+//! \details Usually the queue has emptied and the vector is simply cleared. Otherwise the popped
+//! slots are dropped once they make up half the vector, so it stays bounded by twice the depth.
+void SegmentQueue::_reclaim() {
+    if (_front == _segments.size()) {
+        _segments.clear();
+        _front = 0;
+    } else if (_front >= RECLAIM_THRESHOLD and 2 * _front >= _segments.size()) {
+        _segments.erase(_segments.begin(), _segments.begin() + _front);
+        _front = 0;
+    }
+}
+
+void SegmentQueue::push(TCPSegment &&seg) {
+    _reclaim();
+    _segments.push_back(move(seg));
+}
+
+//! \details The popped segment's payload is released right away, as with std::queue.
+void SegmentQueue::pop() {
+    _segments[_front++] = TCPSegment{};
+    if (empty()) {
+        _reclaim();
+    }
+}
+
+SegmentQueue::Span SegmentQueue::drain() {
+    _reclaim();
+    Span ret{_segments.data() + _front, _segments.data() + _segments.size()};
+    _front = _segments.size();
+    return ret;
+}
@@ -0,0 +1,67 @@
+#ifndef SPONGE_LIBSPONGE_SEGMENT_QUEUE_HH
+#define SPONGE_LIBSPONGE_SEGMENT_QUEUE_HH
+
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <vector>
+
+//! \brief A FIFO queue of TCPSegments that recycles its storage
+//! \details The segments sit in one vector, front to back. Popping the last one empties the
+//! vector but keeps its capacity, so a queue that is filled and emptied over and over (as the
+//! TCPSender's and TCPConnection's are, once per event) stops allocating once it has seen its
+//! largest burst. Segments go in and come out by move, which copies the header and hands over
+//! the payload's storage without touching its reference count.
+//!
+//! drain() takes every queued segment at once, as a contiguous span.
+class SegmentQueue {
+  public:
+    //! \brief Segments taken by drain(), in order
+    //! \note Valid until the queue is next changed
+    class Span {
+      private:
+        TCPSegment *_begin;
+        TCPSegment *_end;
+
+      public:
+        Span(TCPSegment *begin, TCPSegment *end) : _begin(begin), _end(end) {}
+        Span(const Span &other) = default;
+        Span &operator=(const Span &other) = default;
+
+        TCPSegment *begin() const { return _begin; }
+        TCPSegment *end() const { return _end; }
+        size_t size() const { return _end - _begin; }
+        bool empty() const { return _begin == _end; }
+    };
+
+  private:
+    std::vector<TCPSegment> _segments{};
+    size_t _front{0};  //!< index of the front segment in `_segments`
+
+    //! Forget the segments already popped, if that is cheap or overdue
+    void _reclaim();
+
+  public:
+    //! \name std::queue interface
+    //!@{
+    bool empty() const { return _front == _segments.size(); }
+    size_t size() const { return _segments.size() - _front; }
+
+    TCPSegment &front() { return _segments[_front]; }
+    const TCPSegment &front() const { return _segments[_front]; }
+
+    TCPSegment &back() { return _segments.back(); }
+    const TCPSegment &back() const { return _segments.back(); }
+
+    void push(TCPSegment &&seg);
+    void push(const TCPSegment &seg) { push(TCPSegment{seg}); }
+    void pop();
+    //!@}
+
+    //! \brief Take every queued segment, leaving the queue empty
+    //! \details The segments can be moved out of the span; they are destroyed (and their
+    //! payloads released) when the queue is next changed.
+    Span drain();
+};
+
+#endif  // SPONGE_LIBSPONGE_SEGMENT_QUEUE_HH
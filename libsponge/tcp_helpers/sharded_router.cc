@@ -0,0 +1,264 @@
+#include "sharded_router.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! \details As in ShardedTCPEngine, the doorbell's rule is added once, here, so that a
+//! restarted worker does not have two rules draining the same eventfd.
+ShardedRouter::Port::Port(NetworkInterface &&network_interface)
+    : interface(move(network_interface))
+    , doorbell(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
+    eventloop.add_rule(doorbell, Direction::In, [this] { doorbell.read(sizeof(uint64_t)); });
+}
+
+bool ShardedRouter::Port::idle() const {
+    if (not inbox.empty() or not stalled.empty()) {
+        return false;
+    }
+    for (const auto &ring : forwarded) {
+        if (ring and not ring->empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ShardedRouter::ShardedRouter(OutputT output, const size_t max_route_chunks)
+    : _routes(max_route_chunks), _output(move(output)) {}
+
+ShardedRouter::~ShardedRouter() {
+    try {
+        stop();
+    } catch (const exception &e) {
+        cerr << "Exception stopping ShardedRouter: " << e.what() << endl;
+    }
+}
+
+size_t ShardedRouter::add_interface(NetworkInterface &&interface) {
+    if (_started) {
+        throw runtime_error("ShardedRouter::add_interface: workers are already running");
+    }
+    if (_ports.size() == EpochDomain::MAX_READERS) {
+        throw runtime_error("ShardedRouter::add_interface: too many interfaces");
+    }
+    _ports.push_back(make_unique<Port>(move(interface)));
+    return _ports.size() - 1;
+}
+
+//! \details Also sets up the rings from each worker to every other, now that all of the
+//! interfaces are known.
+void ShardedRouter::start() {
+    if (_started) {
+        throw runtime_error("ShardedRouter::start: workers are already running");
+    }
+    for (auto &target : _ports) {
+        if (target->forwarded.empty()) {
+            for (const auto &source : _ports) {
+                target->forwarded.push_back(
+                    source == target ? nullptr : make_unique<Handoff>(FORWARD_CAPACITY));
+            }
+            target->handed_off.resize(_ports.size());
+            target->blocked.resize(_ports.size());
+        }
+    }
+    _started = true;
+    _stop = false;
+    for (size_t i = 0; i < _ports.size(); i++) {
+        _ports[i]->thread = thread([this, i] { _port_main(i); });
+    }
+}
+
+void ShardedRouter::stop() {
+    if (not _started) {
+        return;
+    }
+    _stop = true;
+    for (auto &port : _ports) {
+        const uint64_t one = 1;
+        SystemCall("write", ::write(port->doorbell.fd_num(), &one, sizeof(one)));
+    }
+    for (auto &port : _ports) {
+        port->thread.join();
+    }
+    _started = false;
+}
+
+//! \details As in ShardedTCPEngine::_notify(), the fences guarantee that either the worker sees
+//! what was queued before it goes to sleep, or the producer sees that it is asleep.
+void ShardedRouter::_notify(Port &port) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (port.sleeping.load(memory_order_relaxed) and port.sleeping.exchange(false)) {
+        const uint64_t one = 1;
+        SystemCall("write", ::write(port.doorbell.fd_num(), &one, sizeof(one)));
+    }
+}
+
+bool ShardedRouter::deliver(const size_t interface_num, EthernetFrame &&frame) {
+    Port &port = *_ports.at(interface_num);
+    if (not port.inbox.push(move(frame))) {
+        return false;
+    }
+    _notify(port);
+    return true;
+}
+
+//! \details Once one datagram for a port has stalled, the ones after it stall too, so that they
+//! stay in order.
+void ShardedRouter::_hand_off(const size_t index,
+                              Port &port,
+                              const size_t out,
+                              Forwarded &&forwarded) {
+    if (not port.blocked[out] and _ports[out]->forwarded[index]->push(move(forwarded))) {
+        port.handed_off[out] = true;
+    } else {
+        port.blocked[out] = true;
+        port.stalled.emplace_back(out, move(forwarded));
+    }
+}
+
+void ShardedRouter::_retry_stalled(const size_t index, Port &port) {
+    swap(port.stalled, port.retrying);
+    fill(port.blocked.begin(), port.blocked.end(), false);
+    for (auto &[out, forwarded] : port.retrying) {
+        _hand_off(index, port, out, move(forwarded));
+    }
+    port.retrying.clear();
+    _notify_handed_off(port);
+}
+
+//! \details A datagram with no route, or routed to an interface the router does not have, is
+//! dropped. Each worker that was handed datagrams is woken once, after the whole burst.
+void ShardedRouter::_forward(const size_t index, Port &port, EpochDomain::Reader &reader) {
+    {
+        const EpochDomain::Guard guard{reader};
+        const auto table = _routes.snapshot();
+        port.burst_next_hops.resize(port.burst.size());
+        table.lookup(port.burst_dsts.data(), port.burst_dsts.size(), port.burst_next_hops.data());
+
+        for (size_t i = 0; i < port.burst.size(); i++) {
+            if (not port.burst_next_hops[i].has_value()) {
+                continue;
+            }
+            const auto &next_hop = _routes.next_hop(*port.burst_next_hops[i], port.burst[i]);
+            const size_t out = next_hop.interface_num;
+            Forwarded forwarded{next_hop.ip.value_or(port.burst_dsts[i]), move(port.burst[i])};
+            if (out == index) {
+                port.egress.push_back(move(forwarded));
+            } else if (out < _ports.size()) {
+                _hand_off(index, port, out, move(forwarded));
+            }
+        }
+    }
+    _notify_handed_off(port);
+}
+
+void ShardedRouter::_notify_handed_off(Port &port) {
+    for (size_t out = 0; out < _ports.size(); out++) {
+        if (port.handed_off[out]) {
+            port.handed_off[out] = false;
+            _notify(*_ports[out]);
+        }
+    }
+}
+
+//! \details The datagrams for each next hop go out in the order they were queued, so no flow
+//! is reordered.
+void ShardedRouter::_send(Port &port) {
+    port.egress_order.clear();
+    for (size_t i = 0; i < port.egress.size(); i++) {
+        port.egress_order.emplace_back(port.egress[i].next_hop_ip, i);
+    }
+    sort(port.egress_order.begin(), port.egress_order.end());
+
+    for (auto first = port.egress_order.begin(); first != port.egress_order.end();) {
+        const auto last = find_if(first, port.egress_order.end(), [&](const auto &entry) {
+            return entry.first != first->first;
+        });
+        port.egress_group.clear();
+        for (auto it = first; it != last; it++) {
+            port.egress_group.push_back(move(port.egress[it->second].dgram));
+        }
+        port.interface.send_datagrams(port.egress_group.data(),
+                                      port.egress_group.size(),
+                                      Address::from_ipv4_numeric(first->first));
+        first = last;
+    }
+    port.egress.clear();
+}
+
+//! \details While any datagrams are stalled, no new frames are taken. The rings into this
+//! worker are drained regardless, so two workers stalled on each other still make progress.
+void ShardedRouter::_process(const size_t index, Port &port, EpochDomain::Reader &reader) {
+    if (not port.stalled.empty()) {
+        _retry_stalled(index, port);
+    }
+
+    // frames received on this interface: the interface handles ARP, and IPv4 is routed
+    port.burst.clear();
+    port.burst_dsts.clear();
+    EthernetFrame frame;
+    for (size_t n = 0; n < MAX_BATCH and port.stalled.empty() and port.inbox.pop(frame); n++) {
+        auto dgram = port.interface.recv_frame(frame);
+        if (dgram.has_value() and as_const(*dgram).header().ttl > 1) {
+            dgram->decrement_ttl();
+            port.burst_dsts.push_back(as_const(*dgram).header().dst);
+            port.burst.push_back(move(*dgram));
+        }
+    }
+    if (not port.burst.empty()) {
+        _forward(index, port, reader);
+    }
+
+    // datagrams leaving by this interface, from the other workers
+    Forwarded forwarded;
+    for (auto &ring : port.forwarded) {
+        for (size_t n = 0; ring and n < MAX_BATCH and ring->pop(forwarded); n++) {
+            port.egress.push_back(move(forwarded));
+        }
+    }
+    _send(port);
+
+    auto &frames_out = port.interface.frames_out();
+    if (frames_out.empty()) {
+        return;
+    }
+    while (not frames_out.empty()) {
+        port.frames.push_back(move(frames_out.front()));
+        frames_out.pop();
+    }
+    _output(index, port.frames);
+    port.frames.clear();
+}
+
+void ShardedRouter::_port_main(const size_t index) {
+    Port &port = *_ports[index];
+    EpochDomain::Reader reader{_routes.epochs()};
+
+    uint64_t last_tick_ms = timestamp_ms();
+    while (not _stop) {
+        const uint64_t now = timestamp_ms();
+        if (now > last_tick_ms) {
+            port.interface.tick(now - last_tick_ms);
+            last_tick_ms = now;
+        }
+
+        _process(index, port, reader);
+
+        port.sleeping = true;
+        atomic_thread_fence(memory_order_seq_cst);
+        if (port.idle() and not _stop) {
+            port.eventloop.wait_next_event(TICK_MS);
+        } else if (not port.stalled.empty()) {
+            // waiting for another worker to make room
+            this_thread::yield();
+        }
+        port.sleeping = false;
+    }
+}
@@ -0,0 +1,194 @@
+#ifndef SPONGE_LIBSPONGE_SHARDED_ROUTER_HH
+#define SPONGE_LIBSPONGE_SHARDED_ROUTER_HH
+
+#include "epoch.hh"
+#include "ethernet_frame.hh"
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface.hh"
+#include "prefix_table.hh"
+#include "route_table.hh"
+#include "spsc_ring.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//! \brief A router that forwards on one worker thread per interface
+//! \details Each interface belongs to a worker, which is the only thread that ever touches its
+//! NetworkInterface. The interface's ARP cache and its datagrams waiting for ARP replies are
+//! therefore never shared, and need no locks. The routes are shared by every worker, in a
+//! RouteTable that they read without locks.
+//!
+//! Frames received on an interface travel to its worker over a lock-free SPSC ring. The worker
+//! answers ARP itself. It routes IPv4 datagrams in bursts, as Router::route() does, and hands
+//! each one to the worker of its egress interface over another SPSC ring. There is one such
+//! ring for each pair of workers, so together the rings into a worker make an MPSC queue
+//! whose producers never contend. The egress worker resolves each next hop's Ethernet
+//! address and passes its interface's frames to the output function, on its own thread.
+//!
+//! Nothing is dropped between workers. A worker whose ring to another is full keeps the
+//! datagrams it could not hand off, and takes no more frames until they are through, so the
+//! backpressure reaches deliver().
+//!
+//! Datagrams cross threads, so the frames given to deliver() must not be backed by a
+//! BufferPool (whose reference counts are not atomic).
+//!
+//! Threading rules: add_interface(), start() and stop() must be called from one thread (the
+//! owner). The routes may be changed from any thread. Each interface's frames must be
+//! delivered by one thread at a time, though different interfaces may use different threads.
+class ShardedRouter {
+  public:
+    //! Frames for one interface to send
+    using Frames = std::vector<EthernetFrame>;
+
+    //! Sends an interface's frames; called on that interface's worker thread
+    using OutputT = std::function<void(const size_t interface_num, Frames &frames)>;
+
+    static constexpr size_t RING_CAPACITY = 4096;     //!< frames queued to a worker before drops
+    static constexpr size_t FORWARD_CAPACITY = 1024;  //!< datagrams queued from worker to worker
+    static constexpr size_t MAX_BATCH = 256;          //!< frames handled per round, per ring
+    static constexpr int TICK_MS = 1000;              //!< how often an idle worker ticks ARP
+
+  private:
+    //! A datagram on its way to the worker of its egress interface
+    struct Forwarded {
+        uint32_t next_hop_ip{};
+        InternetDatagram dgram{};
+    };
+
+    using Inbox = SPSCRing<EthernetFrame>;
+    using Handoff = SPSCRing<Forwarded>;
+
+    //! An interface and the worker that serves it
+    struct Port {
+        NetworkInterface interface;
+        EventLoop eventloop{};
+        FileDescriptor doorbell;  //!< eventfd that wakes the worker's event loop
+        Inbox inbox{RING_CAPACITY};
+        std::vector<std::unique_ptr<Handoff>> forwarded{};  //!< from each other port's worker
+        std::atomic<bool> sleeping{false};                  //!< the worker may be asleep
+        std::thread thread{};
+
+        //! \name The worker's scratch space, kept between rounds so as not to allocate
+        //!@{
+        std::vector<InternetDatagram> burst{};
+        std::vector<uint32_t> burst_dsts{};
+        std::vector<std::optional<PrefixTable::Value>> burst_next_hops{};
+        std::vector<bool> handed_off{};                           //!< to each port, this round
+        std::vector<bool> blocked{};                              //!< ring to each port is full
+        std::vector<std::pair<size_t, Forwarded>> stalled{};      //!< for full rings, in order
+        std::vector<std::pair<size_t, Forwarded>> retrying{};     //!< stalled, being retried
+        std::vector<Forwarded> egress{};                          //!< to send from this interface
+        std::vector<std::pair<uint32_t, size_t>> egress_order{};  //!< next hop and index
+        std::vector<InternetDatagram> egress_group{};
+        Frames frames{};
+        //!@}
+
+        explicit Port(NetworkInterface &&network_interface);
+
+        //! Is anything queued for the worker?
+        bool idle() const;
+    };
+
+    RouteTable _routes;
+    std::vector<std::unique_ptr<Port>> _ports{};
+    OutputT _output;
+    std::atomic<bool> _stop{false};
+    bool _started{false};
+
+    //! Wake a port's worker if it is (or is about to be) asleep
+    void _notify(Port &port);
+
+    //! Hand a datagram to the worker of interface `out`, or stall it if the ring is full
+    void _hand_off(const size_t index, Port &port, const size_t out, Forwarded &&forwarded);
+
+    //! Hand off the stalled datagrams that now fit, and wake the workers they went to
+    void _retry_stalled(const size_t index, Port &port);
+
+    //! Wake the workers that `port` handed datagrams to since the last call
+    void _notify_handed_off(Port &port);
+
+    //! Route a burst of received datagrams, handing each to its egress interface's worker
+    void _forward(const size_t index, Port &port, EpochDomain::Reader &reader);
+
+    //! Send the datagrams in `port.egress`, a group per next hop
+    void _send(Port &port);
+
+    //! Drain a port's rings, route and send what they held, and output the frames that result
+    void _process(const size_t index, Port &port, EpochDomain::Reader &reader);
+
+    //! Body of each worker thread
+    void _port_main(const size_t index);
+
+  public:
+    //! \param[in] output sends each batch of an interface's frames
+    //! \param[in] max_route_chunks is the most chunks the routes' PrefixTable can use
+    explicit ShardedRouter(OutputT output,
+                           const size_t max_route_chunks = PrefixTable::DEFAULT_MAX_CHUNKS);
+
+    //! Stops the worker threads
+    ~ShardedRouter();
+
+    ShardedRouter(const ShardedRouter &other) = delete;
+    ShardedRouter &operator=(const ShardedRouter &other) = delete;
+
+    //! \name Methods for the owner
+    //!@{
+
+    //! \brief Add an interface, with a worker of its own (only before start())
+    //! \returns The index of the interface
+    size_t add_interface(NetworkInterface &&interface);
+
+    //! Start the worker threads
+    void start();
+
+    //! Stop and join the worker threads
+    void stop();
+    //!@}
+
+    //! \name Route changes, from any thread
+    //! Each takes effect all at once, without holding up the workers.
+    //!@{
+
+    //! Add a route (a forwarding rule)
+    void add_route(const uint32_t route_prefix,
+                   const uint8_t prefix_length,
+                   const std::optional<Address> next_hop,
+                   const size_t interface_num) {
+        _routes.add(route_prefix, prefix_length, next_hop, interface_num);
+    }
+
+    //! Add a route that spreads flows over equal-cost paths
+    void add_multipath_route(const uint32_t route_prefix,
+                             const uint8_t prefix_length,
+                             const std::vector<RouteTable::Path> &paths) {
+        _routes.add_multipath(route_prefix, prefix_length, paths);
+    }
+
+    //! \brief Remove the route for `route_prefix`/`prefix_length`
+    //! \returns `false` if there is no such route
+    bool remove_route(const uint32_t route_prefix, const uint8_t prefix_length) {
+        return _routes.remove(route_prefix, prefix_length);
+    }
+
+    //! Replace every route with `routes`
+    void replace_routes(const std::vector<RouteTable::Route> &routes) { _routes.replace(routes); }
+    //!@}
+
+    //! \brief Hand a frame received on an interface to its worker
+    //! \returns `false`, leaving `frame` untouched, if the worker's ring is full
+    bool deliver(const size_t interface_num, EthernetFrame &&frame);
+
+    //! Number of interfaces
+    size_t size() const { return _ports.size(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_SHARDED_ROUTER_HH
@@ -0,0 +1,296 @@
+#include "sharded_tcp_engine.hh"
+
+#include "util.hh"
+
+#include <iostream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! \details The doorbell's rule is added here, once, so that a restarted shard does not end
+//! up with two rules draining the same eventfd.
+ShardedTCPEngine::Shard::Shard()
+    : doorbell(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {
+    eventloop.add_rule(doorbell, Direction::In, [this] { doorbell.read(sizeof(uint64_t)); });
+}
+
+bool ShardedTCPEngine::Shard::idle() const {
+    if (not inbox.empty() or not commands.empty()) {
+        return false;
+    }
+    for (const auto &ring : forwarded) {
+        if (ring and not ring->empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ShardedTCPEngine::ShardedTCPEngine(const size_t n_shards, OutputT output, CallbackT callback)
+    : _output(move(output)), _callback(move(callback)) {
+    if (n_shards == 0 or n_shards > RETA_SIZE) {
+        throw invalid_argument("ShardedTCPEngine: number of shards must be between 1 and 128");
+    }
+    for (size_t i = 0; i < n_shards; i++) {
+        _shards.push_back(make_unique<Shard>());
+    }
+    for (size_t i = 0; i < RETA_SIZE; i++) {
+        _reta[i] = i % n_shards;
+    }
+}
+
+ShardedTCPEngine::~ShardedTCPEngine() {
+    try {
+        stop();
+    } catch (const exception &e) {
+        cerr << "Exception stopping ShardedTCPEngine: " << e.what() << endl;
+    }
+}
+
+void ShardedTCPEngine::listen(const uint16_t port, const TCPConfig &config, const size_t backlog) {
+    if (_started) {
+        throw runtime_error("ShardedTCPEngine::listen: shards are already running");
+    }
+    for (auto &shard : _shards) {
+        shard->engine.listen(port, config, backlog);
+    }
+}
+
+//! \details The callback typically reads a segment from `fd` and passes it to receive_on(). The
+//! first call also sets up the rings that carry segments from each shard to every other.
+void ShardedTCPEngine::watch(const size_t shard,
+                             const FileDescriptor &fd,
+                             const function<void()> &callback) {
+    if (_started) {
+        throw runtime_error("ShardedTCPEngine::watch: shards are already running");
+    }
+    if (_shards.front()->forwarded.empty()) {
+        for (auto &target : _shards) {
+            for (const auto &source : _shards) {
+                target->forwarded.push_back(
+                    source == target ? nullptr : make_unique<Inbox>(FORWARD_CAPACITY));
+            }
+        }
+    }
+    Shard &target = *_shards.at(shard);
+    target.eventloop.add_rule(fd, Direction::In, callback);
+    target.watching = true;
+}
+
+void ShardedTCPEngine::start() {
+    if (_started) {
+        throw runtime_error("ShardedTCPEngine::start: shards are already running");
+    }
+    _started = true;
+    _stop = false;
+    for (size_t i = 0; i < _shards.size(); i++) {
+        _shards[i]->thread = thread([this, i] { _shard_main(i); });
+    }
+}
+
+void ShardedTCPEngine::stop() {
+    if (not _started) {
+        return;
+    }
+    _stop = true;
+    for (auto &shard : _shards) {
+        const uint64_t one = 1;
+        SystemCall("write", ::write(shard->doorbell.fd_num(), &one, sizeof(one)));
+    }
+    for (auto &shard : _shards) {
+        shard->thread.join();
+    }
+    _started = false;
+}
+
+//! \details Pairs with the check in _shard_main(): the shard announces that it is going to
+//! sleep and then looks at its queues once more, while the producer publishes to a queue and
+//! then looks at the announcement. The fences guarantee at least one side sees the other, so
+//! a wakeup is never lost; the doorbell is only rung for a shard that may really be asleep.
+void ShardedTCPEngine::_notify(Shard &shard) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (shard.sleeping.load(memory_order_relaxed) and shard.sleeping.exchange(false)) {
+        const uint64_t one = 1;
+        SystemCall("write", ::write(shard.doorbell.fd_num(), &one, sizeof(one)));
+    }
+}
+
+bool ShardedTCPEngine::run_on(const size_t shard, CommandT command) {
+    Shard &target = *_shards.at(shard);
+    if (not target.commands.push(move(command))) {
+        return false;
+    }
+    _notify(target);
+    return true;
+}
+
+bool ShardedTCPEngine::connect(const FourTuple &id, const TCPConfig &config) {
+    return run_on(shard_of(id), [id, config](TCPEngine &engine) { engine.connect(id, config); });
+}
+
+bool ShardedTCPEngine::deliver(const FourTuple &id, TCPSegment &&seg) {
+    Shard &target = *_shards[shard_of(id)];
+    pair<FourTuple, TCPSegment> item{id, move(seg)};
+    if (not target.inbox.push(move(item))) {
+        seg = move(item.second);
+        return false;
+    }
+    _notify(target);
+    return true;
+}
+
+bool ShardedTCPEngine::receive_on(const size_t shard, const FourTuple &id, TCPSegment &&seg) {
+    const size_t owner = shard_of(id);
+    if (owner == shard) {
+        _shards[shard]->engine.segment_received(id, seg);
+        return true;
+    }
+
+    Buffer &payload = seg.mutable_payload();
+    payload = payload.size() > 0 ? Buffer{payload.copy()} : Buffer{};
+
+    Shard &target = *_shards[owner];
+    pair<FourTuple, TCPSegment> item{id, move(seg)};
+    if (not target.forwarded[shard]->push(move(item))) {
+        seg = move(item.second);
+        return false;
+    }
+    _shards[shard]->forwarded_out++;
+    _notify(target);
+    return true;
+}
+
+size_t ShardedTCPEngine::forwarded() const {
+    size_t ret = 0;
+    for (const auto &shard : _shards) {
+        ret += shard->forwarded_out;
+    }
+    return ret;
+}
+
+void ShardedTCPEngine::_process(const size_t index, Shard &shard) {
+    CommandT command;
+    while (shard.commands.pop(command)) {
+        command(shard.engine);
+    }
+
+    // bounded, so the application gets to read between batches even under a steady stream
+    pair<FourTuple, TCPSegment> item;
+    for (size_t n = 0; n < MAX_BATCH and shard.inbox.pop(item); n++) {
+        shard.engine.segment_received(item.first, item.second);
+    }
+    for (auto &ring : shard.forwarded) {
+        for (size_t n = 0; ring and n < MAX_BATCH and ring->pop(item); n++) {
+            shard.engine.segment_received(item.first, item.second);
+        }
+    }
+
+    if (_callback) {
+        _callback(index, shard.engine);
+    }
+
+    auto &segs_out = shard.engine.segments_out();
+    if (segs_out.empty()) {
+        return;
+    }
+    while (not segs_out.empty()) {
+        shard.batch.push_back(move(segs_out.front()));
+        segs_out.pop();
+    }
+    _output(index, shard.batch);
+    shard.batch.clear();
+}
+
+void ShardedTCPEngine::_shard_main(const size_t index) {
+    Shard &shard = *_shards[index];
+
+    uint64_t last_tick_ms = timestamp_ms();
+    while (not _stop) {
+        const uint64_t now = timestamp_ms();
+        if (now > last_tick_ms) {
+            shard.engine.tick(now - last_tick_ms);
+            last_tick_ms = now;
+        }
+
+        _process(index, shard);
+
+        shard.sleeping = true;
+        atomic_thread_fence(memory_order_seq_cst);
+        if (shard.idle() and not _stop) {
+            // sleep until rung, until a watched fd is readable, or until the next timer expires
+            const auto deadline = shard.engine.next_deadline_ms();
+            shard.eventloop.wait_next_event(deadline.has_value() ? int(deadline.value()) : -1);
+        } else if (shard.watching) {
+            // still busy, but don't starve the watched fds
+            shard.eventloop.wait_next_event(0);
+        }
+        shard.sleeping = false;
+    }
+}
+
+ShardedTCPOverIPv4Engine::ShardedTCPOverIPv4Engine(TunFD &&tun,
+                                                   const size_t n_shards,
+                                                   ShardedTCPEngine::CallbackT callback)
+    : _adapter(move(tun))
+    , _packets(n_shards)
+    , _engine(
+          n_shards,
+          [this](const size_t shard, ShardedTCPEngine::Batch &batch) {
+              for (auto &[id, seg] : batch) {
+                  TCPOverIPv4Adapter::wrap_tcp_in_ip(seg, id, _packets[shard]);
+                  _tx[shard].write(_packets[shard].release().str());
+              }
+          },
+          move(callback)) {
+    for (size_t i = 0; i < n_shards; i++) {
+        _tx.emplace_back(SystemCall("dup", ::dup(static_cast<TunFD &>(_adapter).fd_num())));
+    }
+
+    // the segments go to other threads, so they are read into storage of their own (not into the
+    // adapter's BufferPool)
+    _eventloop.add_rule(_adapter, Direction::In, [&] {
+        InternetDatagram ip_dgram;
+        if (ip_dgram.parse(static_cast<TunFD &>(_adapter).read()) != ParseResult::NoError) {
+            return;
+        }
+        auto demuxed = TCPOverIPv4Adapter::demux_tcp_in_ip(ip_dgram);
+        if (demuxed) {
+            _engine.deliver(demuxed->first, move(demuxed->second));
+        }
+    });
+}
+
+//! \param[in] timeout_ms is passed to EventLoop::wait_next_event
+//! \returns the result of EventLoop::wait_next_event
+EventLoop::Result ShardedTCPOverIPv4Engine::wait_next_event(const int timeout_ms) {
+    return _eventloop.wait_next_event(timeout_ms);
+}
+
+//! \details Opens every queue before starting anything, so a device without `multi_queue` fails
+//! here rather than on a worker thread.
+MultiQueueTCPOverIPv4Engine::MultiQueueTCPOverIPv4Engine(const string &devname,
+                                                         const size_t n_queues,
+                                                         ShardedTCPEngine::CallbackT callback)
+    : _engine(
+          n_queues,
+          [this](const size_t shard, ShardedTCPEngine::Batch &batch) {
+              for (auto &[id, seg] : batch) {
+                  _queues[shard].write(seg, id);
+              }
+          },
+          move(callback)) {
+    for (size_t i = 0; i < n_queues; i++) {
+        _queues.emplace_back(TunFD(devname, true));
+    }
+
+    for (size_t i = 0; i < n_queues; i++) {
+        _engine.watch(i, static_cast<TunFD &>(_queues[i]), [this, i] {
+            auto demuxed = _queues[i].demux_read();
+            if (demuxed) {
+                _engine.receive_on(i, demuxed->first, move(demuxed->second));
+            }
+        });
+    }
+}
@@ -0,0 +1,217 @@
+#ifndef SPONGE_LIBSPONGE_SHARDED_TCP_ENGINE_HH
+#define SPONGE_LIBSPONGE_SHARDED_TCP_ENGINE_HH
+
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "flow_hash.hh"
+#include "four_tuple.hh"
+#include "spsc_ring.hh"
+#include "tcp_engine.hh"
+#include "tcp_segment.hh"
+#include "tuntap_adapter.hh"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//! \brief TCPEngine split across worker threads, one per core, sharing nothing
+//! \details Each shard owns a disjoint set of connections, its own TCPEngine and its own
+//! EventLoop, and runs on its own thread. Incoming segments are steered to a shard the way an
+//! RSS-capable NIC steers them to a queue: the Toeplitz hash of the 4-tuple indexes an
+//! indirection table of shard numbers. They travel to the shard over a lock-free SPSC ring,
+//! so every segment of a connection is processed by the same thread and no connection state
+//! is ever shared or locked.
+//!
+//! Outgoing segments are not funneled back through one thread: after each batch of events a
+//! shard hands everything its engine produced to the output function, on the shard's thread.
+//!
+//! Incoming segments need not come through a dispatcher either. A shard can watch() its own
+//! source of segments (e.g. one queue of a multi-queue TUN device) and pass what it reads to
+//! receive_on(); a segment that belongs to another shard is forwarded over a ring from the
+//! receiving shard to the owner.
+//!
+//! Threading rules: deliver() must always be called from one thread (the dispatcher), and
+//! listen(), watch(), run_on(), connect(), start() and stop() from one thread (the owner),
+//! which may be the same as the dispatcher. receive_on() is for the shards' own threads.
+class ShardedTCPEngine {
+  public:
+    //! Outgoing segments from one shard, each with the connection it belongs to
+    using Batch = std::vector<std::pair<FourTuple, TCPSegment>>;
+
+    //! Sends a shard's batch; called on that shard's thread
+    using OutputT = std::function<void(const size_t shard, Batch &batch)>;
+
+    //! Runs the application on a shard's thread after each round of events
+    using CallbackT = std::function<void(const size_t shard, TCPEngine &engine)>;
+
+    //! Work to run against one shard's engine, on that shard's thread
+    using CommandT = std::function<void(TCPEngine &engine)>;
+
+    static constexpr size_t RING_CAPACITY = 4096;    //!< segments queued to a shard before drops
+    static constexpr size_t MAX_BATCH = 256;         //!< segments handled per round of events
+    static constexpr size_t RETA_SIZE = 128;         //!< entries in the indirection table
+    static constexpr size_t FORWARD_CAPACITY = 256;  //!< segments queued from shard to shard
+
+  private:
+    using Inbox = SPSCRing<std::pair<FourTuple, TCPSegment>>;
+
+    struct Shard {
+        TCPEngine engine{};
+        EventLoop eventloop{};
+        FileDescriptor doorbell;  //!< eventfd that wakes the shard's event loop
+        Inbox inbox{RING_CAPACITY};
+        std::vector<std::unique_ptr<Inbox>> forwarded{};  //!< from each other shard, if watching
+        SPSCRing<CommandT> commands{64};
+        std::atomic<bool> sleeping{false};  //!< the shard may be blocked on its doorbell
+        bool watching{false};               //!< the event loop has rules besides the doorbell
+        size_t forwarded_out{0};            //!< segments received here but owned elsewhere
+        Batch batch{};
+        std::thread thread{};
+
+        Shard();
+
+        //! Is anything queued for the shard?
+        bool idle() const;
+    };
+
+    ToeplitzHash _hash{};
+    std::array<uint8_t, RETA_SIZE> _reta{};
+    std::vector<std::unique_ptr<Shard>> _shards{};
+    OutputT _output;
+    CallbackT _callback;
+    std::atomic<bool> _stop{false};
+    bool _started{false};
+
+    //! Wake a shard if it is (or is about to be) asleep
+    void _notify(Shard &shard);
+
+    //! Drain a shard's queues, run the application, and send what results
+    void _process(const size_t index, Shard &shard);
+
+    //! Body of each worker thread
+    void _shard_main(const size_t index);
+
+  public:
+    //! \param[in] n_shards is the number of worker threads
+    //! \param[in] output sends each batch of outgoing segments
+    //! \param[in] callback runs the application on each shard (optional)
+    ShardedTCPEngine(const size_t n_shards, OutputT output, CallbackT callback = {});
+
+    //! Stops the worker threads
+    ~ShardedTCPEngine();
+
+    ShardedTCPEngine(const ShardedTCPEngine &other) = delete;
+    ShardedTCPEngine &operator=(const ShardedTCPEngine &other) = delete;
+
+    //! \name Methods for the owner
+    //!@{
+
+    //! Accept connections to `port` on every shard (only before start())
+    void listen(const uint16_t port, const TCPConfig &config = {}, const size_t backlog = 16);
+
+    //! Run `callback` on a shard's thread whenever `fd` is readable (only before start())
+    void watch(const size_t shard, const FileDescriptor &fd, const std::function<void()> &callback);
+
+    //! Start the worker threads
+    void start();
+
+    //! Stop and join the worker threads
+    void stop();
+
+    //! Run `command` on a shard's thread
+    //! \returns `false` if the shard's command queue is full
+    bool run_on(const size_t shard, CommandT command);
+
+    //! Open a connection on the shard its segments will be steered to
+    bool connect(const FourTuple &id, const TCPConfig &config = {});
+    //!@}
+
+    //! \name Methods for the dispatcher
+    //!@{
+
+    //! \returns the shard that handles connection `id`
+    size_t shard_of(const FourTuple &id) const { return _reta[_hash(id) % RETA_SIZE]; }
+
+    //! Steer a received segment to its shard
+    //! \returns `false`, leaving `seg` untouched, if the shard's ring is full
+    bool deliver(const FourTuple &id, TCPSegment &&seg);
+    //!@}
+
+    //! \name Methods for the shards' threads
+    //!@{
+
+    //! \brief Handle a segment that `shard` received, forwarding it if another shard owns it
+    //! \details A forwarded segment's payload is first copied out of whatever storage it was
+    //! read into: a BufferPool's blocks must stay on the thread that allocated them.
+    //! \returns `false`, leaving `seg`'s contents unchanged, if the owner's ring was full
+    bool receive_on(const size_t shard, const FourTuple &id, TCPSegment &&seg);
+    //!@}
+
+    //! Number of shards
+    size_t size() const { return _shards.size(); }
+
+    //! Segments that receive_on() forwarded from one shard to another (only while stopped)
+    size_t forwarded() const;
+};
+
+//! \brief A ShardedTCPEngine serving every connection on one TUN device
+//! \details The thread calling wait_next_event() reads datagrams and steers them to the
+//! shards. Each shard builds its own outgoing datagrams and writes them through its own
+//! duplicate of the TUN file descriptor, so sending never crosses threads.
+class ShardedTCPOverIPv4Engine {
+  private:
+    TCPOverIPv4OverTunFdAdapter _adapter;
+    std::vector<FileDescriptor> _tx{};
+    std::vector<PacketBuilder> _packets;  //!< one per shard
+    ShardedTCPEngine _engine;
+    EventLoop _eventloop{};
+
+  public:
+    //! \param[in] tun is the TUN device that carries every connection's datagrams
+    //! \param[in] n_shards is the number of worker threads
+    //! \param[in] callback runs the application on each shard
+    ShardedTCPOverIPv4Engine(TunFD &&tun,
+                             const size_t n_shards,
+                             ShardedTCPEngine::CallbackT callback);
+
+    //! Access the sharded engine to listen, connect, start and stop
+    ShardedTCPEngine &engine() { return _engine; }
+
+    //! Wait for incoming datagrams and steer them to the shards
+    EventLoop::Result wait_next_event(const int timeout_ms);
+};
+
+//! \brief A ShardedTCPEngine serving every connection on one multi-queue TUN device
+//! \details Unlike ShardedTCPOverIPv4Engine, nothing runs on the caller's thread: each shard
+//! opens its own queue of the device, reads it from its own event loop, and writes its own
+//! outgoing datagrams through it. Because the kernel steers a flow's packets to the queue that
+//! last wrote the flow, a connection's datagrams arrive on its own shard's queue from the first
+//! reply on, and only the occasional early one (e.g. a SYN) is forwarded between shards.
+//!
+//! The device must have been created with `multi_queue`, e.g.
+//!
+//!     ip tuntap add mode tun multi_queue user `username` name `devname`
+class MultiQueueTCPOverIPv4Engine {
+  private:
+    std::vector<TCPOverIPv4OverTunFdAdapter> _queues{};
+    ShardedTCPEngine _engine;
+
+  public:
+    //! \param[in] devname is the name of the multi-queue TUN device
+    //! \param[in] n_queues is the number of queues to open, and of worker threads
+    //! \param[in] callback runs the application on each shard
+    MultiQueueTCPOverIPv4Engine(const std::string &devname,
+                                const size_t n_queues,
+                                ShardedTCPEngine::CallbackT callback);
+
+    //! Access the sharded engine to listen, connect, start and stop
+    ShardedTCPEngine &engine() { return _engine; }
+};
+
+#endif  // SPONGE_LIBSPONGE_SHARDED_TCP_ENGINE_HH
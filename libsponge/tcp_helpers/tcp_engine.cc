@@ -0,0 +1,220 @@
+#include "tcp_engine.hh"
+
+#include "util.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+TCPEngine::Entry &TCPEngine::_entry(const FourTuple &id) {
+    auto *const entry = _connections.find(id);
+    if (entry == nullptr) {
+        throw out_of_range("TCPEngine: no such connection");
+    }
+    return **entry;
+}
+
+void TCPEngine::_sync(Entry &entry) {
+    if (_now_ms > entry.synced_ms) {
+        entry.tcp.tick(_now_ms - entry.synced_ms);
+        entry.synced_ms = _now_ms;
+    }
+}
+
+void TCPEngine::_erase(const FourTuple &id, Entry &entry) {
+    _timers.cancel(entry.timer);
+    _connections.erase(id);
+}
+
+//! \param[in] id is the connection that just handled an event
+//! \param[in] entry is its table entry (erased by this call if the connection is finished)
+void TCPEngine::_after_event(const FourTuple &id, Entry &entry) {
+    for (auto &seg : entry.tcp.segments_out().drain()) {
+        _segments_out.emplace(id, move(seg));
+    }
+
+    if (entry.embryonic) {
+        auto &listener = _listeners.at(id.local_port);
+        if (not entry.tcp.active()) {
+            --listener.pending;
+            _erase(id, entry);
+            return;
+        }
+        const auto state = entry.tcp.state();
+        if (state == TCPState::State::ESTABLISHED or state == TCPState::State::CLOSE_WAIT) {
+            entry.embryonic = false;
+            listener.accept_queue.push(id);
+        }
+    } else if (entry.released and not entry.tcp.active()) {
+        _erase(id, entry);
+        return;
+    }
+
+    _timers.cancel(entry.timer);
+    entry.timer = TimingWheel<FourTuple>::NONE;
+    const auto next = entry.tcp.next_timer_ms();
+    if (next.has_value()) {
+        entry.timer = _timers.schedule(_now_ms + next.value(), id);
+    }
+}
+
+//! \param[in] port is the local port to accept connections on
+//! \param[in] config is the TCPConfig for each accepted connection
+//! \param[in] backlog is the maximum number of connections being set up or waiting to be accepted
+void TCPEngine::listen(const uint16_t port, const TCPConfig &config, const size_t backlog) {
+    if (not _listeners.emplace(port, Listener{config, backlog}).second) {
+        throw runtime_error("TCPEngine::listen: port is already listening");
+    }
+}
+
+//! \param[in] id is the new connection (local and remote address and port)
+//! \param[in] config is the TCPConfig for the connection
+void TCPEngine::connect(const FourTuple &id, const TCPConfig &config) {
+    const auto [entry, inserted] =
+        _connections.emplace(id, make_unique<Entry>(config, false, _now_ms));
+    if (not inserted) {
+        throw runtime_error("TCPEngine::connect: connection already exists");
+    }
+    (*entry)->tcp.connect();
+    _after_event(id, **entry);
+}
+
+optional<FourTuple> TCPEngine::accept(const uint16_t port) {
+    const auto it = _listeners.find(port);
+    if (it == _listeners.end() or it->second.accept_queue.empty()) {
+        return {};
+    }
+    auto &listener = it->second;
+    const FourTuple id = listener.accept_queue.front();
+    listener.accept_queue.pop();
+    --listener.pending;
+    return id;
+}
+
+//! \details The outbound stream is ended (if the connection is still active), and the
+//! connection is removed from the table as soon as it is no longer active.
+void TCPEngine::close(const FourTuple &id) {
+    auto *const slot = _connections.find(id);
+    if (slot == nullptr) {
+        return;
+    }
+    Entry &entry = **slot;
+    entry.released = true;
+    _sync(entry);
+    if (entry.tcp.active()) {
+        entry.tcp.end_input_stream();
+    }
+    _after_event(id, entry);
+}
+
+size_t TCPEngine::write(const FourTuple &id, const string &data) {
+    Entry &entry = _entry(id);
+    _sync(entry);
+    const size_t written = entry.tcp.write(data);
+    _after_event(id, entry);
+    return written;
+}
+
+void TCPEngine::end_input_stream(const FourTuple &id) {
+    Entry &entry = _entry(id);
+    _sync(entry);
+    entry.tcp.end_input_stream();
+    _after_event(id, entry);
+}
+
+//! \details A segment for an unknown connection is dropped unless it is a SYN (without
+//! ACK or RST) to a listening port whose backlog is not full; in that case a new
+//! connection is created to handle it.
+void TCPEngine::segment_received(const FourTuple &id, const TCPSegment &seg) {
+    auto *slot = _connections.find(id);
+    if (slot == nullptr) {
+        const auto &header = seg.header();
+        const auto it = _listeners.find(id.local_port);
+        if (it == _listeners.end() or not header.syn or header.ack or header.rst) {
+            return;
+        }
+        auto &listener = it->second;
+        if (listener.pending >= listener.backlog) {
+            return;
+        }
+        slot = _connections.emplace(id, make_unique<Entry>(listener.config, true, _now_ms)).first;
+        ++listener.pending;
+    }
+
+    Entry &entry = **slot;
+    _sync(entry);
+    entry.tcp.segment_received(seg);
+    _after_event(id, entry);
+}
+
+//! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
+void TCPEngine::tick(const size_t ms_since_last_tick) {
+    _now_ms += ms_since_last_tick;
+    _timers.advance(_now_ms, [&](const FourTuple &id) {
+        auto *const slot = _connections.find(id);
+        if (slot == nullptr) {
+            return;
+        }
+        Entry &entry = **slot;
+        entry.timer = TimingWheel<FourTuple>::NONE;
+        _sync(entry);
+        _after_event(id, entry);
+    });
+}
+
+optional<uint64_t> TCPEngine::next_deadline_ms() const {
+    const auto next = _timers.next_expiry();
+    if (not next.has_value()) {
+        return {};
+    }
+    return next.value() - _now_ms;
+}
+
+//! \param[in] tun is the TUN device that carries every connection's datagrams
+TCPOverIPv4Engine::TCPOverIPv4Engine(TunFD &&tun)
+    : _adapter(move(tun)), _last_tick_ms(timestamp_ms()) {
+    // rule 1: read a datagram and hand its segment to the connection it belongs to
+    _eventloop.add_rule(_adapter, Direction::In, [&] {
+        auto demuxed = _adapter.demux_read();
+        if (demuxed) {
+            _engine.segment_received(demuxed->first, demuxed->second);
+        }
+    });
+
+    // rule 2: send outbound segments
+    _eventloop.add_rule(
+        _adapter,
+        Direction::Out,
+        [&] { flush(); },
+        [&] { return not _engine.segments_out().empty(); });
+}
+
+void TCPOverIPv4Engine::flush() {
+    auto &segs_out = _engine.segments_out();
+    while (not segs_out.empty()) {
+        auto &[id, seg] = segs_out.front();
+        _adapter.write(seg, id);
+        segs_out.pop();
+    }
+}
+
+//! \param[in] timeout_ms is passed to EventLoop::wait_next_event
+//! \returns the result of EventLoop::wait_next_event
+EventLoop::Result TCPOverIPv4Engine::wait_next_event(const int timeout_ms) {
+    // sleep no longer than until the next timer expires
+    int timeout = timeout_ms;
+    const auto deadline = _engine.next_deadline_ms();
+    if (deadline.has_value() and (timeout < 0 or deadline.value() < uint64_t(timeout))) {
+        timeout = int(deadline.value());
+    }
+    const auto ret = _eventloop.wait_next_event(timeout);
+
+    const auto now = timestamp_ms();
+    if (now > _last_tick_ms) {
+        _engine.tick(now - _last_tick_ms);
+        _adapter.tick(now - _last_tick_ms);
+        _last_tick_ms = now;
+    }
+
+    return ret;
+}
@@ -0,0 +1,152 @@
+#ifndef SPONGE_LIBSPONGE_TCP_ENGINE_HH
+#define SPONGE_LIBSPONGE_TCP_ENGINE_HH
+
+#include "connection_table.hh"
+#include "eventloop.hh"
+#include "four_tuple.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "timing_wheel.hh"
+#include "tuntap_adapter.hh"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+//! \brief Many TCPConnection objects behind one demultiplexer
+//! \details Incoming segments are dispatched by FourTuple through a ConnectionTable.
+//! A SYN for a listening port with no matching connection creates a new connection,
+//! which is put on that port's accept queue once its handshake completes.
+//! Outgoing segments from every connection are collected on one queue, tagged with
+//! the connection they belong to.
+//!
+//! Each connection's earliest timer (retransmission or linger) sits in a TimingWheel, so
+//! the cost of passing time depends on the timers that expire, not on how many connections
+//! are open.
+//!
+//! The engine does no I/O itself; see TCPOverIPv4Engine for one that owns a TUN device.
+class TCPEngine {
+  private:
+    struct Entry {
+        TCPConnection tcp;
+        bool embryonic;        //!< passively opened and not yet on the accept queue
+        bool released{false};  //!< the owner is done with it; reap once inactive
+        uint64_t synced_ms;    //!< engine time up to which `tcp` has been ticked
+        TimingWheel<FourTuple>::Handle timer{TimingWheel<FourTuple>::NONE};
+
+        Entry(const TCPConfig &config, const bool passive, const uint64_t now_ms)
+            : tcp(config), embryonic(passive), synced_ms(now_ms) {}
+    };
+
+    struct Listener {
+        TCPConfig config;
+        size_t backlog;
+        size_t pending{0};  //!< embryonic connections plus those waiting on the accept queue
+        std::queue<FourTuple> accept_queue{};
+    };
+
+    //! All live connections
+    ConnectionTable<std::unique_ptr<Entry>> _connections{};
+
+    //! Listening ports
+    std::unordered_map<uint16_t, Listener> _listeners{};
+
+    //! outbound queue of segments, with the connection each one belongs to
+    std::queue<std::pair<FourTuple, TCPSegment>> _segments_out{};
+
+    //! The next timer expiry of every connection that has one
+    TimingWheel<FourTuple> _timers{};
+
+    //! Milliseconds passed to tick() so far
+    uint64_t _now_ms{0};
+
+    Entry &_entry(const FourTuple &id);
+
+    //! Tick a connection for the time that has passed since it was last ticked
+    void _sync(Entry &entry);
+
+    //! Remove a connection and its timer
+    void _erase(const FourTuple &id, Entry &entry);
+
+    //! Collect outbound segments, promote to the accept queue, reap if finished, and
+    //! reschedule the connection's timer
+    void _after_event(const FourTuple &id, Entry &entry);
+
+  public:
+    //! \name Connection management for the owner
+    //!@{
+
+    //! Accept connections to `port` (on any local address)
+    void listen(const uint16_t port, const TCPConfig &config = {}, const size_t backlog = 16);
+
+    //! Open a connection; its SYN will appear on segments_out()
+    void connect(const FourTuple &id, const TCPConfig &config = {});
+
+    //! \returns the next established connection to `port`, if any
+    std::optional<FourTuple> accept(const uint16_t port);
+
+    //! Give up a connection; it is shut down and removed once it is no longer active
+    void close(const FourTuple &id);
+
+    //! \returns `true` if the connection exists
+    bool contains(const FourTuple &id) const { return _connections.find(id) != nullptr; }
+
+    //! Access a connection (throws std::out_of_range if it does not exist)
+    TCPConnection &connection(const FourTuple &id) { return _entry(id).tcp; }
+
+    //! Write to a connection's outbound stream
+    size_t write(const FourTuple &id, const std::string &data);
+
+    //! Shut down a connection's outbound stream
+    void end_input_stream(const FourTuple &id);
+
+    //! Number of connections in the table
+    size_t size() const { return _connections.size(); }
+    //!@}
+
+    //! \name Methods for the owner or operating system to call
+    //!@{
+
+    //! Dispatch a segment received for connection `id`
+    void segment_received(const FourTuple &id, const TCPSegment &seg);
+
+    //! \brief Called periodically when time elapses
+    //! \details Only connections with a timer expiring in the meantime are ticked; the others
+    //! catch up on the time that has passed when they next handle an event.
+    void tick(const size_t ms_since_last_tick);
+
+    //! \returns milliseconds until tick() next has work to do, or nothing if no timers are set
+    std::optional<uint64_t> next_deadline_ms() const;
+
+    //! Segments waiting to be sent, each with the connection it belongs to
+    std::queue<std::pair<FourTuple, TCPSegment>> &segments_out() { return _segments_out; }
+    //!@}
+};
+
+//! \brief A TCPEngine serving every connection on one TUN device from one event loop
+class TCPOverIPv4Engine {
+  private:
+    TCPOverIPv4OverTunFdAdapter _adapter;
+    TCPEngine _engine{};
+    EventLoop _eventloop{};
+    uint64_t _last_tick_ms;
+
+  public:
+    //! Construct from a TunFD
+    explicit TCPOverIPv4Engine(TunFD &&tun);
+
+    //! Access the engine to listen, connect, accept, and move data
+    TCPEngine &engine() { return _engine; }
+
+    //! Send every segment the engine has queued
+    void flush();
+
+    //! Wait for and dispatch incoming datagrams, pass the time, and send what results
+    EventLoop::Result wait_next_event(const int timeout_ms);
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_ENGINE_HH
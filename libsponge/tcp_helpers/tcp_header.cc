@@ -1,5 +1,6 @@
 #include "tcp_header.hh"
 
+#include <cstring>
 #include <sstream>
 
 using namespace std;
@@ -15,13 +16,18 @@ using namespace std;
 //! - there is less data in the header than the `doff` field claims
 //! - the checksum is bad
 ParseResult TCPHeader::parse(NetParser &p) {
-    sport = p.u16();                 // source port
-    dport = p.u16();                 // destination port
-    seqno = WrappingInt32{p.u32()};  // sequence number
-    ackno = WrappingInt32{p.u32()};  // ack number
-    doff = p.u8() >> 4;              // data offset
+    const HeaderView h = p.header(TCPHeader::LENGTH);
+    if (p.error()) {
+        return p.get_error();
+    }
 
-    const uint8_t fl_b = p.u8();  // byte including flags
+    sport = h.u16(0);                 // source port
+    dport = h.u16(2);                 // destination port
+    seqno = WrappingInt32{h.u32(4)};  // sequence number
+    ackno = WrappingInt32{h.u32(8)};  // ack number
+    doff = h.u8(12) >> 4;             // data offset
+
+    const uint8_t fl_b = h.u8(13);  // byte including flags
     urg = static_cast<bool>(fl_b &
                             0b0010'0000);  // binary literals and ' digit separator since C++14!!!
     ack = static_cast<bool>(fl_b & 0b0001'0000);
@@ -30,9 +36,9 @@ ParseResult TCPHeader::parse(NetParser &p) {
     syn = static_cast<bool>(fl_b & 0b0000'0010);
     fin = static_cast<bool>(fl_b & 0b0000'0001);
 
-    win = p.u16();    // window size
-    cksum = p.u16();  // checksum
-    uptr = p.u16();   // urgent pointer
+    win = h.u16(14);    // window size
+    cksum = h.u16(16);  // checksum
+    uptr = h.u16(18);   // urgent pointer
 
     if (doff < 5) {
         return ParseResult::HeaderTooShort;
@@ -50,33 +56,36 @@ ParseResult TCPHeader::parse(NetParser &p) {
 
 //! Serialize the TCPHeader to a string (does not recompute the checksum)
 string TCPHeader::serialize() const {
+    string ret(4 * doff, 0);
+    serialize(ret.data());
+    return ret;
+}
+
+//! \param[out] destination is where to write the `4 * doff` bytes of the header (any options are
+//! zeroed); the checksum is not recomputed
+void TCPHeader::serialize(char *destination) const {
     // sanity check
     if (doff < 5) {
         throw runtime_error("TCP header too short");
     }
 
-    string ret;
-    ret.reserve(4 * doff);
-
-    NetUnparser::u16(ret, sport);              // source port
-    NetUnparser::u16(ret, dport);              // destination port
-    NetUnparser::u32(ret, seqno.raw_value());  // sequence number
-    NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
+    NetUnparser::u16(destination, sport);                  // source port
+    NetUnparser::u16(destination + 2, dport);              // destination port
+    NetUnparser::u32(destination + 4, seqno.raw_value());  // sequence number
+    NetUnparser::u32(destination + 8, ackno.raw_value());  // ack number
+    NetUnparser::u8(destination + 12, doff << 4);          // data offset
 
     const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) |
                          (psh ? 0b0000'1000 : 0) | (rst ? 0b0000'0100 : 0) |
                          (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
-    NetUnparser::u8(ret, fl_b);  // flags
-    NetUnparser::u16(ret, win);  // window size
+    NetUnparser::u8(destination + 13, fl_b);  // flags
+    NetUnparser::u16(destination + 14, win);  // window size
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    NetUnparser::u16(destination + 16, cksum);  // checksum
 
-    NetUnparser::u16(ret, uptr);  // urgent pointer
+    NetUnparser::u16(destination + 18, uptr);  // urgent pointer
 
-    ret.resize(4 * doff);  // expand header to advertised size
-
-    return ret;
+    memset(destination + LENGTH, 0, 4 * doff - LENGTH);  // expand header to advertised size
 }
 
 //! \returns A string with the header's contents
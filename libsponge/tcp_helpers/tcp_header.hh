@@ -57,6 +57,9 @@ struct TCPHeader {
     //! Serialize the TCP fields
     std::string serialize() const;
 
+    //! Serialize the TCP fields in place
+    void serialize(char *destination) const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
@@ -22,8 +22,11 @@ using namespace std;
 //! and the TCP segment read from the wire includes a SYN, this function clears the
 //! `_listen` flag and records the source and destination addresses and port numbers
 //! from the TCP header; it uses this information to filter future reads.
+//! \param[in] ip_dgram is the datagram that may carry a TCP segment
+//! \param[in] verify_checksum is `false` to trust the TCP checksum (see TCPSegment::parse)
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
-optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram &ip_dgram) {
+optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram &ip_dgram,
+                                                          const bool verify_checksum) {
     // is the IPv4 datagram for us?
     // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
     if (not listening() and (ip_dgram.header().dst != config().source.ipv4_numeric())) {
@@ -43,7 +46,7 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
     // is the payload a valid TCP segment?
     TCPSegment tcp_seg;
     if (ParseResult::NoError !=
-        tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+        tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum(), verify_checksum)) {
         return {};
     }
 
@@ -76,19 +79,71 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+    return wrap_tcp_in_ip(seg, FourTuple::from_addresses(config().source, config().destination));
+}
+
+//! \details Unlike unwrap_tcp_in_ip(), this does no filtering beyond checking that the
+//! datagram carries a valid TCP segment; the returned FourTuple is from the receiver's
+//! point of view (local = datagram destination, remote = datagram source).
+//! \returns the connection and segment, or empty if the datagram is not valid TCP
+optional<pair<FourTuple, TCPSegment>> TCPOverIPv4Adapter::demux_tcp_in_ip(
+    const InternetDatagram &ip_dgram, const bool verify_checksum) {
+    const auto &ip_header = ip_dgram.header();
+    if (ip_header.proto != IPv4Header::PROTO_TCP) {
+        return {};
+    }
+
+    TCPSegment tcp_seg;
+    if (ParseResult::NoError !=
+        tcp_seg.parse(ip_dgram.payload(), ip_header.pseudo_cksum(), verify_checksum)) {
+        return {};
+    }
+
+    const auto &tcp_header = tcp_seg.header();
+    const FourTuple id{ip_header.dst, ip_header.src, tcp_header.dport, tcp_header.sport};
+    return {{id, move(tcp_seg)}};
+}
+
+//! Sets the segment's port numbers from `id`, and makes the header of the datagram to carry it
+static InternetDatagram datagram_for(TCPSegment &seg, const FourTuple &id) {
     // set the port numbers in the TCP segment
-    seg.header().sport = config().source.port();
-    seg.header().dport = config().destination.port();
+    seg.header().sport = id.local_port;
+    seg.header().dport = id.remote_port;
 
     // create an Internet Datagram and set its addresses and length
     InternetDatagram ip_dgram;
-    ip_dgram.header().src = config().source.ipv4_numeric();
-    ip_dgram.header().dst = config().destination.ipv4_numeric();
+    ip_dgram.header().src = id.local_ip;
+    ip_dgram.header().dst = id.remote_ip;
     ip_dgram.header().len =
         ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    return ip_dgram;
+}
+
+//! \param[in] seg is the TCP segment to convert; its port numbers are set from `id`
+//! \param[in] id is the connection the segment belongs to
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg, const FourTuple &id) {
+    InternetDatagram ip_dgram = datagram_for(seg, id);
 
     // set payload, calculating TCP checksum using information from IP header
     ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
 
     return ip_dgram;
 }
+
+//! \param[in] seg is the TCP segment to convert
+//! \param[out] packet gets the datagram
+void TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg, PacketBuilder &packet) {
+    wrap_tcp_in_ip(seg, FourTuple::from_addresses(config().source, config().destination), packet);
+}
+
+//! \param[in] seg is the TCP segment to convert; its port numbers are set from `id`
+//! \param[in] id is the connection the segment belongs to
+//! \param[out] packet gets the datagram: the segment is written first, then the IPv4 header in
+//! front of it
+void TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg,
+                                        const FourTuple &id,
+                                        PacketBuilder &packet) {
+    const InternetDatagram ip_dgram = datagram_for(seg, id);
+    seg.serialize(packet, ip_dgram.header().pseudo_cksum());
+    ip_dgram.serialize(packet);
+}
@@ -3,17 +3,35 @@
 
 #include "buffer.hh"
 #include "fd_adapter.hh"
+#include "four_tuple.hh"
 #include "ipv4_datagram.hh"
+#include "packet_builder.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
+#include <utility>
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
   public:
-    std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
+    std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram,
+                                               const bool verify_checksum = true);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! \brief Serialize a TCP segment, in an IPv4 datagram, into `packet` (which must be empty)
+    void wrap_tcp_in_ip(TCPSegment &seg, PacketBuilder &packet);
+
+    //! \brief Parse a TCP segment from any peer, along with the connection it belongs to
+    static std::optional<std::pair<FourTuple, TCPSegment>> demux_tcp_in_ip(
+        const InternetDatagram &ip_dgram, const bool verify_checksum = true);
+
+    //! \brief Wrap a TCP segment belonging to connection `id` in an IPv4 datagram
+    static InternetDatagram wrap_tcp_in_ip(TCPSegment &seg, const FourTuple &id);
+
+    //! \brief Serialize a TCP segment belonging to connection `id`, in an IPv4 datagram, into
+    //! `packet` (which must be empty)
+    static void wrap_tcp_in_ip(TCPSegment &seg, const FourTuple &id, PacketBuilder &packet);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
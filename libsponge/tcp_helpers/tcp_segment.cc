@@ -9,11 +9,17 @@ using namespace std;
 
 //! \param[in] buffer string/Buffer to be parsed
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
-ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer_checksum) {
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(buffer);
-    if (check.value()) {
-        return ParseResult::BadChecksum;
+//! \param[in] verify_checksum is `false` if the checksum is already known to be good (or has
+//! not been filled in yet), e.g. when a device with checksum offload says so
+ParseResult TCPSegment::parse(const Buffer buffer,
+                              const uint32_t datagram_layer_checksum,
+                              const bool verify_checksum) {
+    if (verify_checksum) {
+        InternetChecksum check(datagram_layer_checksum);
+        check.add(buffer);
+        if (check.value()) {
+            return ParseResult::BadChecksum;
+        }
     }
 
     NetParser p{buffer};
@@ -26,20 +32,62 @@ size_t TCPSegment::length_in_sequence_space() const {
     return payload().str().size() + (header().syn ? 1 : 0) + (header().fin ? 1 : 0);
 }
 
+//! \param[in] payload is the new payload
+void TCPSegment::set_payload(Buffer payload) {
+    InternetChecksum check;
+    check.add(payload);
+    set_payload(move(payload), check);
+}
+
+//! \param[in] payload is the new payload
+//! \param[in] payload_checksum has had exactly `payload` added to it (e.g., as it was copied)
+void TCPSegment::set_payload(Buffer payload, const InternetChecksum &payload_checksum) {
+    _payload = move(payload);
+    _payload_sum = uint16_t(~payload_checksum.value());
+}
+
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
     header_out.cksum = 0;
+    string header_string = header_out.serialize();
 
-    // calculate checksum -- taken over entire segment
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
-    check.add(_payload);
-    header_out.cksum = check.value();
+    // calculate checksum -- taken over entire segment (the header is a whole number of words, so
+    // the payload's sum can be added on its own)
+    InternetChecksum check(datagram_layer_checksum + _payload_sum.value_or(0));
+    check.add(header_string);
+    if (not _payload_sum.has_value()) {
+        check.add(_payload);
+    }
+    NetUnparser::u16(header_string.data() + CHECKSUM_OFFSET, check.value());
 
     BufferList ret;
-    ret.append(header_out.serialize());
+    ret.append(move(header_string));
     ret.append(_payload);
 
     return ret;
 }
+
+//! \param[in,out] packet is an empty PacketBuilder, which gets the whole segment
+//! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+//! \details The payload is summed as it is copied in, unless its sum is known already; the header
+//! is then written in place in front of it, and its checksum field patched.
+void TCPSegment::serialize(PacketBuilder &packet, const uint32_t datagram_layer_checksum) const {
+    uint16_t payload_sum = _payload_sum.value_or(0);
+    if (_payload_sum.has_value()) {
+        packet.append(_payload.str());
+    } else {
+        InternetChecksum payload_check;
+        payload_check.copy_and_add(packet.append(_payload.size()), _payload);
+        payload_sum = ~payload_check.value();
+    }
+
+    TCPHeader header_out = _header;
+    header_out.cksum = 0;
+    char *header = packet.prepend(4 * header_out.doff);
+    header_out.serialize(header);
+
+    InternetChecksum check(datagram_layer_checksum + payload_sum);
+    check.add({header, size_t(4 * header_out.doff)});
+    NetUnparser::u16(header + CHECKSUM_OFFSET, check.value());
+}
@@ -2,32 +2,60 @@
 #define SPONGE_LIBSPONGE_TCP_SEGMENT_HH
 
 #include "buffer.hh"
+#include "packet_builder.hh"
 #include "tcp_header.hh"
+#include "util.hh"
 
 #include <cstdint>
+#include <optional>
 
 //! \brief [TCP](\ref rfc::rfc793) segment
 class TCPSegment {
   private:
     TCPHeader _header{};
     Buffer _payload{};
+    std::optional<uint16_t> _payload_sum{};  //!< ones-complement sum of `_payload`, if known
+
+    static constexpr size_t CHECKSUM_OFFSET = 16;  //!< of the checksum field in the header
 
   public:
     //! \brief Parse the segment from a string
-    ParseResult parse(const Buffer buffer, const uint32_t datagram_layer_checksum = 0);
+    ParseResult parse(const Buffer buffer,
+                      const uint32_t datagram_layer_checksum = 0,
+                      const bool verify_checksum = true);
 
     //! \brief Serialize the segment to a string
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
 
+    //! \brief Serialize the segment into a PacketBuilder, in one pass
+    void serialize(PacketBuilder &packet, const uint32_t datagram_layer_checksum = 0) const;
+
+    //! \brief Set the payload, and sum it once for every serialize() to come
+    //! \details A segment can be serialized several times (e.g., when it is retransmitted, with a
+    //! new ackno and window each time): with its payload's sum known, that takes a pass over just
+    //! the header.
+    void set_payload(Buffer payload);
+
+    //! \brief Set the payload, given its checksum (from an InternetChecksum that added only it)
+    void set_payload(Buffer payload, const InternetChecksum &payload_checksum);
+
     //! \name Accessors
     //!@{
     const TCPHeader &header() const { return _header; }
     TCPHeader &header() { return _header; }
 
     const Buffer &payload() const { return _payload; }
-    Buffer &payload() { return _payload; }
     //!@}
 
+    //! \brief Access the payload to change it
+    //! \details This forgets the payload's sum, so the next serialize() sums it again. It is not
+    //! an overload of payload(), so that merely reading a non-const segment's payload cannot
+    //! throw the sum away.
+    Buffer &mutable_payload() {
+        _payload_sum.reset();
+        return _payload;
+    }
+
     //! \brief Segment's length in sequence space
     //! \note Equal to payload length plus one byte if SYN is set, plus one byte if FIN is set
     size_t length_in_sequence_space() const;
@@ -77,10 +77,13 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
         _datagram_adapter,
         Direction::In,
         [&] {
-            auto seg = _datagram_adapter.read();
-            if (seg) {
-                _tcp->segment_received(move(seg.value()));
-            }
+            // batching adapters may have more segments ready; take them all
+            do {
+                auto seg = _datagram_adapter.read();
+                if (seg) {
+                    _tcp->segment_received(move(seg.value()));
+                }
+            } while (_datagram_adapter.pending() > 0 and _tcp->active());
 
             // debugging output:
             if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
@@ -163,10 +166,10 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
         _datagram_adapter,
         Direction::Out,
         [&] {
-            while (not _tcp->segments_out().empty()) {
-                _datagram_adapter.write(_tcp->segments_out().front());
-                _tcp->segments_out().pop();
+            for (auto &seg : _tcp->segments_out().drain()) {
+                _datagram_adapter.write(seg);
             }
+            _datagram_adapter.flush();
         },
         [&] { return not _tcp->segments_out().empty(); });
 }
@@ -296,6 +299,21 @@ template class TCPSpongeSocket<LossyTCPOverUDPSocketAdapter>;
 //! Specialization of TCPSpongeSocket for LossyTCPOverIPv4OverTunFdAdapter
 template class TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAdapter>;
 
+//! Specialization of TCPSpongeSocket for TCPOverUDPUringAdapter
+template class TCPSpongeSocket<TCPOverUDPUringAdapter>;
+
+//! Specialization of TCPSpongeSocket for LossyTCPOverUDPUringAdapter
+template class TCPSpongeSocket<LossyTCPOverUDPUringAdapter>;
+
+//! Specialization of TCPSpongeSocket for TCPOverIPv4OverTunUringAdapter
+template class TCPSpongeSocket<TCPOverIPv4OverTunUringAdapter>;
+
+//! Specialization of TCPSpongeSocket for TCPOverIPv4OverTunOffloadAdapter
+template class TCPSpongeSocket<TCPOverIPv4OverTunOffloadAdapter>;
+
+//! Specialization of TCPSpongeSocket for TCPOverIPv4OverPacketRingAdapter
+template class TCPSpongeSocket<TCPOverIPv4OverPacketRingAdapter>;
+
 CS144TCPSocket::CS144TCPSocket()
     : TCPOverIPv4SpongeSocket(TCPOverIPv4OverTunFdAdapter(TunFD("tun144"))) {}
 
@@ -107,6 +107,12 @@ using TCPOverIPv4OverEthernetSpongeSocket = TCPSpongeSocket<TCPOverIPv4OverEther
 using LossyTCPOverUDPSpongeSocket = TCPSpongeSocket<LossyTCPOverUDPSocketAdapter>;
 using LossyTCPOverIPv4SpongeSocket = TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAdapter>;
 
+using TCPOverUDPUringSpongeSocket = TCPSpongeSocket<TCPOverUDPUringAdapter>;
+using LossyTCPOverUDPUringSpongeSocket = TCPSpongeSocket<LossyTCPOverUDPUringAdapter>;
+using TCPOverIPv4UringSpongeSocket = TCPSpongeSocket<TCPOverIPv4OverTunUringAdapter>;
+using TCPOverIPv4OffloadSpongeSocket = TCPSpongeSocket<TCPOverIPv4OverTunOffloadAdapter>;
+using TCPOverIPv4OverPacketRingSpongeSocket = TCPSpongeSocket<TCPOverIPv4OverPacketRingAdapter>;
+
 //! \class TCPSpongeSocket
 //! This class involves the simultaneous operation of two threads.
 //!
@@ -1,7 +1,127 @@
 #include "tuntap_adapter.hh"
 
+#include "util.hh"
+
+#include <cstdint>
+#include <cstring>
+
 using namespace std;
 
+//! \details Reads one frame and strips its virtio-net header, which says whether the TCP
+//! checksum still needs to be checked.
+optional<TCPSegment> TCPOverIPv4OverTunOffloadAdapter::read() {
+    VirtioNetHeader vnet{};
+    string frame;
+    _tun.read(frame, sizeof(vnet) + MAX_DATAGRAM);
+    if (frame.size() < sizeof(vnet)) {
+        return {};
+    }
+    memcpy(&vnet, frame.data(), sizeof(vnet));
+
+    Buffer datagram{move(frame)};
+    datagram.remove_prefix(sizeof(vnet));
+    InternetDatagram ip_dgram;
+    if (ip_dgram.parse(datagram) != ParseResult::NoError) {
+        return {};
+    }
+
+    const bool checksum_trusted =
+        vnet.flags & (VirtioNetHeader::F_NEEDS_CSUM | VirtioNetHeader::F_DATA_VALID);
+    return unwrap_tcp_in_ip(ip_dgram, not checksum_trusted);
+}
+
+//! \param[in] seg is the TCP segment to queue; its port numbers are set from the configuration
+void TCPOverIPv4OverTunOffloadAdapter::write(TCPSegment &seg) {
+    seg.header().sport = config().source.port();
+    seg.header().dport = config().destination.port();
+    _unsent.push_back(seg);
+}
+
+//! \details A segment joins the run before it if the run so far is all full-sized segments
+//! (the size of the first) carrying only data and ACKs, and it continues the run in sequence
+//! space, with the same header length, and without growing the frame past MAX_DATAGRAM.
+//! \param[in] segments are the segments to send, in order
+//! \param[in] first is where the run starts
+size_t TCPOverIPv4OverTunOffloadAdapter::run_end(const vector<TCPSegment> &segments,
+                                                 const size_t first) {
+    const auto plain = [](const TCPHeader &header) {
+        return not(header.syn or header.rst or header.urg);
+    };
+
+    const size_t segment_size = segments[first].payload().size();
+    size_t frame_size = IPv4Header::LENGTH + segments[first].header().doff * 4 + segment_size;
+    size_t last = first + 1;
+    while (last < segments.size()) {
+        const TCPHeader &previous = segments[last - 1].header();
+        const TCPSegment &next = segments[last];
+        if (segment_size == 0 or not plain(previous) or previous.fin or
+            not plain(next.header()) or segments[last - 1].payload().size() != segment_size or
+            next.header().seqno != previous.seqno + segment_size or
+            next.header().doff != previous.doff or next.payload().size() == 0 or
+            next.payload().size() > segment_size or
+            frame_size + next.payload().size() > MAX_DATAGRAM) {
+            break;
+        }
+        frame_size += next.payload().size();
+        last++;
+    }
+    return last;
+}
+
+//! \details Like a NIC doing TSO, the kernel copies the frame's header into every segment it
+//! cuts, clearing FIN and PSH on all but the last, so the frame takes its header from the run's
+//! last segment and its sequence number from the first.
+//! \param[in] segments are the segments to send, in order
+//! \param[in] first is where the run starts
+//! \param[in] last is just past where it ends, as returned by run_end()
+//! \param[in] config gives the datagram's source and destination addresses
+BufferList TCPOverIPv4OverTunOffloadAdapter::run_frame(const vector<TCPSegment> &segments,
+                                                       const size_t first,
+                                                       const size_t last,
+                                                       const FdAdapterConfig &config) {
+    const size_t segment_size = segments[first].payload().size();
+    TCPHeader tcp_header = segments[last - 1].header();
+    tcp_header.seqno = segments[first].header().seqno;
+
+    InternetDatagram ip_dgram;
+    ip_dgram.header().src = config.source.ipv4_numeric();
+    ip_dgram.header().dst = config.destination.ipv4_numeric();
+    ip_dgram.header().len = ip_dgram.header().hlen * 4 + tcp_header.doff * 4;
+    for (size_t i = first; i < last; i++) {
+        ip_dgram.header().len += segments[i].payload().size();
+    }
+
+    // the kernel finishes the checksum, starting from the pseudo-header sum
+    tcp_header.cksum = ~InternetChecksum(ip_dgram.header().pseudo_cksum()).value();
+    ip_dgram.payload().append(tcp_header.serialize());
+    for (size_t i = first; i < last; i++) {
+        ip_dgram.payload().append(segments[i].payload());
+    }
+
+    VirtioNetHeader vnet{};
+    vnet.flags = VirtioNetHeader::F_NEEDS_CSUM;
+    vnet.csum_start = ip_dgram.header().hlen * 4;
+    vnet.csum_offset = 16;  // of the checksum field in the TCP header
+    if (last - first > 1) {
+        vnet.gso_type = VirtioNetHeader::GSO_TCPV4;
+        vnet.gso_size = segment_size;
+        vnet.hdr_len = ip_dgram.header().hlen * 4 + tcp_header.doff * 4;
+    }
+
+    BufferList frame{string(reinterpret_cast<const char *>(&vnet), sizeof(vnet))};
+    frame.append(ip_dgram.serialize());
+    return frame;
+}
+
+void TCPOverIPv4OverTunOffloadAdapter::flush() {
+    for (size_t first = 0; first < _unsent.size();) {
+        const size_t last = run_end(_unsent, first);
+        _tun.write(run_frame(_unsent, first, last, config()));
+        first = last;
+    }
+    _unsent.clear();
+}
+
 //! \param[in] tap Raw network device that will be owned by the adapter
 //! \param[in] eth_address Ethernet address (local address) of the adapter
 //! \param[in] ip_address IP address (local address) of the adapter
@@ -20,7 +140,7 @@ TCPOverIPv4OverEthernetAdapter::TCPOverIPv4OverEthernetAdapter(TapFD &&tap,
 optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
     // Read Ethernet frame from the raw device
     EthernetFrame frame;
-    if (frame.parse(_tap.read()) != ParseResult::NoError) {
+    if (frame.parse(_tap.read(_pool, BufferPool::JUMBO_BYTES)) != ParseResult::NoError) {
         return {};
     }
 
@@ -52,7 +172,58 @@ void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
 
 void TCPOverIPv4OverEthernetAdapter::send_pending() {
     while (not _interface.frames_out().empty()) {
-        _tap.write(_interface.frames_out().front().serialize());
+        _interface.frames_out().front().serialize(_packet);
+        _tap.write(_packet.release().str());
+        _interface.frames_out().pop();
+    }
+}
+
+//! \param[in] ring Packet socket on the interface, which will be owned by the adapter
+//! \param[in] eth_address Ethernet address (local address) of the adapter
+//! \param[in] ip_address IP address (local address) of the adapter
+//! \param[in] next_hop IP address of the next hop (typically a router or default gateway)
+TCPOverIPv4OverPacketRingAdapter::TCPOverIPv4OverPacketRingAdapter(
+    PacketRing &&ring,
+    const EthernetAddress &eth_address,
+    const Address &ip_address,
+    const Address &next_hop)
+    : _ring(move(ring)), _interface(eth_address, ip_address), _next_hop(next_hop) {}
+
+//! \details Replies the frame provokes (e.g. to ARP requests) are transmitted right away.
+optional<TCPSegment> TCPOverIPv4OverPacketRingAdapter::read() {
+    const auto received = _ring.receive();
+    EthernetFrame frame;
+    if (not received.has_value() or frame.parse(received->frame) != ParseResult::NoError) {
+        return {};
+    }
+
+    optional<InternetDatagram> ip_dgram = _interface.recv_frame(frame);
+    send_pending();
+    _ring.flush();
+
+    if (ip_dgram) {
+        return unwrap_tcp_in_ip(ip_dgram.value(), not received->checksum_ready);
+    }
+    return {};
+}
+
+//! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
+void TCPOverIPv4OverPacketRingAdapter::tick(const size_t ms_since_last_tick) {
+    _interface.tick(ms_since_last_tick);
+    send_pending();
+    _ring.flush();
+}
+
+//! \param[in] seg the TCPSegment to send
+void TCPOverIPv4OverPacketRingAdapter::write(TCPSegment &seg) {
+    _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
+    send_pending();
+}
+
+void TCPOverIPv4OverPacketRingAdapter::send_pending() {
+    while (not _interface.frames_out().empty()) {
+        _interface.frames_out().front().serialize(_packet);
+        _ring.send(_packet.release().str());
         _interface.frames_out().pop();
     }
 }
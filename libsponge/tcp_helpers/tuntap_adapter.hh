@@ -2,17 +2,26 @@
 #define SPONGE_LIBSPONGE_TUNFD_ADAPTER_HH
 
 #include "ethernet_header.hh"
+#include "io_uring.hh"
 #include "network_interface.hh"
+#include "packet_ring.hh"
 #include "tun.hh"
 
+#include <cstdint>
+#include <memory>
 #include <optional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TUN device
+//! \details Datagrams are read into, and built in, storage from the adapter's BufferPool, so the
+//! adapter (and the segments it reads) must be used from one thread at a time.
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
   private:
     TunFD _tun;
+    BufferPool _pool{};
+    PacketBuilder _packet{_pool};  //!< each outgoing datagram is built here
 
   public:
     //! Construct from a TunFD
@@ -21,14 +30,32 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
     std::optional<TCPSegment> read() {
         InternetDatagram ip_dgram;
-        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
+        if (ip_dgram.parse(_tun.read(_pool, BufferPool::JUMBO_BYTES)) != ParseResult::NoError) {
             return {};
         }
         return unwrap_tcp_in_ip(ip_dgram);
     }
 
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    void write(TCPSegment &seg) {
+        wrap_tcp_in_ip(seg, _packet);
+        _tun.write(_packet.release().str());
+    }
+
+    //! Reads an IPv4 datagram and parses the TCP segment inside, whichever connection it belongs to
+    std::optional<std::pair<FourTuple, TCPSegment>> demux_read() {
+        InternetDatagram ip_dgram;
+        if (ip_dgram.parse(_tun.read(_pool, BufferPool::JUMBO_BYTES)) != ParseResult::NoError) {
+            return {};
+        }
+        return demux_tcp_in_ip(ip_dgram);
+    }
+
+    //! Creates an IPv4 datagram from a TCP segment of connection `id` and writes it to the TUN device
+    void write(TCPSegment &seg, const FourTuple &id) {
+        wrap_tcp_in_ip(seg, id, _packet);
+        _tun.write(_packet.release().str());
+    }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
@@ -40,11 +67,123 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
 //! Typedef for TCPOverIPv4OverTunFdAdapter
 using LossyTCPOverIPv4OverTunFdAdapter = LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>;
 
+//! \brief A FD adapter for IPv4 datagrams read from and written to a TUN device via io_uring
+//! \details Reads stay posted on the device and writes are queued until flush(), so a burst of
+//! datagrams costs a syscall or two rather than one each. An EventLoop should watch the adapter's
+//! FileDescriptor, which signals completions rather than the device's own readiness.
+class TCPOverIPv4OverTunUringAdapter : public TCPOverIPv4Adapter {
+  private:
+    TunFD _tun;
+    std::unique_ptr<UringPacketIO> _io;
+    PacketBuilder _packet{};  //!< each outgoing datagram is built here
+
+  public:
+    //! Construct from a TunFD
+    explicit TCPOverIPv4OverTunUringAdapter(TunFD &&tun)
+        : _tun(std::move(tun))
+        , _io(std::make_unique<UringPacketIO>(_tun, UringPacketIO::Kind::Device)) {}
+
+    //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
+    std::optional<TCPSegment> read() {
+        auto packet = _io->receive();
+        InternetDatagram ip_dgram;
+        if (not packet.has_value() or
+            ip_dgram.parse(std::move(packet->payload)) != ParseResult::NoError) {
+            return {};
+        }
+        return unwrap_tcp_in_ip(ip_dgram);
+    }
+
+    //! Creates an IPv4 datagram from a TCP segment and queues it to be written to the TUN device
+    void write(TCPSegment &seg) {
+        wrap_tcp_in_ip(seg, _packet);
+        _io->send(_packet.release());
+    }
+
+    //! Datagrams already read and ready to read()
+    size_t pending() const { return _io->pending(); }
+
+    //! Write the datagrams queued by write()
+    void flush() { _io->flush(); }
+
+    //! The descriptor to wait on: readable when the ring has completions
+    operator const FileDescriptor &() const { return _io->event_fd(); }
+
+    //! Access the underlying TUN device
+    TunFD &tun() { return _tun; }
+};
+
+//! \brief The legacy `struct virtio_net_hdr` that precedes each packet on an `IFF_VNET_HDR` device
+//! \details Fields are in the host's byte order. (<linux/virtio_net.h> declares it too, but it
+//! cannot be included from C++.)
+struct VirtioNetHeader {
+    static constexpr uint8_t F_NEEDS_CSUM = 1;  //!< checksum from csum_start still to be computed
+    static constexpr uint8_t F_DATA_VALID = 2;  //!< checksum already verified
+    static constexpr uint8_t GSO_TCPV4 = 1;     //!< a TCP segment to cut into gso_size pieces
+
+    uint8_t flags;         //!< F_NEEDS_CSUM and F_DATA_VALID
+    uint8_t gso_type;      //!< GSO_TCPV4, or 0 for a packet to send as it is
+    uint16_t hdr_len;      //!< length of the IP and TCP headers copied into each piece
+    uint16_t gso_size;     //!< payload length of each piece but the last
+    uint16_t csum_start;   //!< where the checksummed data starts
+    uint16_t csum_offset;  //!< where the checksum goes, from csum_start
+};
+static_assert(sizeof(VirtioNetHeader) == 10, "virtio_net_hdr is 10 bytes");
+
+//! \brief A FD adapter for IPv4 datagrams exchanged with a TUN device with checksum and
+//! segmentation offload
+//! \details The device must be opened with `vnet_hdr`. Received segments whose checksum the
+//! kernel has vouched for (or not yet computed) are not checked again, and segments the kernel
+//! did not cut to the MTU are taken whole. Sent segments carry only the pseudo-header sum in
+//! their checksum field, for the kernel to finish. On flush(), back-to-back full-sized segments
+//! of the stream are merged into one TSO frame of up to 64 KB, which the kernel segments only if
+//! it must.
+class TCPOverIPv4OverTunOffloadAdapter : public TCPOverIPv4Adapter {
+  public:
+    static constexpr size_t MAX_DATAGRAM = 65535;  //!< largest IPv4 datagram, and TSO frame
+
+  private:
+    TunFD _tun;
+    std::vector<TCPSegment> _unsent{};  //!< segments queued by write()
+
+  public:
+    //! \brief Where the run of segments starting at `segments[first]` ends
+    //! \returns the index just past the last segment that can go in the same TSO frame
+    static size_t run_end(const std::vector<TCPSegment> &segments, const size_t first);
+
+    //! \brief The frame that carries `segments[first, last)`: a VirtioNetHeader, then one datagram
+    static BufferList run_frame(const std::vector<TCPSegment> &segments,
+                                const size_t first,
+                                const size_t last,
+                                const FdAdapterConfig &config);
+
+    //! Construct from a TunFD opened with `vnet_hdr`
+    explicit TCPOverIPv4OverTunOffloadAdapter(TunFD &&tun) : _tun(std::move(tun)) {}
+
+    //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
+    std::optional<TCPSegment> read();
+
+    //! Queues a TCP segment to be written to the TUN device by flush()
+    void write(TCPSegment &seg);
+
+    //! Write the segments queued by write(), merging runs of them into TSO frames
+    void flush();
+
+    //! Access the underlying TUN device
+    operator TunFD &() { return _tun; }
+
+    //! Access the underlying TUN device
+    operator const TunFD &() const { return _tun; }
+};
+
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TAP device
 class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
   private:
     TapFD _tap;  //!< Raw Ethernet connection
 
+    BufferPool _pool{};            //!< storage for frames read and sent
+    PacketBuilder _packet{_pool};  //!< each outgoing frame is built here
+
     NetworkInterface _interface;  //!< NIC abstraction
 
     Address _next_hop;  //!< IP address of the next hop
@@ -73,4 +212,49 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
     operator const TapFD &() const { return _tap; }
 };
 
+//! \brief A FD adapter for IPv4 datagrams in Ethernet frames exchanged through a PacketRing
+//! \details Like TCPOverIPv4OverEthernetAdapter, but on any Ethernet interface (e.g. one end of
+//! a veth pair) rather than a TAP device. Frames reach the NetworkInterface as views into the
+//! receive ring, and outgoing frames wait in the transmit ring for flush().
+class TCPOverIPv4OverPacketRingAdapter : public TCPOverIPv4Adapter {
+  private:
+    PacketRing _ring;  //!< Raw Ethernet connection
+
+    PacketBuilder _packet{};  //!< each outgoing frame is built here
+
+    NetworkInterface _interface;  //!< NIC abstraction
+
+    Address _next_hop;  //!< IP address of the next hop
+
+    void send_pending();  //!< Queues any pending Ethernet frames in the transmit ring
+
+  public:
+    //! Construct from a PacketRing
+    explicit TCPOverIPv4OverPacketRingAdapter(PacketRing &&ring,
+                                              const EthernetAddress &eth_address,
+                                              const Address &ip_address,
+                                              const Address &next_hop);
+
+    //! Attempts to receive an Ethernet frame containing an IPv4 datagram that contains a TCP segment
+    std::optional<TCPSegment> read();
+
+    //! Queues a TCP segment (in an IPv4 datagram, in an Ethernet frame) to be sent by flush()
+    void write(TCPSegment &seg);
+
+    //! Called periodically when time elapses
+    void tick(const size_t ms_since_last_tick);
+
+    //! Frames already received and ready to read()
+    size_t pending() const { return _ring.pending(); }
+
+    //! Transmit the frames queued by write()
+    void flush() { _ring.flush(); }
+
+    //! Access the underlying raw Ethernet connection
+    operator PacketRing &() { return _ring; }
+
+    //! Access the underlying raw Ethernet connection
+    operator const PacketRing &() const { return _ring; }
+};
+
 #endif  // SPONGE_LIBSPONGE_TUNFD_ADAPTER_HH
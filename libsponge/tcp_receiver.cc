@@ -52,10 +52,10 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
     auto win_begin = get_abs_ackno();
     auto win_end = win_begin + window_size();
     if (stream_index + 1 + seg.payload().size() <= win_end) {
-        reassembler_.push_substring(seg.payload().copy(), stream_index, header.fin);
+        reassembler_.push_substring(seg.payload(), stream_index, header.fin);
     } else if (stream_index + 1 < win_end) {
         reassembler_.push_substring(
-            seg.payload().copy().substr(0, win_end - (stream_index + 1)), stream_index, false);
+            seg.payload().str().substr(0, win_end - (stream_index + 1)), stream_index, false);
     }
 }
 
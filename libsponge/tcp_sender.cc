@@ -3,6 +3,7 @@
 #include "tcp_config.hh"
 
 #include <iostream>
+#include <memory>
 #include <random>
 
 // Dummy implementation of a TCP sender
@@ -55,7 +56,7 @@ void TCPSender::fill_window() {
         auto &header = seg.header();
         header.seqno = next_seqno();
         header.fin = true;
-        send(seg);
+        send(move(seg));
         ++next_seqno_;
         sent_all_ = true;
         return;
@@ -65,18 +66,19 @@ void TCPSender::fill_window() {
         /* init */
         TCPSegment seg;
         auto &header = seg.header();
-        auto &payload = seg.payload();
-        /* read */
+        /* read, summing the payload as it is copied out of the stream */
         auto max_read_size = std::min(remaining_window_size, TCPConfig::MAX_PAYLOAD_SIZE);
         auto read_size = std::min(max_read_size, stream_.buffer_size());
-        string data = stream_.read(read_size);
+        std::shared_ptr<char> data(new char[read_size], std::default_delete<char[]>());
+        InternetChecksum payload_checksum;
+        stream_.read(data.get(), read_size, payload_checksum);
         /* if eof and there is extra space for eof */
         bool send_eof = false;
         if (stream_.eof() && read_size < remaining_window_size) {
             send_eof = true;
         }
         /* set payload */
-        payload = Buffer(std::move(data));
+        seg.set_payload(Buffer(std::move(data), read_size), payload_checksum);
         /* set header */
         header.seqno = next_seqno();
         if (send_eof) {
@@ -84,7 +86,7 @@ void TCPSender::fill_window() {
             sent_all_ = true;
         }
         /* send */
-        send(seg);
+        send(move(seg));
         /* update meta data */
         remaining_window_size -= (read_size + send_eof);
         next_seqno_ += (read_size + send_eof);
@@ -161,7 +163,7 @@ unsigned int TCPSender::consecutive_retransmissions() const { return consecutive
 void TCPSender::send_empty_segment() {
     TCPSegment seg;
     seg.header().seqno = next_seqno();
-    segments_out_.push(seg);
+    segments_out_.push(move(seg));
 }
 
 /* -------- private -------- */
@@ -190,19 +192,19 @@ void TCPSender::connect() {
     header.syn = true;
     header.seqno = isn_;
 
-    send(seg);
+    send(move(seg));
 
     sent_syn_ = true;
     next_seqno_ = 1;
 }
 
-void TCPSender::send(const TCPSegment &seg) {
+void TCPSender::send(TCPSegment seg) {
     assert(seg.length_in_sequence_space() > 0);
     if (!timing) {
         begin_timing();
     }
-    segments_out_.push(seg);
     push_outstanding_seg(seg);
+    segments_out_.push(move(seg));
 }
 
 void TCPSender::resend(const TCPSegment &seg) {
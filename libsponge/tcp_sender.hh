@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_TCP_SENDER_HH
 
 #include "byte_stream.hh"
+#include "segment_queue.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
@@ -9,7 +10,7 @@
 #include <cassert>
 #include <functional>
 #include <list>
-#include <queue>
+#include <optional>
 
 //! \brief The "sender" part of a TCP implementation.
 
@@ -35,7 +36,7 @@ class TCPSender {
     void push_outstanding_seg(const TCPSegment &seg);
     void pop_outstanding_seg();
     void connect();
-    void send(const TCPSegment &seg);
+    void send(TCPSegment seg);
     void resend(const TCPSegment &seg);
     uint64_t get_next_stream_index() {
         assert(next_seqno_ > 0);
@@ -50,7 +51,7 @@ class TCPSender {
     const WrappingInt32 isn_;
 
     //! outbound queue of segments that the TCPSender wants sent
-    std::queue<TCPSegment> segments_out_{};
+    SegmentQueue segments_out_{};
 
     //! retransmission timer for the connection
     unsigned int initial_retransmission_timeout_;
@@ -113,11 +114,16 @@ class TCPSender {
     //! \brief Number of consecutive retransmissions that have occurred in a row
     unsigned int consecutive_retransmissions() const;
 
+    //! \brief Milliseconds until the retransmission timer expires, if it is running
+    std::optional<size_t> ms_until_timeout() const {
+        return timing ? std::optional<size_t>{countdown_} : std::nullopt;
+    }
+
     //! \brief TCPSegments that the TCPSender has enqueued for transmission.
     //! \note These must be dequeued and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
     //! (ackno and window size) before sending.
-    std::queue<TCPSegment> &segments_out() { return segments_out_; }
+    SegmentQueue &segments_out() { return segments_out_; }
     //!@}
 
     //! \name What is the next sequence number? (used for testing)
@@ -131,6 +137,13 @@ class TCPSender {
     //!@}
 
     uint64_t get_abs_seqno(WrappingInt32 seqno) { return unwrap(seqno, isn_, checkpoint_); }
+
+    //! \brief Would ack_received() with these arguments leave the sender unchanged?
+    //! \note Used by the TCPConnection's header-prediction fast path
+    bool ack_is_redundant(const WrappingInt32 ackno, const uint16_t window_size) const {
+        return ackno == wrap(window_begin_, isn_) && window_size != 0 &&
+               !actual_zero_window_size_ && window_size == window_size_;
+    }
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_SENDER_HH
@@ -1,14 +1,30 @@
 #include "buffer.hh"
 
+#include "buffer_pool.hh"
+
 using namespace std;
 
+void BufferStorage::_give_back() { _block->arena->give_back(_block); }
+
 void Buffer::remove_prefix(const size_t n) {
     if (n > str().size()) {
         throw out_of_range("Buffer::remove_prefix");
     }
     _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
+    if (_storage and _starting_offset + _ending_trim == _storage_size) {
         _storage.reset();
+        _storage_size = _starting_offset = _ending_trim = 0;
+    }
+}
+
+void Buffer::remove_suffix(const size_t n) {
+    if (n > str().size()) {
+        throw out_of_range("Buffer::remove_suffix");
+    }
+    _ending_trim += n;
+    if (_storage and _starting_offset + _ending_trim == _storage_size) {
+        _storage.reset();
+        _storage_size = _starting_offset = _ending_trim = 0;
     }
 }
 
@@ -16,6 +32,16 @@ void BufferList::append(const BufferList &other) {
     for (const auto &buf : other._buffers) {
         _buffers.push_back(buf);
     }
+    _size += other._size;
+}
+
+void BufferList::append(BufferList &&other) {
+    for (auto &buf : other._buffers) {
+        _buffers.push_back(std::move(buf));
+    }
+    _size += other._size;
+    other._buffers.clear();
+    other._size = 0;
 }
 
 BufferList::operator Buffer() const {
@@ -40,20 +66,13 @@ string BufferList::concatenate() const {
     return ret;
 }
 
-size_t BufferList::size() const {
-    size_t ret = 0;
-    for (const auto &buf : _buffers) {
-        ret += buf.size();
+void BufferList::remove_prefix(size_t n) {
+    if (n > _size) {
+        throw std::out_of_range("BufferList::remove_prefix");
     }
-    return ret;
-}
+    _size -= n;
 
-void BufferList::remove_prefix(size_t n) {
     while (n > 0) {
-        if (_buffers.empty()) {
-            throw std::out_of_range("BufferList::remove_prefix");
-        }
-
         if (n < _buffers.front().str().size()) {
             _buffers.front().remove_prefix(n);
             n = 0;
@@ -64,18 +83,19 @@ void BufferList::remove_prefix(size_t n) {
     }
 }
 
-BufferViewList::BufferViewList(const BufferList &buffers) {
+BufferViewList::BufferViewList(const BufferList &buffers) : _size(buffers.size()) {
     for (const auto &x : buffers.buffers()) {
         _views.push_back(x);
     }
 }
 
 void BufferViewList::remove_prefix(size_t n) {
-    while (n > 0) {
-        if (_views.empty()) {
-            throw std::out_of_range("BufferListView::remove_prefix");
-        }
+    if (n > _size) {
+        throw std::out_of_range("BufferListView::remove_prefix");
+    }
+    _size -= n;
 
+    while (n > 0) {
         if (n < _views.front().size()) {
             _views.front().remove_prefix(n);
             n = 0;
@@ -86,17 +106,8 @@ void BufferViewList::remove_prefix(size_t n) {
     }
 }
 
-size_t BufferViewList::size() const {
-    size_t ret = 0;
-    for (const auto &buf : _views) {
-        ret += buf.size();
-    }
-    return ret;
-}
-
-vector<iovec> BufferViewList::as_iovecs() const {
-    vector<iovec> ret;
-    ret.reserve(_views.size());
+BufferViewList::Iovecs BufferViewList::as_iovecs() const {
+    Iovecs ret;
     for (const auto &x : _views) {
         ret.push_back({const_cast<char *>(x.data()), x.size()});
     }
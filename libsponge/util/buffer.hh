@@ -1,27 +1,122 @@
 #ifndef SPONGE_LIBSPONGE_BUFFER_HH
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
+#include "small_vector.hh"
+
 #include <algorithm>
-#include <deque>
 #include <memory>
 #include <numeric>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <sys/uio.h>
+#include <utility>
 #include <vector>
 
-//! \brief A reference-counted read-only string that can discard bytes from the front
+class BufferArena;
+
+//! \brief The header in front of the bytes of each block of storage from a BufferPool
+struct PooledBlock {
+    size_t refs;             //!< references to the block (not atomic: see BufferPool)
+    BufferArena *arena;      //!< where the block goes back once the last reference is gone
+    size_t bucket;           //!< which of the arena's free lists it goes back on
+    PooledBlock *next_free;  //!< the next block on that free list, while this one is on it
+
+    //! The block's bytes
+    char *data() { return reinterpret_cast<char *>(this + 1); }
+};
+
+//! \brief A counted reference to the bytes behind a Buffer
+//! \details The bytes are owned either through a std::shared_ptr, whose count is atomic, or as a
+//! PooledBlock, whose count is not (so the block's Buffers must stay on one thread).
+class BufferStorage {
+  private:
+    std::shared_ptr<const char> _shared{};
+    PooledBlock *_block{};
+    const char *_data{};
+
+    //! Return the block to its arena, now that the last reference is gone
+    void _give_back();
+
+  public:
+    BufferStorage() = default;
+
+    //! \brief Share ownership of bytes owned elsewhere, through `data`
+    explicit BufferStorage(std::shared_ptr<const char> data) noexcept
+        : _shared(std::move(data)), _data(_shared.get()) {}
+
+    //! \brief Take over a reference to a block from a BufferPool
+    explicit BufferStorage(PooledBlock *block) noexcept : _block(block), _data(block->data()) {}
+
+    //! \name Copying and moving
+    //!@{
+    BufferStorage(const BufferStorage &other) noexcept
+        : _shared(other._shared), _block(other._block), _data(other._data) {
+        if (_block) {
+            _block->refs++;
+        }
+    }
+
+    BufferStorage(BufferStorage &&other) noexcept
+        : _shared(std::move(other._shared))
+        , _block(std::exchange(other._block, nullptr))
+        , _data(std::exchange(other._data, nullptr)) {}
+
+    BufferStorage &operator=(BufferStorage other) noexcept {
+        std::swap(_shared, other._shared);
+        std::swap(_block, other._block);
+        std::swap(_data, other._data);
+        return *this;
+    }
+    //!@}
+
+    ~BufferStorage() {
+        if (_block and --_block->refs == 0) {
+            _give_back();
+        }
+    }
+
+    //! The first byte
+    const char *data() const { return _data; }
+
+    //! Whether there are any bytes
+    explicit operator bool() const { return _data != nullptr; }
+
+    //! Whether this is the only reference to the bytes
+    bool unique() const { return _block ? _block->refs == 1 : _shared.use_count() == 1; }
+
+    //! Drop the reference
+    void reset() { *this = BufferStorage{}; }
+};
+
+//! \brief A reference-counted read-only string that can discard bytes from the front (or back)
 class Buffer {
   private:
-    std::shared_ptr<std::string> _storage{};
+    BufferStorage _storage{};  //!< the bytes, kept alive by whatever owns them
+    size_t _storage_size{};
     size_t _starting_offset{};
+    size_t _ending_trim{};  //!< bytes at the end of `_storage` that are not part of this Buffer
+
+    //! \brief Construct as a view of a whole string, which it shares ownership of
+    explicit Buffer(const std::shared_ptr<std::string> &owner) noexcept
+        : _storage(std::shared_ptr<const char>(owner, owner->data()))
+        , _storage_size(owner->size()) {}
 
   public:
     Buffer() = default;
 
     //! \brief Construct by taking ownership of a string
-    Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
+    Buffer(std::string &&str) noexcept : Buffer(std::make_shared<std::string>(std::move(str))) {}
+
+    //! \brief Construct as a view of `size` bytes owned elsewhere (e.g. in a memory-mapped ring)
+    //! \details `data` shares ownership of whatever keeps the bytes valid (see the aliasing
+    //! constructor of std::shared_ptr); the bytes must not change while any copy is alive.
+    Buffer(std::shared_ptr<const char> data, const size_t size) noexcept
+        : _storage(std::move(data)), _storage_size(size) {}
+
+    //! \brief Construct as a view of the first `size` bytes of `storage` (e.g. from a BufferPool)
+    Buffer(BufferStorage storage, const size_t size) noexcept
+        : _storage(std::move(storage)), _storage_size(size) {}
 
     //! \name Expose contents as a std::string_view
     //!@{
@@ -29,7 +124,8 @@ class Buffer {
         if (not _storage) {
             return {};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return {_storage.data() + _starting_offset,
+                _storage_size - _starting_offset - _ending_trim};
     }
 
     operator std::string_view() const { return str(); }
@@ -47,6 +143,10 @@ class Buffer {
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Discard the last `n` bytes of the string (does not require a copy or move)
+    //! \note Lets copies of one Buffer share its storage as separate pieces of it.
+    void remove_suffix(const size_t n);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -55,8 +155,12 @@ class Buffer {
 //! encapsulate a TCP payload in a TCPSegment, and then encapsulate
 //! the TCPSegment in an IPv4Datagram) without copying the payload.
 class BufferList {
+  public:
+    static constexpr size_t INLINE_BUFFERS = 4;  //!< Buffers held without a heap allocation
+
   private:
-    std::deque<Buffer> _buffers{};
+    SmallVector<Buffer, INLINE_BUFFERS> _buffers{};
+    size_t _size{0};  //!< total size of `_buffers`
 
   public:
     //! \name Constructors
@@ -65,21 +169,23 @@ class BufferList {
     BufferList() = default;
 
     //! \brief Construct from a Buffer
-    BufferList(Buffer buffer) : _buffers{buffer} {}
+    BufferList(Buffer buffer) : _size(buffer.size()) { _buffers.push_back(std::move(buffer)); }
 
     //! \brief Construct by taking ownership of a std::string
-    BufferList(std::string &&str) noexcept {
-        Buffer buf{std::move(str)};
-        append(buf);
+    BufferList(std::string &&str) noexcept : _size(str.size()) {
+        _buffers.push_back(Buffer{std::move(str)});
     }
     //!@}
 
-    //! \brief Access the underlying queue of Buffers
-    const std::deque<Buffer> &buffers() const { return _buffers; }
+    //! \brief Access the underlying sequence of Buffers
+    const SmallVector<Buffer, INLINE_BUFFERS> &buffers() const { return _buffers; }
 
     //! \brief Append a BufferList
     void append(const BufferList &other);
 
+    //! \brief Append a BufferList, taking over its Buffers
+    void append(BufferList &&other);
+
     //! \brief Transform to a Buffer
     //! \note Throws an exception unless BufferList is contiguous
     operator Buffer() const;
@@ -88,7 +194,7 @@ class BufferList {
     void remove_prefix(size_t n);
 
     //! \brief Size of the string
-    size_t size() const;
+    size_t size() const { return _size; }
 
     //! \brief Make a copy to a new std::string
     std::string concatenate() const;
@@ -96,7 +202,15 @@ class BufferList {
 
 //! \brief A non-owning temporary view (similar to std::string_view) of a discontiguous string
 class BufferViewList {
-    std::deque<std::string_view> _views{};
+  public:
+    static constexpr size_t INLINE_VIEWS = BufferList::INLINE_BUFFERS;  //!< views held inline
+
+    //! `iovec` structures for the views, held inline when there are few enough
+    using Iovecs = SmallVector<iovec, INLINE_VIEWS>;
+
+  private:
+    SmallVector<std::string_view, INLINE_VIEWS> _views{};
+    size_t _size{0};  //!< total size of `_views`
 
   public:
     //! \name Constructors
@@ -112,21 +226,19 @@ class BufferViewList {
     BufferViewList(const BufferList &buffers);
 
     //! \brief Construct from a std::string_view
-    BufferViewList(std::string_view str) {
-        _views.push_back({const_cast<char *>(str.data()), str.size()});
-    }
+    BufferViewList(std::string_view str) : _size(str.size()) { _views.push_back(str); }
     //!@}
 
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     void remove_prefix(size_t n);
 
     //! \brief Size of the string
-    size_t size() const;
+    size_t size() const { return _size; }
 
-    //! \brief Convert to a vector of `iovec` structures
+    //! \brief Convert to a sequence of `iovec` structures
     //! \note used for system calls that write discontiguous buffers,
     //! e.g. [writev(2)](\ref man2::writev) and [sendmsg(2)](\ref man2::sendmsg)
-    std::vector<iovec> as_iovecs() const;
+    Iovecs as_iovecs() const;
 };
 
 #endif  // SPONGE_LIBSPONGE_BUFFER_HH
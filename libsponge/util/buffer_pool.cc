@@ -0,0 +1,70 @@
+#include "buffer_pool.hh"
+
+#include <new>
+
+using namespace std;
+
+//! \details The blocks of a chunk sit end to end, each header right in front of its bytes.
+void BufferArena::_grow(const size_t bucket) {
+    const size_t stride = sizeof(PooledBlock) + BUCKET_BYTES[bucket];
+    _chunks.emplace_back(make_unique<char[]>(stride * BLOCKS_PER_CHUNK));
+    for (size_t i = 0; i < BLOCKS_PER_CHUNK; i++) {
+        _free[bucket] =
+            new (_chunks.back().get() + i * stride) PooledBlock{0, this, bucket, _free[bucket]};
+    }
+}
+
+//! \param[in] size is the number of bytes needed
+PooledBlock *BufferArena::take(const size_t size) {
+    size_t bucket = 0;
+    while (bucket < BUCKET_BYTES.size() and BUCKET_BYTES[bucket] < size) {
+        bucket++;
+    }
+    if (bucket == BUCKET_BYTES.size()) {
+        return nullptr;
+    }
+
+    if (_free[bucket] == nullptr) {
+        _grow(bucket);
+    }
+    PooledBlock *block = _free[bucket];
+    _free[bucket] = block->next_free;
+    block->refs = 1;
+    _in_use++;
+    return block;
+}
+
+//! \param[in] block is the block, with no references left
+void BufferArena::give_back(PooledBlock *block) {
+    block->next_free = _free[block->bucket];
+    _free[block->bucket] = block;
+    _in_use--;
+    if (_orphaned and _in_use == 0) {
+        delete this;
+    }
+}
+
+void BufferArena::orphan() {
+    _orphaned = true;
+    if (_in_use == 0) {
+        delete this;
+    }
+}
+
+BufferPool::BufferPool() : _arena(new BufferArena, [](BufferArena *arena) { arena->orphan(); }) {}
+
+//! \param[in] size is the number of bytes needed
+BufferPool::Allocation BufferPool::allocate(const size_t size) {
+    PooledBlock *block = _arena->take(size);
+    if (block == nullptr) {
+        return allocate_unpooled(size);
+    }
+    return {BufferStorage{block}, block->data(), BufferArena::BUCKET_BYTES[block->bucket]};
+}
+
+//! \param[in] size is the number of bytes needed
+BufferPool::Allocation BufferPool::allocate_unpooled(const size_t size) {
+    shared_ptr<char> bytes(new char[size], default_delete<char[]>());
+    char *data = bytes.get();
+    return {BufferStorage{shared_ptr<const char>(move(bytes))}, data, size};
+}
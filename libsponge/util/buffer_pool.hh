@@ -0,0 +1,96 @@
+#ifndef SPONGE_LIBSPONGE_BUFFER_POOL_HH
+#define SPONGE_LIBSPONGE_BUFFER_POOL_HH
+
+#include "buffer.hh"
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+//! \brief The blocks behind a BufferPool
+//! \details The arena outlives the last BufferPool handle to it for as long as any of its blocks
+//! is still in use, and deletes itself when the last one comes back.
+class BufferArena {
+  public:
+    //! Bytes per block, in each bucket
+    static constexpr std::array<size_t, 2> BUCKET_BYTES{2048, 9216};
+
+    static constexpr size_t BLOCKS_PER_CHUNK = 32;  //!< blocks allocated at a time
+
+  private:
+    std::array<PooledBlock *, BUCKET_BYTES.size()> _free{};  //!< free list of each bucket
+    std::vector<std::unique_ptr<char[]>> _chunks{};
+    size_t _in_use{0};
+    bool _orphaned{false};
+
+    //! Allocate another chunk of blocks for `bucket`
+    void _grow(const size_t bucket);
+
+  public:
+    BufferArena() = default;
+
+    //! \brief Take a free block of at least `size` bytes, with one reference
+    //! \returns the block, or nullptr if `size` is bigger than any bucket
+    PooledBlock *take(const size_t size);
+
+    //! Put a block whose last reference is gone back on its free list
+    void give_back(PooledBlock *block);
+
+    //! Called when the last BufferPool handle is gone: delete the arena now or when it is unused
+    void orphan();
+
+    //! Blocks in use
+    size_t in_use() const { return _in_use; }
+
+    //! Chunks allocated so far
+    size_t chunks() const { return _chunks.size(); }
+
+    //! \name
+    //! A BufferArena cannot be copied or moved
+
+    //!@{
+    BufferArena(const BufferArena &other) = delete;
+    BufferArena &operator=(const BufferArena &other) = delete;
+    //!@}
+};
+
+//! \brief Storage for Buffers in recycled, fixed-size blocks
+//! \details Blocks come in an MTU-sized bucket and a jumbo-frame-sized one. A block goes back on
+//! its bucket's free list (not to the heap) when the last Buffer using it is gone, so once a pool
+//! has grown to its working set, new storage costs a pop from a list and no `malloc`. A request
+//! bigger than any bucket gets ordinary heap storage instead.
+//!
+//! Each block carries its own reference count, which is not atomic: a pool, and every Buffer
+//! whose storage came from it, must stay on one thread. A BufferPool is a handle, and its copies
+//! share one BufferArena.
+class BufferPool {
+  public:
+    static constexpr size_t MTU_BYTES = BufferArena::BUCKET_BYTES[0];    //!< smaller block size
+    static constexpr size_t JUMBO_BYTES = BufferArena::BUCKET_BYTES[1];  //!< larger block size
+
+    //! \brief Storage for at least `capacity` bytes, and where to write them
+    struct Allocation {
+        BufferStorage storage;  //!< the one reference to the storage
+        char *data;             //!< its bytes
+        size_t capacity;        //!< how many bytes there are
+    };
+
+  private:
+    std::shared_ptr<BufferArena> _arena;
+
+  public:
+    //! A new pool, with nothing allocated yet
+    BufferPool();
+
+    //! \brief Storage for at least `size` bytes, from the pool if it has a block that size
+    Allocation allocate(const size_t size);
+
+    //! \brief Storage for `size` bytes from the heap, owned through a std::shared_ptr
+    static Allocation allocate_unpooled(const size_t size);
+
+    //! The pool's blocks
+    const BufferArena &arena() const { return *_arena; }
+};
+
+#endif  // SPONGE_LIBSPONGE_BUFFER_POOL_HH
@@ -0,0 +1,35 @@
+#include "epoch.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+EpochDomain::Reader::Reader(EpochDomain &domain)
+    : _domain(domain), _slot([&]() -> Slot & {
+        for (auto &slot : domain._slots) {
+            bool unclaimed = false;
+            if (slot.claimed.compare_exchange_strong(unclaimed, true)) {
+                return slot;
+            }
+        }
+        throw runtime_error("EpochDomain: too many readers");
+    }()) {}
+
+EpochDomain::Reader::~Reader() {
+    _slot.epoch.store(IDLE, memory_order_release);
+    _slot.claimed.store(false, memory_order_release);
+}
+
+//! \details A reader that entered in epoch `tag` or earlier may have loaded the old version
+//! before the writer replaced it. One that entered later read the epoch after retire()
+//! advanced it, and so after the new version was published. All of these operations are
+//! sequentially consistent, so a reader that looks idle here can only go on to load the new
+//! version.
+bool EpochDomain::reclaimable(const uint64_t tag) const {
+    for (const auto &slot : _slots) {
+        if (slot.epoch.load(memory_order_seq_cst) <= tag) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#ifndef SPONGE_LIBSPONGE_EPOCH_HH
+#define SPONGE_LIBSPONGE_EPOCH_HH
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+//! \brief Epoch-based reclamation, for data that readers use without locks while a writer
+//! replaces it
+//! \details The writer publishes a new version of its data (e.g. by storing a pointer), then
+//! calls retire() to tag the old version with the current epoch and advance the epoch. A
+//! reader brackets each use of the data with Reader::enter() and Reader::exit() (or a Guard),
+//! which records the epoch it entered in. Once every reader still inside entered after a tag,
+//! none of them can still see what was retired with it, so reclaimable() says the writer may
+//! free it.
+//!
+//! Readers never wait for the writer, and the writer never waits for readers: it just frees
+//! old versions later if a reader is slow.
+class EpochDomain {
+  public:
+    static constexpr size_t MAX_READERS = 64;  //!< Readers registered at once
+
+  private:
+    static constexpr uint64_t IDLE = UINT64_MAX;  //!< epoch of a reader that is not inside
+
+    //! One registered Reader's epoch, on its own cache line
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{IDLE};
+        std::atomic<bool> claimed{false};
+    };
+
+    std::atomic<uint64_t> _epoch{0};
+    std::array<Slot, MAX_READERS> _slots{};
+
+  public:
+    //! \brief A thread's registration with the domain
+    //! \details Each thread that reads needs its own Reader; one Reader is not thread-safe.
+    class Reader {
+      private:
+        EpochDomain &_domain;
+        Slot &_slot;
+
+      public:
+        //! Register with `domain` (throws if MAX_READERS are registered already)
+        explicit Reader(EpochDomain &domain);
+        ~Reader();
+
+        Reader(const Reader &other) = delete;
+        Reader &operator=(const Reader &other) = delete;
+
+        //! Start using the writer's data: anything published before this is safe until exit()
+        void enter() {
+            _slot.epoch.store(_domain._epoch.load(std::memory_order_seq_cst),
+                              std::memory_order_seq_cst);
+        }
+
+        //! Stop using the writer's data
+        void exit() { _slot.epoch.store(IDLE, std::memory_order_release); }
+    };
+
+    //! \brief Enters a Reader on construction, and exits it on destruction
+    class Guard {
+      private:
+        Reader &_reader;
+
+      public:
+        explicit Guard(Reader &reader) : _reader(reader) { _reader.enter(); }
+        ~Guard() { _reader.exit(); }
+
+        Guard(const Guard &other) = delete;
+        Guard &operator=(const Guard &other) = delete;
+    };
+
+    EpochDomain() = default;
+    EpochDomain(const EpochDomain &other) = delete;
+    EpochDomain &operator=(const EpochDomain &other) = delete;
+
+    //! \brief Advance the epoch, after the writer has unpublished something
+    //! \returns the tag to keep with what was unpublished, for reclaimable()
+    uint64_t retire() { return _epoch.fetch_add(1, std::memory_order_seq_cst); }
+
+    //! \brief Can no reader still be using what was retired with `tag`?
+    bool reclaimable(const uint64_t tag) const;
+};
+
+#endif  // SPONGE_LIBSPONGE_EPOCH_HH
@@ -2,6 +2,7 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <cerrno>
 #include <stdexcept>
 #include <system_error>
@@ -14,18 +15,83 @@ unsigned int EventLoop::Rule::service_count() const {
     return direction == Direction::In ? fd.read_count() : fd.write_count();
 }
 
+//! \param[in] backend selects the system call used to wait for events
+EventLoop::EventLoop(const Backend backend) : _backend(backend) {
+    if (_backend == Backend::Epoll) {
+        _epoll.emplace(SystemCall("epoll_create1", ::epoll_create1(EPOLL_CLOEXEC)));
+    }
+}
+
 //! \param[in] fd is the FileDescriptor to be polled
 //! \param[in] direction indicates whether to poll for reading (Direction::In) or writing (Direction::Out)
 //! \param[in] callback is called when `fd` is ready.
 //! \param[in] interest is called by EventLoop::wait_next_event. If it returns `true`, `fd` will
 //!                     be polled, otherwise `fd` will be ignored only for this execution of `wait_next_event.
+//!                     If empty, `fd` is always polled.
 //! \param[in] cancel is called when the rule is cancelled (e.g. on hangup, EOF, or closure).
 void EventLoop::add_rule(const FileDescriptor &fd,
                          const Direction direction,
                          const CallbackT &callback,
                          const InterestT &interest,
                          const CallbackT &cancel) {
-    _rules.push_back({fd.duplicate(), direction, callback, interest, cancel});
+    _rules.push_back({fd.duplicate(), direction, callback, interest, cancel, false});
+    if (_backend == Backend::Poll) {
+        return;
+    }
+
+    // register new fds with no events for now; the next wait_next_event sets them
+    const int fd_num = fd.fd_num();
+    auto [it, inserted] = _registrations.try_emplace(fd_num);
+    Registration &registration = it->second;
+    // if every rule on the number has closed its fd, the number was reused: the kernel dropped
+    // the old registration on close, so the new file needs one of its own (the closed rules are
+    // canceled by the next wait)
+    const auto &rules = registration.rules;
+    const bool reused = not inserted and all_of(rules.begin(), rules.end(), [](const auto &rule) {
+                            return rule->fd.closed();
+                        });
+    registration.rules.push_back(prev(_rules.end()));
+    if (inserted or reused) {
+        registration.events = 0;
+        registration.always_ready = false;
+        epoll_event event{};
+        event.data.fd = fd_num;
+        const int ret = SystemCall(
+            "epoll_ctl", ::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_ADD, fd_num, &event), EPERM);
+        if (ret < 0) {
+            // epoll doesn't support regular files, which poll(2) reports as always ready
+            registration.always_ready = true;
+        }
+    }
+}
+
+EventLoop::RuleIterator EventLoop::_cancel(const RuleIterator rule) {
+    rule->cancel();
+    if (_backend == Backend::Epoll) {
+        const int fd_num = rule->fd.fd_num();
+        const auto it = _registrations.find(fd_num);
+        auto &rules = it->second.rules;
+        rules.erase(find(rules.begin(), rules.end(), rule));
+        if (rules.empty()) {
+            if (not it->second.always_ready) {
+                // fails harmlessly if the fd was already closed, which also unregisters it
+                ::epoll_ctl(_epoll->fd_num(), EPOLL_CTL_DEL, fd_num, nullptr);
+            }
+            _registrations.erase(it);
+        }
+    }
+    return _rules.erase(rule);
+}
+
+void EventLoop::_service(const Rule &rule) {
+    const auto count_before = rule.service_count();
+    rule.callback();
+
+    // only check for busy wait if we're not canceling or exiting
+    if (count_before == rule.service_count() and rule.interested()) {
+        throw runtime_error("EventLoop: busy wait detected: callback did not read/write fd "
+                            "and is still interested");
+    }
 }
 
 //! \param[in] timeout_ms is the timeout value passed to [poll(2)](\ref man2::poll); `wait_next_event`
@@ -45,8 +111,9 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //!
 //! If an error occurs during polling, this function throws a std::runtime_error.
 //!
-//! If a [signal(7)](\ref man7::signal) was caught during polling or if EventLoop::_rules becomes empty,
-//! this function returns Result::Exit.
+//! If EventLoop::_rules becomes empty, this function returns Result::Exit. A wait interrupted with
+//! `EINTR` is simply retried: an io_uring's completion work interrupts it without any
+//! [signal(7)](\ref man7::signal) having been caught.
 //!
 //! If a timeout occurred while polling (i.e., no fd became ready), this function returns Result::Timeout.
 //!
@@ -59,6 +126,10 @@ void EventLoop::add_rule(const FileDescriptor &fd,
 //! will result in a busy loop (poll returns on a ready file descriptor; file descriptor is not read or
 //! written, so it is still ready; the next call to poll will immediately return).
 EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
+    return _backend == Backend::Epoll ? _wait_epoll(timeout_ms) : _wait_poll(timeout_ms);
+}
+
+EventLoop::Result EventLoop::_wait_poll(const int timeout_ms) {
     vector<pollfd> pollfds{};
     pollfds.reserve(_rules.size());
     bool something_to_poll = false;
@@ -80,7 +151,7 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
             continue;
         }
 
-        if (this_rule.interest()) {
+        if (this_rule.interested()) {
             pollfds.push_back({this_rule.fd.fd_num(), static_cast<short>(this_rule.direction), 0});
             something_to_poll = true;
         } else {
@@ -96,14 +167,12 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
     }
 
     // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
-    try {
-        if (0 == SystemCall("poll", ::poll(pollfds.data(), pollfds.size(), timeout_ms))) {
-            return Result::Timeout;
-        }
-    } catch (unix_error const &e) {
-        if (e.code().value() == EINTR) {
-            return Result::Exit;
-        }
+    int n_polled = 0;
+    do {
+        n_polled = ::poll(pollfds.data(), pollfds.size(), timeout_ms);
+    } while (n_polled < 0 and errno == EINTR);
+    if (0 == SystemCall("poll", n_polled)) {
+        return Result::Timeout;
     }
 
     // go through the poll results
@@ -131,18 +200,109 @@ EventLoop::Result EventLoop::wait_next_event(const int timeout_ms) {
 
         if (poll_ready) {
             // we only want to call callback if revents includes the event we asked for
-            const auto count_before = this_rule.service_count();
-            this_rule.callback();
+            _service(this_rule);
+        }
+
+        ++it;  // if we got here, it means we didn't call _rules.erase()
+    }
+
+    return Result::Success;
+}
+
+//! \details Behaves exactly like the poll(2) backend, rule by rule: EOF and closed fds are
+//! canceled before waiting, uninterested rules still hear about errors, and a hangup cancels
+//! an interested rule whose direction is not ready.
+EventLoop::Result EventLoop::_wait_epoll(const int timeout_ms) {
+    bool something_to_poll = false;
+    for (auto it = _rules.begin(); it != _rules.end();) {
+        if ((it->direction == Direction::In and it->fd.eof()) or it->fd.closed()) {
+            it = _cancel(it);
+            continue;
+        }
+        it->polled = it->interested();
+        something_to_poll |= it->polled;
+        ++it;
+    }
+
+    if (not something_to_poll) {
+        return Result::Exit;
+    }
+
+    // push interest changes, and collect the always-ready fds that are being waited on
+    _ready.clear();
+    for (auto &[fd_num, registration] : _registrations) {
+        uint32_t events = 0;
+        for (const auto &rule : registration.rules) {
+            events |= rule->polled ? static_cast<uint32_t>(rule->direction) : 0;
+        }
+        if (registration.always_ready) {
+            if (events != 0) {
+                epoll_event event{};
+                event.events = events;
+                event.data.fd = fd_num;
+                _ready.push_back(event);
+            }
+        } else if (events != registration.events) {
+            epoll_event event{};
+            event.events = events;
+            event.data.fd = fd_num;
+            const int epoll_fd = _epoll->fd_num();
+            if (SystemCall("epoll_ctl", ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd_num, &event), ENOENT) <
+                0) {
+                // the fd number was closed (which unregisters it) and reused since it was added
+                SystemCall("epoll_ctl", ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd_num, &event));
+            }
+            registration.events = events;
+        }
+    }
 
-            // only check for busy wait if we're not canceling or exiting
-            if (count_before == this_rule.service_count() and this_rule.interest()) {
-                throw runtime_error("EventLoop: busy wait detected: callback did not read/write fd "
-                                    "and is still interested");
+    // wait for ready fds (without blocking if an always-ready one is being waited on)
+    const size_t n_immediate = _ready.size();
+    _ready.resize(n_immediate + max(_registrations.size(), size_t(1)));
+    int n_ready = 0;
+    do {
+        n_ready = ::epoll_wait(_epoll->fd_num(),
+                               _ready.data() + n_immediate,
+                               static_cast<int>(_ready.size() - n_immediate),
+                               n_immediate > 0 ? 0 : timeout_ms);
+    } while (n_ready < 0 and errno == EINTR);
+    SystemCall("epoll_wait", n_ready);
+    _ready.resize(n_immediate + n_ready);
+    if (_ready.empty()) {
+        return Result::Timeout;
+    }
+
+    _hung_up.clear();  // left over if a callback threw
+    for (const auto &ready : _ready) {
+        if (ready.events & EPOLLERR) {
+            throw runtime_error("EventLoop: error on polled file descriptor");
+        }
+
+        // by index, looked up again each time, since servicing a rule may add rules (and fds);
+        // the rules a hangup cancels are only removed once every ready fd has been serviced
+        for (size_t i = 0;; i++) {
+            const auto it = _registrations.find(ready.data.fd);
+            if (it == _registrations.end() or i >= it->second.rules.size()) {
+                break;
+            }
+            const RuleIterator rule = it->second.rules[i];
+            const uint32_t wanted = rule->polled ? static_cast<uint32_t>(rule->direction) : 0;
+            const bool ready_for_rule = ready.events & wanted;
+            if ((ready.events & EPOLLHUP) and wanted and not ready_for_rule) {
+                // same as for poll(2): a hangup with nothing to read or write is final
+                _hung_up.push_back(rule);
+                continue;
+            }
+            if (ready_for_rule) {
+                _service(*rule);
             }
         }
+    }
 
-        ++it;  // if we got here, it means we didn't call _rules.erase()
+    for (const auto &rule : _hung_up) {
+        _cancel(rule);
     }
+    _hung_up.clear();
 
     return Result::Success;
 }
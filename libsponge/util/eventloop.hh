@@ -3,10 +3,15 @@
 
 #include "file_descriptor.hh"
 
+#include <cstdint>
 #include <cstdlib>
 #include <functional>
 #include <list>
+#include <optional>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
 class EventLoop {
@@ -17,6 +22,19 @@ class EventLoop {
         Out = POLLOUT  //!< Callback will be triggered when Rule::fd is writable.
     };
 
+    //! Selects the system call EventLoop waits with.
+    enum class Backend {
+        Poll,  //!< Build a pollfd for every rule and call [poll(2)](\ref man2::poll) on each wait.
+        Epoll  //!< Keep persistent [epoll(7)](\ref man7::epoll) registrations; only changes are pushed.
+    };
+
+    //! Returned by each call to EventLoop::wait_next_event.
+    enum class Result {
+        Success,  //!< At least one Rule was triggered.
+        Timeout,  //!< No rules were triggered before timeout.
+        Exit  //!< All rules have been canceled or were uninterested; make no further calls to EventLoop::wait_next_event.
+    };
+
   private:
     using CallbackT = std::function<void(void)>;  //!< Callback for ready Rule::fd
     using InterestT =
@@ -33,31 +51,71 @@ class EventLoop {
         InterestT interest;  //!< A callback that returns `true` whenever fd should be polled.
         CallbackT
             cancel;  //!< A callback that is called when the rule is cancelled (e.g. on hangup)
+        bool polled;  //!< Whether fd is being waited on in the current call to wait_next_event.
+
+        //! Calls Rule::interest, if there is one; a rule without one is always interested.
+        bool interested() const { return not interest or interest(); }
 
         //! Returns the number of times fd has been read or written, depending on the value of Rule::direction.
         //! \details This function is used internally by EventLoop; you will not need to call it
         unsigned int service_count() const;
     };
 
+    using RuleIterator = std::list<Rule>::iterator;
+
     std::list<Rule> _rules{};  //!< All rules that have been added and not canceled.
 
-  public:
-    //! Returned by each call to EventLoop::wait_next_event.
-    enum class Result {
-        Success,  //!< At least one Rule was triggered.
-        Timeout,  //!< No rules were triggered before timeout.
-        Exit  //!< All rules have been canceled or were uninterested; make no further calls to EventLoop::wait_next_event.
+    Backend _backend;
+
+    //! \brief The epoll registration of one file descriptor, shared by every rule on it.
+    //! \details A file descriptor can only be registered with epoll once, but may have a rule for
+    //! each direction (or more), so events are the union of what its rules are waiting for.
+    struct Registration {
+        uint32_t events{0};                 //!< Events last pushed with epoll_ctl.
+        bool always_ready{false};           //!< epoll refused it (e.g. a regular file).
+        std::vector<RuleIterator> rules{};  //!< Rules on this file descriptor, in order added.
     };
 
+    std::optional<FileDescriptor> _epoll{};                   //!< The epoll instance.
+    std::unordered_map<int, Registration> _registrations{};  //!< Registrations by fd number.
+    std::vector<epoll_event> _ready{};                        //!< Events from epoll_wait.
+    std::vector<RuleIterator> _hung_up{};  //!< Rules to cancel once the ready fds are serviced.
+
+    //! Calls Rule::cancel, forgets the rule, and returns the rule after it.
+    RuleIterator _cancel(const RuleIterator rule);
+
+    //! Runs the callback of a ready rule and checks that it made progress.
+    void _service(const Rule &rule);
+
+    //! wait_next_event() for Backend::Poll
+    Result _wait_poll(const int timeout_ms);
+
+    //! wait_next_event() for Backend::Epoll
+    Result _wait_epoll(const int timeout_ms);
+
+  public:
+    //! Construct an EventLoop that waits using `backend`.
+    explicit EventLoop(const Backend backend = Backend::Epoll);
+
+    //! \name
+    //! Registrations refer to rules by iterator, so an EventLoop can be moved but not copied.
+    //!@{
+    EventLoop(const EventLoop &other) = delete;
+    EventLoop &operator=(const EventLoop &other) = delete;
+    EventLoop(EventLoop &&other) = default;
+    EventLoop &operator=(EventLoop &&other) = default;
+    ~EventLoop() = default;
+    //!@}
+
     //! Add a rule whose callback will be called when `fd` is ready in the specified Direction.
     void add_rule(
         const FileDescriptor &fd,
         const Direction direction,
         const CallbackT &callback,
-        const InterestT &interest = [] { return true; },
+        const InterestT &interest = {},
         const CallbackT &cancel = [] {});
 
-    //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+    //! Waits with the selected Backend and then executes callback for each ready fd.
     Result wait_next_event(const int timeout_ms);
 };
 
@@ -76,5 +134,12 @@ using Direction = EventLoop::Direction;
 //! A Rule installed using EventLoop::add_cancelable_rule will be polled and canceled under the
 //! same conditions, with the additional condition that if Rule::callback returns `true`, the
 //! Rule will be canceled.
+//!
+//! With Backend::Epoll (the default), each fd is registered with epoll once, when its first Rule
+//! is added. On each wait, EventLoop checks which rules are interested and pushes an epoll_ctl
+//! only for fds whose set of events changed; rules without an `interest` callback are always
+//! interested and need no call at all. epoll_wait then returns only the ready fds, so the kernel
+//! never scans the idle ones. Backend::Poll keeps the original behavior of rebuilding a pollfd
+//! array for every call.
 
 #endif  // SPONGE_LIBSPONGE_EVENTLOOP_HH
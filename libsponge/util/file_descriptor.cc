@@ -74,6 +74,24 @@ string FileDescriptor::read(const size_t limit) {
     return ret;
 }
 
+//! \param[in] pool provides the storage, which is not copied again
+//! \param[in] limit is the maximum number of bytes to read; fewer bytes may be returned
+//! \returns the bytes read
+Buffer FileDescriptor::read(BufferPool &pool, const size_t limit) {
+    auto allocation = pool.allocate(limit);
+    const ssize_t bytes_read = SystemCall("read", ::read(fd_num(), allocation.data, limit));
+    if (limit > 0 && bytes_read == 0) {
+        _internal_fd->_eof = true;
+    }
+    if (bytes_read > static_cast<ssize_t>(limit)) {
+        throw runtime_error("read() read more than requested");
+    }
+
+    register_read();
+
+    return {move(allocation.storage), size_t(bytes_read)};
+}
+
 size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     size_t total_bytes_written = 0;
 
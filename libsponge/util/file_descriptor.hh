@@ -2,6 +2,7 @@
 #define SPONGE_LIBSPONGE_FILE_DESCRIPTOR_HH
 
 #include "buffer.hh"
+#include "buffer_pool.hh"
 
 #include <array>
 #include <cstddef>
@@ -61,6 +62,9 @@ class FileDescriptor {
     //! Read up to `limit` bytes into `str` (caller can allocate storage)
     void read(std::string &str, const size_t limit = std::numeric_limits<size_t>::max());
 
+    //! Read up to `limit` bytes into storage from `pool`
+    Buffer read(BufferPool &pool, const size_t limit);
+
     //! Write a string, possibly blocking until all is written
     size_t write(const char *str, const bool write_all = true) {
         return write(BufferViewList(str), write_all);
@@ -0,0 +1,358 @@
+#include "io_uring.hh"
+
+#include "util.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace std;
+
+EventFD::EventFD()
+    : FileDescriptor(SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))) {}
+
+bool EventFD::drain() {
+    uint64_t count = 0;
+    const auto bytes_read =
+        SystemCall("read", static_cast<int>(::read(fd_num(), &count, sizeof(count))), EAGAIN);
+    register_read();
+    return bytes_read > 0;
+}
+
+static io_uring_params ring_params(const unsigned entries,
+                                   const unsigned flags,
+                                   const unsigned sq_thread_idle_ms) {
+    io_uring_params params{};
+    params.flags = flags | IORING_SETUP_CQSIZE;
+    params.cq_entries = 4 * entries;
+    params.sq_thread_idle = sq_thread_idle_ms;
+    return params;
+}
+
+IOUring::IOUring(const unsigned entries, const unsigned flags, const unsigned sq_thread_idle_ms)
+    : IOUring(entries, ring_params(entries, flags, sq_thread_idle_ms)) {}
+
+//! \details Sets up the ring with [io_uring_setup(2)](\ref man2::io_uring_setup), which fills in
+//! `params` with the layout of the queues, and maps them. The submission queue's index array is
+//! filled in once as the identity, so entry `i` of the array always names entry `i` of the queue.
+IOUring::IOUring(const unsigned entries, io_uring_params params)
+    : _fd(SystemCall("io_uring_setup",
+                     static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params))))
+    , _flags(params.flags) {
+    const size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    const size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    char *sq_ring = nullptr;
+    char *cq_ring = nullptr;
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        _rings = make_unique<MappedRegion>(_fd, max(sq_size, cq_size), IORING_OFF_SQ_RING);
+        sq_ring = cq_ring = _rings->data();
+    } else {
+        _rings = make_unique<MappedRegion>(_fd, sq_size, IORING_OFF_SQ_RING);
+        _cq_ring = make_unique<MappedRegion>(_fd, cq_size, IORING_OFF_CQ_RING);
+        sq_ring = _rings->data();
+        cq_ring = _cq_ring->data();
+    }
+    _sqe_array =
+        make_unique<MappedRegion>(_fd, params.sq_entries * sizeof(io_uring_sqe), IORING_OFF_SQES);
+
+    _sq_head = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.head);
+    _sq_tail = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.tail);
+    _sq_flags = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.flags);
+    _sq_mask = *reinterpret_cast<unsigned *>(sq_ring + params.sq_off.ring_mask);
+    _sq_entries = params.sq_entries;
+    _sqes = reinterpret_cast<io_uring_sqe *>(_sqe_array->data());
+    _sq_prepared = *_sq_tail;
+    unsigned *const sq_array = reinterpret_cast<unsigned *>(sq_ring + params.sq_off.array);
+    for (unsigned i = 0; i < _sq_entries; i++) {
+        sq_array[i] = i;
+    }
+
+    _cq_head = reinterpret_cast<unsigned *>(cq_ring + params.cq_off.head);
+    _cq_tail = reinterpret_cast<unsigned *>(cq_ring + params.cq_off.tail);
+    _cq_mask = *reinterpret_cast<unsigned *>(cq_ring + params.cq_off.ring_mask);
+    _cqes = reinterpret_cast<io_uring_cqe *>(cq_ring + params.cq_off.cqes);
+}
+
+io_uring_sqe &IOUring::prepare() {
+    if (queued() >= _sq_entries) {
+        submit();
+        while (queued() >= _sq_entries) {
+            _enter(0, 0, IORING_ENTER_SQ_WAIT);  // the polling thread has yet to catch up
+        }
+    }
+    io_uring_sqe &sqe = _sqes[_sq_prepared & _sq_mask];
+    memset(&sqe, 0, sizeof(sqe));
+    _sq_prepared++;
+    return sqe;
+}
+
+//! \details Without a submission queue polling thread, the kernel consumes every submitted entry
+//! before [io_uring_enter(2)](\ref man2::io_uring_enter) returns, so the queue is empty after.
+//! With one, publishing the queue's tail is enough, unless the thread has gone to sleep.
+//! Does nothing if there is nothing to submit or wait for.
+void IOUring::submit(const unsigned wait_nr) {
+    const unsigned to_submit = unsubmitted();
+    __atomic_store_n(_sq_tail, _sq_prepared, __ATOMIC_RELEASE);
+
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    if (_flags & IORING_SETUP_SQPOLL) {
+        // order the tail store before checking whether the thread needs waking
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        const bool asleep = __atomic_load_n(_sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP;
+        if (to_submit > 0 and asleep) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        if (flags != 0) {
+            _enter(to_submit, wait_nr, flags);
+        }
+    } else if (to_submit > 0 or wait_nr > 0) {
+        _enter(to_submit, wait_nr, flags);
+    }
+}
+
+//! \details A signal or the kernel's task work can interrupt the wait with `EINTR` before
+//! anything is submitted, so the call is simply made again.
+void IOUring::_enter(const unsigned to_submit, const unsigned wait_nr, const unsigned flags) {
+    long ret = 0;
+    do {
+        _syscalls++;
+        ret = ::syscall(__NR_io_uring_enter, _fd.fd_num(), to_submit, wait_nr, flags, nullptr, 0);
+    } while (ret < 0 and errno == EINTR);
+    SystemCall("io_uring_enter", static_cast<int>(ret));
+}
+
+//! \param[in] opcode is the registration to perform, e.g. `IORING_REGISTER_PBUF_RING`
+//! \param[in] arg is the argument for `opcode`
+//! \param[in] nr_args is the number of arguments, or 0 or 1 when `arg` points to a single struct
+void IOUring::register_op(const unsigned opcode, const void *arg, const unsigned nr_args) {
+    _syscalls++;
+    const long ret = ::syscall(__NR_io_uring_register, _fd.fd_num(), opcode, arg, nr_args);
+    SystemCall("io_uring_register", static_cast<int>(ret));
+}
+
+//! \param[in] eventfd is an [eventfd(2)](\ref man2::eventfd) counter
+void IOUring::register_eventfd(const FileDescriptor &eventfd) {
+    const int fd = eventfd.fd_num();
+    register_op(IORING_REGISTER_EVENTFD, &fd, 1);
+}
+
+UringPacketIO::UringPacketIO(const FileDescriptor &fd,
+                             const Kind kind,
+                             const unsigned depth,
+                             const size_t buffer_size,
+                             const bool sqpoll)
+    : _fd(fd.duplicate())
+    , _kind(kind)
+    , _buffer_size(buffer_size)
+    , _buffer_count(depth)
+    , _buffers(depth * buffer_size)
+    , _buffer_ring(depth * sizeof(io_uring_buf))
+    , _send_slots(depth)
+    , _ring(depth, sqpoll ? IORING_SETUP_SQPOLL : 0, sqpoll ? SQ_THREAD_IDLE_MS : 0) {
+    if (depth == 0 or depth > (1 << 15) or (depth & (depth - 1)) != 0) {
+        throw runtime_error("UringPacketIO: depth must be a power of two, at most 32768");
+    }
+
+    // hand all the receive buffers to the kernel
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(_buffer_ring.data());
+    reg.ring_entries = _buffer_count;
+    reg.bgid = BUFFER_GROUP;
+    _ring.register_op(IORING_REGISTER_PBUF_RING, &reg, 1);
+    for (unsigned bid = 0; bid < _buffer_count; bid++) {
+        _recycle(static_cast<uint16_t>(bid));
+    }
+    _publish_buffers();
+
+    _ring.register_eventfd(_event);
+
+    // a multishot recvmsg lays out each buffer as a header, the source address, and the payload
+    _receive_header.msg_namelen = sizeof(sockaddr_storage);
+
+    for (size_t i = 0; i < _send_slots.size(); i++) {
+        _free_send_slots.push_back(_send_slots.size() - 1 - i);
+    }
+
+    _post_receives();
+    _ring.submit();
+}
+
+UringPacketIO::~UringPacketIO() {
+    try {
+        flush();
+        while (_free_send_slots.size() < _send_slots.size()) {
+            _ring.submit(1);
+            _reap();
+        }
+    } catch (const exception &e) {
+        cerr << "Exception destructing UringPacketIO: " << e.what() << endl;
+    }
+}
+
+//! \param[in] bid identifies the buffer to give back to the kernel (after _publish_buffers)
+void UringPacketIO::_recycle(const uint16_t bid) {
+    io_uring_buf &entry = _buffer_entries()[_buffer_ring_tail & (_buffer_count - 1)];
+    entry.addr = reinterpret_cast<uint64_t>(_buffer(bid));
+    entry.len = static_cast<uint32_t>(_buffer_size);
+    entry.bid = bid;
+    _buffer_ring_tail++;
+}
+
+//! \details The ring's tail overlays the `resv` field of its first entry.
+void UringPacketIO::_publish_buffers() {
+    __atomic_store_n(&_buffer_entries()[0].resv, _buffer_ring_tail, __ATOMIC_RELEASE);
+}
+
+//! \details A socket needs just one multishot recvmsg, posted again only when the kernel
+//! finishes it (e.g., when it briefly ran out of buffers). Reads on a device are one-shot,
+//! so a batch is kept posted.
+void UringPacketIO::_post_receives() {
+    const unsigned target = _kind == Kind::Socket ? 1 : DEVICE_READS;
+    for (; _receives_posted < target; _receives_posted++) {
+        io_uring_sqe &sqe = _ring.prepare();
+        sqe.fd = _fd.fd_num();
+        sqe.flags = IOSQE_BUFFER_SELECT;
+        sqe.buf_group = BUFFER_GROUP;
+        sqe.user_data = RECEIVE;
+        if (_kind == Kind::Socket) {
+            sqe.opcode = IORING_OP_RECVMSG;
+            sqe.addr = reinterpret_cast<uint64_t>(&_receive_header);
+            sqe.len = 1;
+            sqe.ioprio = IORING_RECV_MULTISHOT;
+        } else {
+            sqe.opcode = IORING_OP_READ;
+            sqe.len = static_cast<uint32_t>(_buffer_size);
+            sqe.off = static_cast<uint64_t>(-1);  // current position
+        }
+    }
+}
+
+void UringPacketIO::_receive_completed(const io_uring_cqe &cqe) {
+    if (not(cqe.flags & IORING_CQE_F_MORE)) {
+        _receives_posted--;
+    }
+    if (cqe.res < 0) {
+        if (-cqe.res == ENOBUFS) {
+            return;  // posted again once buffers are recycled
+        }
+        throw unix_error("io_uring receive", -cqe.res);
+    }
+    if (not(cqe.flags & IORING_CQE_F_BUFFER)) {
+        return;
+    }
+
+    const auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    const char *const buffer = _buffer(bid);
+    const size_t length = cqe.res;
+    if (_kind == Kind::Socket) {
+        const auto *out = reinterpret_cast<const io_uring_recvmsg_out *>(buffer);
+        const size_t name_offset = sizeof(io_uring_recvmsg_out);
+        const size_t payload_offset = name_offset + _receive_header.msg_namelen;
+        if (not(out->flags & MSG_TRUNC) and payload_offset + out->payloadlen <= length) {
+            const auto *name = reinterpret_cast<const sockaddr *>(buffer + name_offset);
+            const size_t name_length = min<size_t>(out->namelen, _receive_header.msg_namelen);
+            _received.push_back(
+                {Address{name, name_length}, string(buffer + payload_offset, out->payloadlen)});
+            _packets_received++;
+        }
+    } else if (length > 0) {
+        _received.push_back({{}, string(buffer, length)});
+        _packets_received++;
+    }
+    _recycle(bid);
+}
+
+void UringPacketIO::_complete(const io_uring_cqe &cqe) {
+    if ((cqe.user_data & 1) == RECEIVE) {
+        _receive_completed(cqe);
+        return;
+    }
+
+    const size_t slot = cqe.user_data >> 1;
+    _send_slots.at(slot).payload = {};
+    _free_send_slots.push_back(slot);
+    if (cqe.res < 0) {
+        throw unix_error("io_uring send", -cqe.res);
+    }
+}
+
+//! \returns whether anything completed
+bool UringPacketIO::_reap() {
+    const size_t count = _ring.reap([&](const io_uring_cqe &cqe) { _complete(cqe); });
+    _publish_buffers();
+    return count > 0;
+}
+
+void UringPacketIO::service() {
+    _event.drain();
+    _event_reads++;
+    _event_outstanding = false;
+    _reap();
+    _post_receives();
+    _ring.submit();
+}
+
+//! \returns a packet, or nothing if none has arrived
+optional<UringPacketIO::Packet> UringPacketIO::receive() {
+    if (_received.empty() or _event_outstanding) {
+        service();
+    }
+    if (_received.empty()) {
+        return {};
+    }
+    Packet ret = move(_received.front());
+    _received.pop_front();
+    return ret;
+}
+
+//! \details If every send slot is in flight, submits and waits for one to complete.
+void UringPacketIO::send(BufferList payload, const optional<Address> &destination) {
+    while (_free_send_slots.empty()) {
+        _ring.submit(1);
+        _event_outstanding |= _reap();
+    }
+    const size_t slot_index = _free_send_slots.back();
+    _free_send_slots.pop_back();
+
+    SendSlot &slot = _send_slots[slot_index];
+    slot.payload = move(payload);
+    slot.iovecs = BufferViewList(slot.payload).as_iovecs();
+
+    io_uring_sqe &sqe = _ring.prepare();
+    sqe.fd = _fd.fd_num();
+    sqe.user_data = (slot_index << 1) | SEND;
+    if (_kind == Kind::Socket) {
+        slot.header = {};
+        if (destination.has_value()) {
+            const sockaddr *const name = destination.value();
+            memcpy(&slot.name.storage, name, destination->size());
+            slot.header.msg_name = &slot.name.storage;
+            slot.header.msg_namelen = destination->size();
+        }
+        slot.header.msg_iov = slot.iovecs.data();
+        slot.header.msg_iovlen = slot.iovecs.size();
+        sqe.opcode = IORING_OP_SENDMSG;
+        sqe.addr = reinterpret_cast<uint64_t>(&slot.header);
+        sqe.len = 1;
+    } else {
+        sqe.opcode = IORING_OP_WRITEV;
+        sqe.addr = reinterpret_cast<uint64_t>(slot.iovecs.data());
+        sqe.len = static_cast<uint32_t>(slot.iovecs.size());
+        sqe.off = static_cast<uint64_t>(-1);  // current position
+    }
+    _packets_sent++;
+}
+
+void UringPacketIO::flush() {
+    if (_ring.unsubmitted() == 0) {
+        return;
+    }
+    _ring.submit();
+    _event_outstanding |= _reap();
+}
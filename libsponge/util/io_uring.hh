@@ -0,0 +1,266 @@
+#ifndef SPONGE_LIBSPONGE_IO_URING_HH
+#define SPONGE_LIBSPONGE_IO_URING_HH
+
+#include "address.hh"
+#include "buffer.hh"
+#include "file_descriptor.hh"
+#include "mapped_region.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <linux/io_uring.h>
+#include <memory>
+#include <optional>
+#include <string>
+#include <sys/socket.h>
+#include <utility>
+#include <vector>
+
+//! A nonblocking [eventfd(2)](\ref man2::eventfd) counter, for waking an EventLoop
+class EventFD : public FileDescriptor {
+  public:
+    //! Create a counter that starts at zero
+    EventFD();
+
+    //! \brief Reset the counter to zero (counts as a read even if it was already zero)
+    //! \returns `true` if the counter was set
+    bool drain();
+};
+
+//! \brief An [io_uring(7)](\ref man7::io_uring) instance: a submission queue and a completion
+//! queue shared with the kernel
+//! \details Requests are prepared in the submission queue without any syscall and handed to
+//! the kernel in bulk by submit(), which also waits for completions if asked. reap() consumes
+//! completions straight from shared memory. The ring is not thread-safe, and since the kernel
+//! holds pointers into it, it cannot be moved.
+//!
+//! With `IORING_SETUP_SQPOLL`, a kernel thread picks up submissions on its own, so submit()
+//! only makes a syscall to wake it after it has been idle, or to wait.
+class IOUring {
+  private:
+    FileDescriptor _fd;
+    std::unique_ptr<MappedRegion> _rings{};  //!< both queues, when the kernel shares one mapping
+    std::unique_ptr<MappedRegion> _cq_ring{};
+    std::unique_ptr<MappedRegion> _sqe_array{};
+
+    unsigned _flags;
+    unsigned *_sq_head{nullptr};
+    unsigned *_sq_tail{nullptr};
+    unsigned *_sq_flags{nullptr};
+    unsigned _sq_mask{0};
+    unsigned _sq_entries{0};
+    io_uring_sqe *_sqes{nullptr};
+    unsigned _sq_prepared{0};  //!< our tail, published to the kernel by submit()
+
+    unsigned *_cq_head{nullptr};
+    unsigned *_cq_tail{nullptr};
+    unsigned _cq_mask{0};
+    io_uring_cqe *_cqes{nullptr};
+
+    uint64_t _syscalls{0};
+
+    //! Map the queues of a ring set up with `params`
+    IOUring(const unsigned entries, io_uring_params params);
+
+    //! Wrapper around [io_uring_enter(2)](\ref man2::io_uring_enter)
+    void _enter(const unsigned to_submit, const unsigned wait_nr, const unsigned flags);
+
+  public:
+    //! \brief Set up a ring
+    //! \param[in] entries is the submission queue size; the completion queue is four times larger
+    //! \param[in] flags are `IORING_SETUP_*` flags
+    //! \param[in] sq_thread_idle_ms is how long a polling thread spins before it sleeps
+    explicit IOUring(const unsigned entries,
+                     const unsigned flags = 0,
+                     const unsigned sq_thread_idle_ms = 0);
+
+    //! \brief Get a zeroed submission queue entry to fill in
+    //! \note Submits the queue first if it is full
+    io_uring_sqe &prepare();
+
+    //! Submit everything prepared, and wait until at least `wait_nr` completions are available
+    void submit(const unsigned wait_nr = 0);
+
+    //! Number of prepared entries the kernel has not yet consumed
+    unsigned queued() const { return _sq_prepared - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE); }
+
+    //! Prepared entries not yet submitted
+    unsigned unsubmitted() const { return _sq_prepared - *_sq_tail; }
+
+    //! \brief Call `on_completion(cqe)` for each available completion
+    //! \returns the number of completions
+    template <typename F>
+    size_t reap(F &&on_completion);
+
+    //! Wrapper around [io_uring_register(2)](\ref man2::io_uring_register)
+    void register_op(const unsigned opcode, const void *arg, const unsigned nr_args);
+
+    //! Signal `eventfd` whenever a completion is posted
+    void register_eventfd(const FileDescriptor &eventfd);
+
+    //! Number of io_uring_enter and io_uring_register calls made so far
+    uint64_t syscalls() const { return _syscalls; }
+
+    //! \name
+    //! An IOUring cannot be copied or moved
+
+    //!@{
+    IOUring(const IOUring &other) = delete;
+    IOUring &operator=(const IOUring &other) = delete;
+    //!@}
+};
+
+template <typename F>
+size_t IOUring::reap(F &&on_completion) {
+    size_t count = 0;
+    unsigned head = *_cq_head;
+    while (head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+        on_completion(std::as_const(_cqes[head & _cq_mask]));
+        head++;
+        count++;
+        // release each entry as we go, since on_completion may need to submit
+        __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+//! \brief Packet I/O on a datagram socket or TUN/TAP device through an io_uring
+//! \details Receives stay posted all the time: on a socket, one multishot
+//! [recvmsg(2)](\ref man2::recvmsg) that completes once per datagram; on a device, a batch of
+//! reads. Either way, the kernel picks the memory from a ring of provided buffers, which are
+//! handed back in bulk as packets are consumed. Sends are queued by send() and handed to the
+//! kernel together by flush() or service(), in the same syscall that re-posts receives.
+//!
+//! To plug into an EventLoop, watch event_fd(): it becomes readable whenever completions
+//! arrive, and service() reaps them. The kernel's completion work runs in the calling thread,
+//! interrupting its wait with `EINTR`, which the EventLoop retries. A submission polling thread
+//! is opt-in: it saves the syscall in flush(), but it spins on a core of its own, and before
+//! Linux 5.11 it needs `CAP_SYS_ADMIN`.
+class UringPacketIO {
+  public:
+    //! What kind of file descriptor the packets go through
+    enum class Kind {
+        Socket,  //!< a datagram socket, with per-packet addresses
+        Device   //!< a TUN or TAP device
+    };
+
+    //! A received packet
+    struct Packet {
+        std::optional<Address> source{};  //!< the sender's address (for Kind::Socket)
+        std::string payload{};            //!< the packet
+    };
+
+    static constexpr unsigned DEFAULT_DEPTH = 256;        //!< default ring and buffer count
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 2048;  //!< default receive buffer size
+
+  private:
+    static constexpr uint16_t BUFFER_GROUP = 0;
+    static constexpr unsigned DEVICE_READS = 16;       //!< reads kept posted on a device
+    static constexpr unsigned SQ_THREAD_IDLE_MS = 10;  //!< polling thread's spin before sleeping
+
+    //! Completions are tagged with the operation, plus the slot index for sends
+    enum Operation : uint64_t { RECEIVE = 0, SEND = 1 };
+
+    //! A send in flight, with everything the kernel may read until it completes
+    struct SendSlot {
+        BufferList payload{};
+        BufferViewList::Iovecs iovecs{};
+        Address::Raw name{};
+        msghdr header{};
+    };
+
+    FileDescriptor _fd;
+    Kind _kind;
+    size_t _buffer_size;
+    unsigned _buffer_count;
+
+    std::vector<char> _buffers;      //!< _buffer_count receive buffers of _buffer_size
+    MappedRegion _buffer_ring;       //!< io_uring_buf entries the kernel takes buffers from
+    uint16_t _buffer_ring_tail{0};   //!< our tail of _buffer_ring, published in bulk
+    msghdr _receive_header{};        //!< template for the multishot recvmsg
+    unsigned _receives_posted{0};    //!< receive requests that will complete again
+    std::deque<Packet> _received{};  //!< reaped but not yet returned by receive()
+    std::vector<SendSlot> _send_slots;
+    std::vector<size_t> _free_send_slots{};
+    bool _event_outstanding{false};  //!< reaped outside service(), so event_fd() may be set
+
+    EventFD _event{};
+    uint64_t _event_reads{0};
+    uint64_t _packets_received{0};
+    uint64_t _packets_sent{0};
+
+    //! Declared last so it is torn down before the memory the kernel may still touch
+    IOUring _ring;
+
+    io_uring_buf *_buffer_entries() const {
+        return reinterpret_cast<io_uring_buf *>(_buffer_ring.data());
+    }
+    char *_buffer(const uint16_t bid) { return _buffers.data() + bid * _buffer_size; }
+    void _recycle(const uint16_t bid);
+    void _publish_buffers();
+    void _post_receives();
+    void _complete(const io_uring_cqe &cqe);
+    void _receive_completed(const io_uring_cqe &cqe);
+    bool _reap();
+
+  public:
+    //! \brief Start receiving on `fd`
+    //! \param[in] fd is the socket or device (the UringPacketIO keeps a duplicate)
+    //! \param[in] kind says how to read and write `fd`
+    //! \param[in] depth is the ring size and number of receive buffers (a power of two)
+    //! \param[in] buffer_size is the largest packet that can be received
+    //! \param[in] sqpoll asks for a kernel thread that polls the submission queue
+    UringPacketIO(const FileDescriptor &fd,
+                  const Kind kind,
+                  const unsigned depth = DEFAULT_DEPTH,
+                  const size_t buffer_size = DEFAULT_BUFFER_SIZE,
+                  const bool sqpoll = false);
+
+    //! Waits for sends still in flight
+    ~UringPacketIO();
+
+    //! Readable when there are completions to service()
+    const FileDescriptor &event_fd() const { return _event; }
+
+    //! \brief Reap completions and re-post receives and queued sends, in at most one syscall
+    //! \details Drains event_fd() as well, so call this when it is readable.
+    void service();
+
+    //! Packets reaped and waiting to be returned by receive()
+    size_t pending() const { return _received.size(); }
+
+    //! \brief The next received packet, servicing the ring first if none is pending
+    std::optional<Packet> receive();
+
+    //! \brief Queue a packet to be sent by the next flush() or service()
+    //! \param[in] payload is the packet
+    //! \param[in] destination is where to send it (for Kind::Socket)
+    void send(BufferList payload, const std::optional<Address> &destination = {});
+
+    //! Submit the queued sends
+    void flush();
+
+    //! \name Statistics
+    //!@{
+
+    //! syscalls made: ring submissions and registrations, plus event_fd() reads
+    uint64_t syscalls() const { return _ring.syscalls() + _event_reads; }
+
+    //! packets received
+    uint64_t packets_received() const { return _packets_received; }
+
+    //! packets sent
+    uint64_t packets_sent() const { return _packets_sent; }
+    //!@}
+
+    //! \name
+    //! A UringPacketIO cannot be copied or moved
+
+    //!@{
+    UringPacketIO(const UringPacketIO &other) = delete;
+    UringPacketIO &operator=(const UringPacketIO &other) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_IO_URING_HH
@@ -0,0 +1,30 @@
+#include "mapped_region.hh"
+
+#include "util.hh"
+
+#include <sys/mman.h>
+
+using namespace std;
+
+//! \param[in] fd is the file descriptor to map
+//! \param[in] length is the size of the mapping
+//! \param[in] offset selects what to map
+MappedRegion::MappedRegion(const FileDescriptor &fd, const size_t length, const off_t offset)
+    : _addr(::mmap(
+          nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd.fd_num(), offset))
+    , _length(length) {
+    if (_addr == MAP_FAILED) {
+        throw unix_error("mmap");
+    }
+}
+
+//! \param[in] length is the size of the mapping
+MappedRegion::MappedRegion(const size_t length)
+    : _addr(::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0))
+    , _length(length) {
+    if (_addr == MAP_FAILED) {
+        throw unix_error("mmap");
+    }
+}
+
+MappedRegion::~MappedRegion() { ::munmap(_addr, _length); }
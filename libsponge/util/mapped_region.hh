@@ -0,0 +1,36 @@
+#ifndef SPONGE_LIBSPONGE_MAPPED_REGION_HH
+#define SPONGE_LIBSPONGE_MAPPED_REGION_HH
+
+#include "file_descriptor.hh"
+
+#include <cstddef>
+#include <sys/types.h>
+
+//! A memory mapping that is unmapped on destruction
+class MappedRegion {
+  private:
+    void *_addr;
+    size_t _length;
+
+  public:
+    //! Map `length` bytes of `fd` at `offset`, shared
+    MappedRegion(const FileDescriptor &fd, const size_t length, const off_t offset);
+
+    //! Map `length` bytes of zeroed anonymous memory
+    explicit MappedRegion(const size_t length);
+
+    ~MappedRegion();
+
+    //! The start of the mapping
+    char *data() const { return static_cast<char *>(_addr); }
+
+    //! \name
+    //! A MappedRegion cannot be copied or moved
+
+    //!@{
+    MappedRegion(const MappedRegion &other) = delete;
+    MappedRegion &operator=(const MappedRegion &other) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_MAPPED_REGION_HH
@@ -0,0 +1,62 @@
+#include "packet_builder.hh"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+PacketBuilder::PacketBuilder(const size_t capacity, const size_t headroom)
+    : PacketBuilder(BufferPool{}, capacity, headroom) {}
+
+PacketBuilder::PacketBuilder(BufferPool pool, const size_t capacity, const size_t headroom)
+    : _pool(move(pool))
+    , _default_capacity(max(capacity, headroom))
+    , _headroom(headroom)
+    , _begin(headroom)
+    , _end(headroom) {}
+
+//! \details A new allocation keeps the packet so far, if any, at the same offset.
+void PacketBuilder::_prepare(const size_t tailroom) {
+    if (_storage and _storage.unique() and _end + tailroom <= _capacity) {
+        return;
+    }
+
+    auto allocation = _pool.allocate(max(_default_capacity, _end + tailroom));
+    if (_storage) {
+        memcpy(allocation.data + _begin, _bytes + _begin, size());
+    }
+    _storage = move(allocation.storage);
+    _bytes = allocation.data;
+    _capacity = allocation.capacity;
+}
+
+char *PacketBuilder::append(const size_t n) {
+    _prepare(n);
+    char *ret = _bytes + _end;
+    _end += n;
+    return ret;
+}
+
+void PacketBuilder::append(const string_view data) {
+    memcpy(append(data.size()), data.data(), data.size());
+}
+
+char *PacketBuilder::prepend(const size_t n) {
+    if (n > _begin) {
+        throw runtime_error("PacketBuilder::prepend: out of headroom");
+    }
+    _prepare(0);
+    _begin -= n;
+    return _bytes + _begin;
+}
+
+//! \details The builder keeps its share of the allocation, to reuse once the Buffer is gone.
+Buffer PacketBuilder::release() {
+    if (not _storage) {
+        return {};
+    }
+    Buffer ret{_storage, _end};
+    ret.remove_prefix(_begin);
+    _begin = _end = _headroom;
+    return ret;
+}
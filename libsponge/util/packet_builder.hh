@@ -0,0 +1,85 @@
+#ifndef SPONGE_LIBSPONGE_PACKET_BUILDER_HH
+#define SPONGE_LIBSPONGE_PACKET_BUILDER_HH
+
+#include "buffer.hh"
+#include "buffer_pool.hh"
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+//! \brief A packet under construction in one contiguous allocation, built from the inside out
+//! \details The innermost payload is appended first, leaving room in front of it; then each
+//! layer prepends its header in place (see e.g. TCPSegment::serialize(PacketBuilder &, uint32_t)).
+//! release() hands the finished packet over as a Buffer that shares the allocation, and the
+//! builder starts over: in the same allocation if that Buffer (and every copy of it) is gone by
+//! the next append() or prepend(), or else in a new one from its BufferPool. Either way, a steady
+//! stream of packets needs no `malloc`. Like the pool's, the released Buffers must stay on the
+//! builder's thread.
+class PacketBuilder {
+  public:
+    static constexpr size_t DEFAULT_HEADROOM = 14 + 60 + 60;  //!< Ethernet, IPv4 and TCP headers
+    static constexpr size_t DEFAULT_CAPACITY = BufferPool::MTU_BYTES;  //!< an Ethernet frame
+
+  private:
+    BufferPool _pool;
+    BufferStorage _storage{};
+    char *_bytes{};  //!< the allocation's bytes
+    size_t _capacity{0};
+    size_t _default_capacity;  //!< how big an allocation to ask for
+    size_t _headroom;
+    size_t _begin;  //!< where the packet starts in the allocation
+    size_t _end;    //!< where the packet ends in the allocation
+
+    //! Make sure the allocation exists and nothing else shares it, with room for `tailroom` bytes
+    void _prepare(const size_t tailroom);
+
+  public:
+    //! \brief An empty builder, with a pool of its own
+    //! \param[in] capacity is the size of allocation to use (it grows if a payload needs more)
+    //! \param[in] headroom is how much room for headers to leave in front of the payload
+    explicit PacketBuilder(const size_t capacity = DEFAULT_CAPACITY,
+                           const size_t headroom = DEFAULT_HEADROOM);
+
+    //! \brief An empty builder that allocates from `pool`
+    explicit PacketBuilder(BufferPool pool,
+                           const size_t capacity = DEFAULT_CAPACITY,
+                           const size_t headroom = DEFAULT_HEADROOM);
+
+    //! \brief Extend the packet at the back
+    //! \returns where to write the `n` new bytes
+    char *append(const size_t n);
+
+    //! \brief Copy `data` to the back of the packet
+    void append(const std::string_view data);
+
+    //! \brief Extend the packet at the front (throws if it runs out of headroom)
+    //! \returns where to write the `n` new bytes
+    char *prepend(const size_t n);
+
+    //! The packet so far
+    std::string_view str() const {
+        if (not _storage) {
+            return {};
+        }
+        return {_bytes + _begin, _end - _begin};
+    }
+
+    //! Size of the packet so far
+    size_t size() const { return _end - _begin; }
+
+    //! \brief Take the finished packet, and start a new (empty) one
+    Buffer release();
+
+    //! \name
+    //! A PacketBuilder can be moved, but not copied (its allocation is for it alone to write)
+
+    //!@{
+    PacketBuilder(const PacketBuilder &other) = delete;
+    PacketBuilder &operator=(const PacketBuilder &other) = delete;
+    PacketBuilder(PacketBuilder &&other) = default;
+    PacketBuilder &operator=(PacketBuilder &&other) = default;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_PACKET_BUILDER_HH
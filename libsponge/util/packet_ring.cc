@@ -0,0 +1,158 @@
+#include "packet_ring.hh"
+
+#include "util.hh"
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <stdexcept>
+#include <sys/socket.h>
+
+using namespace std;
+
+static constexpr size_t TX_BLOCK_COUNT = PacketRing::FRAME_COUNT * PacketRing::FRAME_SIZE /
+                                         PacketRing::BLOCK_BYTES;
+static constexpr size_t RX_RING_SIZE = PacketRing::BLOCK_BYTES * PacketRing::BLOCK_COUNT;
+static constexpr size_t TX_RING_SIZE = PacketRing::BLOCK_BYTES * TX_BLOCK_COUNT;
+
+//! where a transmitted frame starts in its slot
+static constexpr size_t TX_DATA_OFFSET = TPACKET3_HDRLEN - sizeof(sockaddr_ll);
+
+//! \details The socket is bound to the interface only after both rings are set up, so no frame
+//! arrives before there is somewhere to put it.
+PacketRing::PacketRing(const string &interface)
+    : FileDescriptor(SystemCall("socket", ::socket(AF_PACKET, SOCK_RAW, 0))) {
+    const int version = TPACKET_V3;
+    SystemCall("setsockopt",
+               ::setsockopt(fd_num(), SOL_PACKET, PACKET_VERSION, &version, sizeof(version)));
+
+    tpacket_req3 rx_request{};
+    rx_request.tp_block_size = BLOCK_BYTES;
+    rx_request.tp_block_nr = BLOCK_COUNT;
+    rx_request.tp_frame_size = FRAME_SIZE;
+    rx_request.tp_frame_nr = RX_RING_SIZE / FRAME_SIZE;
+    rx_request.tp_retire_blk_tov = BLOCK_TIMEOUT_MS;
+    SystemCall("setsockopt",
+               ::setsockopt(fd_num(), SOL_PACKET, PACKET_RX_RING, &rx_request, sizeof(rx_request)));
+
+    tpacket_req3 tx_request{};
+    tx_request.tp_block_size = BLOCK_BYTES;
+    tx_request.tp_block_nr = TX_BLOCK_COUNT;
+    tx_request.tp_frame_size = FRAME_SIZE;
+    tx_request.tp_frame_nr = FRAME_COUNT;
+    SystemCall("setsockopt",
+               ::setsockopt(fd_num(), SOL_PACKET, PACKET_TX_RING, &tx_request, sizeof(tx_request)));
+
+    // the receive ring comes first in the mapping, then the transmit ring
+    _map = make_shared<MappedRegion>(*this, RX_RING_SIZE + TX_RING_SIZE, 0);
+
+    sockaddr_ll address{};
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = ::if_nametoindex(interface.c_str());
+    if (address.sll_ifindex == 0) {
+        throw unix_error("if_nametoindex (" + interface + ")");
+    }
+    SystemCall(
+        "bind", ::bind(fd_num(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)));
+}
+
+//! \details The lease on the block shares ownership of the mapping, so the block can still be
+//! returned to the kernel (and viewed) if the PacketRing itself goes away first.
+bool PacketRing::_next_block() {
+    auto *block = reinterpret_cast<tpacket_block_desc *>(_map->data() + _rx_block * BLOCK_BYTES);
+    uint32_t *status = &block->hdr.bh1.block_status;
+    if ((__atomic_load_n(status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+        return false;
+    }
+
+    const auto give_back = [map = _map, status](const char *) {
+        __atomic_store_n(status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    };
+    _rx_lease = shared_ptr<const char>(reinterpret_cast<const char *>(block), give_back);
+    _rx_offset = block->hdr.bh1.offset_to_first_pkt;
+    _rx_remaining = block->hdr.bh1.num_pkts;
+    _rx_block = (_rx_block + 1) % BLOCK_COUNT;
+    return true;
+}
+
+//! \returns a Buffer viewing the frame in the ring, or nothing if no frame is waiting
+//! \details A frame sent from this host with checksum offload still has a partial checksum, and
+//! one the device has already verified needs no second check; either way it is checksum_ready.
+optional<PacketRing::received_frame> PacketRing::receive() {
+    register_read();
+    while (_rx_remaining > 0 or _next_block()) {
+        if (_rx_remaining == 0) {
+            _rx_lease.reset();  // an empty block
+            continue;
+        }
+
+        const char *frame = _rx_lease.get() + _rx_offset;
+        const auto *header = reinterpret_cast<const tpacket3_hdr *>(frame);
+        const auto *link =
+            reinterpret_cast<const sockaddr_ll *>(frame + TPACKET_ALIGN(sizeof(tpacket3_hdr)));
+
+        optional<received_frame> ret;
+        if (link->sll_pkttype != PACKET_OUTGOING) {
+            const shared_ptr<const char> data(_rx_lease, frame + header->tp_mac);
+            const bool checksum_ready =
+                (header->tp_status & (TP_STATUS_CSUMNOTREADY | TP_STATUS_CSUM_VALID)) != 0;
+            ret.emplace(received_frame{Buffer{data, header->tp_snaplen}, checksum_ready});
+        }
+
+        _rx_offset += header->tp_next_offset;
+        if (--_rx_remaining == 0) {
+            _rx_lease.reset();
+        }
+        if (ret.has_value()) {
+            return ret;
+        }
+    }
+    return {};
+}
+
+//! \param[in] frame is the whole Ethernet frame, which must fit in a slot
+//! \details A slot is free again once the kernel has transmitted it, so when the ring is full
+//! the queued frames are flushed to make room.
+bool PacketRing::send(const BufferViewList &frame) {
+    const size_t size = frame.size();
+    if (size > FRAME_SIZE - TX_DATA_OFFSET) {
+        throw runtime_error("PacketRing::send: frame too big for a slot");
+    }
+
+    char *slot = _map->data() + RX_RING_SIZE + _tx_slot * FRAME_SIZE;
+    auto *header = reinterpret_cast<tpacket3_hdr *>(slot);
+    if (__atomic_load_n(&header->tp_status, __ATOMIC_ACQUIRE) != TP_STATUS_AVAILABLE) {
+        flush();
+        if (__atomic_load_n(&header->tp_status, __ATOMIC_ACQUIRE) != TP_STATUS_AVAILABLE) {
+            return false;
+        }
+    }
+
+    char *data = slot + TX_DATA_OFFSET;
+    for (const auto &piece : frame.as_iovecs()) {
+        memcpy(data, piece.iov_base, piece.iov_len);
+        data += piece.iov_len;
+    }
+    header->tp_len = size;
+    header->tp_snaplen = size;
+    __atomic_store_n(&header->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+
+    _tx_slot = (_tx_slot + 1) % FRAME_COUNT;
+    _tx_queued++;
+    return true;
+}
+
+//! \details Does not wait for the frames to go out; their slots become free as they do.
+void PacketRing::flush() {
+    if (_tx_queued == 0) {
+        return;
+    }
+    const auto ret = ::sendto(fd_num(), nullptr, 0, MSG_DONTWAIT, nullptr, 0);
+    SystemCall("sendto", static_cast<int>(ret), EAGAIN);
+    register_write();
+    _tx_queued = 0;
+}
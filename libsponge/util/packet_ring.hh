@@ -0,0 +1,67 @@
+#ifndef SPONGE_LIBSPONGE_PACKET_RING_HH
+#define SPONGE_LIBSPONGE_PACKET_RING_HH
+
+#include "buffer.hh"
+#include "file_descriptor.hh"
+#include "mapped_region.hh"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+
+//! \brief A raw [packet(7)](\ref man7::packet) socket on one network interface, with
+//! memory-mapped TPACKET_V3 receive and transmit rings
+//! \details The kernel writes received frames into the blocks of the receive ring and hands
+//! over each block when it fills up or times out. receive() returns its frames one by one as
+//! Buffers that point into the ring, so nothing is copied. A block goes back to the kernel once
+//! all of its frames have been received and every Buffer viewing them is gone, so such Buffers
+//! should be dropped (or copied) promptly: while one is alive, its block cannot be refilled.
+//!
+//! send() copies a frame into the next slot of the transmit ring, and flush() has the kernel
+//! transmit every filled slot with one syscall. Frames this socket sends are not received by it.
+class PacketRing : public FileDescriptor {
+  public:
+    static constexpr size_t BLOCK_BYTES = 1 << 16;   //!< bytes per block of either ring
+    static constexpr size_t BLOCK_COUNT = 64;        //!< blocks in the receive ring
+    static constexpr unsigned BLOCK_TIMEOUT_MS = 1;  //!< longest a partly filled block waits
+    static constexpr size_t FRAME_SIZE = 2048;       //!< bytes per slot of the transmit ring
+    static constexpr size_t FRAME_COUNT = 512;       //!< slots in the transmit ring
+
+    //! A frame taken from the receive ring
+    struct received_frame {
+        Buffer frame;         //!< the whole Ethernet frame, viewing the ring
+        bool checksum_ready;  //!< the kernel vouches for (or has yet to fill in) its checksums
+    };
+
+  private:
+    std::shared_ptr<MappedRegion> _map{};  //!< both rings, kept alive by Buffers viewing them
+    size_t _rx_block{0};                   //!< next block to take from the kernel
+    std::shared_ptr<const char> _rx_lease{};  //!< block being received; returned when released
+    size_t _rx_offset{0};                     //!< next frame's offset in that block
+    size_t _rx_remaining{0};                  //!< frames left in that block
+    size_t _tx_slot{0};                       //!< next slot to fill
+    size_t _tx_queued{0};                     //!< slots filled since the last flush()
+
+    //! Take the next block from the kernel, if it has handed it over
+    bool _next_block();
+
+  public:
+    //! Open a packet socket on the interface named `interface` (e.g. one end of a veth pair)
+    explicit PacketRing(const std::string &interface);
+
+    //! Receive the next frame, if any, as a view into the receive ring
+    std::optional<received_frame> receive();
+
+    //! Frames already handed over by the kernel and ready to receive()
+    size_t pending() const { return _rx_remaining; }
+
+    //! \brief Queue a frame in the transmit ring
+    //! \returns `false` if the ring is full even after a flush() (the frame is dropped)
+    bool send(const BufferViewList &frame);
+
+    //! Transmit every frame queued by send()
+    void flush();
+};
+
+#endif  // SPONGE_LIBSPONGE_PACKET_RING_HH
@@ -25,21 +25,28 @@ void NetParser::_check_size(const size_t size) {
 
 template <typename T>
 T NetParser::_parse_int() {
-    constexpr size_t len = sizeof(T);
-    _check_size(len);
+    const HeaderView field = header(sizeof(T));
     if (error()) {
         return 0;
     }
 
-    T ret = 0;
-    for (size_t i = 0; i < len; i++) {
-        ret <<= 8;
-        ret += uint8_t(_buffer.at(i));
+    if constexpr (sizeof(T) == 4) {
+        return field.u32(0);
+    } else if constexpr (sizeof(T) == 2) {
+        return field.u16(0);
+    } else {
+        return field.u8(0);
     }
+}
 
-    _buffer.remove_prefix(len);
-
-    return ret;
+//! \details Taking the last bytes off a Buffer drops its reference to them, which may be the only
+//! one; they are moved to `_consumed` instead.
+void NetParser::_advance(const size_t n) {
+    if (n > 0 and n == _buffer.size()) {
+        swap(_consumed, _buffer);
+    } else {
+        _buffer.remove_prefix(n);
+    }
 }
 
 void NetParser::remove_prefix(const size_t n) {
@@ -47,7 +54,17 @@ void NetParser::remove_prefix(const size_t n) {
     if (error()) {
         return;
     }
-    _buffer.remove_prefix(n);
+    _advance(n);
+}
+
+HeaderView NetParser::header(const size_t n) {
+    _check_size(n);
+    if (error()) {
+        return HeaderView{};
+    }
+    const HeaderView ret{_buffer.str().substr(0, n)};
+    _advance(n);
+    return ret;
 }
 
 template <typename T>
@@ -5,7 +5,10 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <endian.h>
 #include <string>
+#include <string_view>
 #include <utility>
 
 //! The result of parsing or unparsing an IP datagram, TCP segment, Ethernet frame, or ARP message
@@ -22,22 +25,58 @@ enum class ParseResult {
 //! Output a string representation of a ParseResult
 std::string as_string(const ParseResult r);
 
+//! \brief A view of a header whose length has already been checked, read field by field
+//! \details Each field is read from its fixed offset with one load and a byte swap, without any
+//! further bounds checks: offsets must lie within the view.
+class HeaderView {
+  private:
+    std::string_view _bytes;
+
+    template <typename T>
+    T _load(const size_t offset) const {
+        T ret;
+        std::memcpy(&ret, _bytes.data() + offset, sizeof(T));
+        return ret;
+    }
+
+  public:
+    explicit HeaderView(const std::string_view bytes = {}) : _bytes(bytes) {}
+
+    //! The header's bytes
+    std::string_view str() const { return _bytes; }
+
+    //! Length of the header
+    size_t size() const { return _bytes.size(); }
+
+    //! \name Read an integer in network byte order at `offset`
+    //!@{
+    uint8_t u8(const size_t offset) const { return _bytes[offset]; }
+    uint16_t u16(const size_t offset) const { return be16toh(_load<uint16_t>(offset)); }
+    uint32_t u32(const size_t offset) const { return be32toh(_load<uint32_t>(offset)); }
+    //!@}
+};
+
 class NetParser {
   private:
     Buffer _buffer;
+    Buffer _consumed{};  //!< the bytes once all are parsed, for views that still read them
     ParseResult _error = ParseResult::NoError;  //!< Result of parsing so far
 
     //! Check that there is sufficient data to parse the next token
     void _check_size(const size_t size);
 
+    //! Move past `n` bytes, keeping them alive even if they are the last ones
+    void _advance(const size_t n);
+
     //! Generic integer parsing method (used by u32, u16, u8)
     template <typename T>
     T _parse_int();
 
   public:
-    NetParser(Buffer buffer) : _buffer(buffer) {}
+    NetParser(Buffer buffer) : _buffer(std::move(buffer)) {}
 
-    Buffer buffer() const { return _buffer; }
+    //! The data not yet parsed
+    const Buffer &buffer() const { return _buffer; }
 
     //! Get the current value stored in BaseParser::_error
     ParseResult get_error() const { return _error; }
@@ -60,6 +99,11 @@ class NetParser {
 
     //! Remove n bytes from the buffer
     void remove_prefix(const size_t n);
+
+    //! \brief Take the next `n` bytes as one header, checking the length only once
+    //! \returns the header, or an empty view (with a PacketTooShort error) if there is too little
+    //! data. The view stays valid as long as the NetParser, or the Buffer it was constructed from.
+    HeaderView header(const size_t n);
 };
 
 struct NetUnparser {
@@ -74,6 +118,19 @@ struct NetUnparser {
 
     //! Write an 8-bit integer into the data stream in network byte order
     static void u8(std::string &s, const uint8_t val);
+
+    //! \name Write an integer in network byte order in place, at `destination`
+    //!@{
+    static void u32(char *destination, const uint32_t val) { _store(destination, htobe32(val)); }
+    static void u16(char *destination, const uint16_t val) { _store(destination, htobe16(val)); }
+    static void u8(char *destination, const uint8_t val) { *destination = char(val); }
+    //!@}
+
+  private:
+    template <typename T>
+    static void _store(char *destination, const T val) {
+        std::memcpy(destination, &val, sizeof(T));
+    }
 };
 
 #endif  // SPONGE_LIBSPONGE_PARSER_HH
@@ -0,0 +1,399 @@
+#include "prefix_table.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+//! The bits of a prefix of `length` bits
+static uint32_t mask(const uint8_t length) { return length == 0 ? 0 : ~0U << (32 - length); }
+
+PrefixTable::PrefixTable(const size_t max_chunks)
+    : _chunks(), _chunk_lengths(), _chunk_published(), _published(new Root{}) {
+    if (max_chunks > CHILD) {
+        throw runtime_error("PrefixTable: too many chunks");
+    }
+    _chunks.reserve(max_chunks);
+    _chunk_lengths.reserve(max_chunks);
+    _chunk_published.reserve(max_chunks);
+}
+
+PrefixTable::~PrefixTable() {
+    delete _published.load();
+    for (const auto &retired : _retired) {
+        delete retired.root.root;
+    }
+    for (const auto &spare : _spare_roots) {
+        delete spare.root;
+    }
+}
+
+//! \details `slots` and `lengths` may be another chunk's: the vectors never reallocate.
+uint32_t PrefixTable::_allocate(const Slots &slots, const Lengths &lengths) {
+    uint32_t index;
+    if (not _free_chunks.empty()) {
+        index = _free_chunks.back();
+        _free_chunks.pop_back();
+        _chunks[index] = slots;
+        _chunk_lengths[index] = lengths;
+        _chunk_published[index] = false;
+    } else if (_chunks.size() < _chunks.capacity()) {
+        index = _chunks.size();
+        _chunks.push_back(slots);
+        _chunk_lengths.push_back(lengths);
+        _chunk_published.push_back(false);
+    } else {
+        throw runtime_error("PrefixTable: out of chunks");
+    }
+    _fresh_chunks.push_back(index);
+    return index;
+}
+
+uint32_t PrefixTable::_writable(uint32_t &slot) {
+    const uint32_t index = slot & ~CHILD;
+    if (not _chunk_published[index]) {
+        return index;
+    }
+    const uint32_t copy = _allocate(_chunks[index], _chunk_lengths[index]);
+    _replaced_chunks.push_back(index);
+    slot = CHILD | copy;
+    return copy;
+}
+
+//! \details A new chunk starts out with the slot's entry in all of its slots, so lookups that
+//! end there find what they found before.
+uint32_t PrefixTable::_expand(uint32_t &slot, uint8_t &length) {
+    if (slot & CHILD) {
+        return _writable(slot);
+    }
+    Slots slots;
+    slots.fill(slot);
+    Lengths lengths;
+    lengths.fill(length);
+    const uint32_t index = _allocate(slots, lengths);
+    slot = CHILD | index;
+    length = 0;
+    return index;
+}
+
+bool PrefixTable::_changes(const uint32_t slot,
+                           const uint8_t length,
+                           const Assignment &assignment) const {
+    if (slot & CHILD) {
+        const uint32_t index = slot & ~CHILD;
+        for (size_t i = 0; i < CHUNK_SLOTS; i++) {
+            if (_changes(_chunks[index][i], _chunk_lengths[index][i], assignment)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return length >= assignment.min_length and length <= assignment.max_length and
+           (slot != assignment.entry or length != assignment.length);
+}
+
+//! \details A published chunk is only copied if something in it (or below it) will change.
+void PrefixTable::_assign(uint32_t &slot, uint8_t &length, const Assignment &assignment) {
+    if (slot & CHILD) {
+        if (_chunk_published[slot & ~CHILD] and not _changes(slot, length, assignment)) {
+            return;
+        }
+        const uint32_t index = _writable(slot);
+        for (size_t i = 0; i < CHUNK_SLOTS; i++) {
+            _assign(_chunks[index][i], _chunk_lengths[index][i], assignment);
+        }
+    } else if (length >= assignment.min_length and length <= assignment.max_length) {
+        slot = assignment.entry;
+        length = assignment.length;
+    }
+}
+
+//! \details A prefix of up to 16 bits covers a run of root slots. A longer one covers a run of
+//! slots in a chunk below the root slot it falls in (and, past 24 bits, below a second-level
+//! slot too), so the chunks on the way there are made (or copied, if published) first.
+void PrefixTable::_apply(const uint32_t prefix,
+                         const uint8_t length,
+                         const Assignment &assignment) {
+    const size_t top = prefix >> 16;
+    if (length <= 16) {
+        const size_t count = size_t{1} << (16 - length);
+        _root_changed(top, count);
+        for (size_t i = top; i < top + count; i++) {
+            _assign(_root[i], _root_lengths[i], assignment);
+        }
+        return;
+    }
+
+    _root_changed(top, 1);
+    uint32_t index = _expand(_root[top], _root_lengths[top]);
+    size_t first = (prefix >> 8) & 0xff;
+    if (length > 24) {
+        index = _expand(_chunks[index][first], _chunk_lengths[index][first]);
+        first = prefix & 0xff;
+    }
+
+    const size_t count = size_t{1} << ((length > 24 ? 32 : 24) - length);
+    for (size_t i = first; i < first + count; i++) {
+        _assign(_chunks[index][i], _chunk_lengths[index][i], assignment);
+    }
+}
+
+void PrefixTable::_root_changed(const size_t first, const size_t count) {
+    if (_root_rewritten) {
+        return;
+    }
+    if (_changed_slots.size() + count > MAX_CHANGED_SLOTS) {
+        _root_rewritten = true;
+        _changed_slots.clear();
+        return;
+    }
+    for (size_t i = first; i < first + count; i++) {
+        _changed_slots.push_back(i);
+    }
+}
+
+//! \details A spare root holds some earlier version. If every version since then is in
+//! `_root_changes`, copying the slots they (and the next version) changed is enough.
+PrefixTable::Root *PrefixTable::_next_root() {
+    if (_spare_roots.empty()) {
+        Root *root = new Root;
+        copy(_root.begin(), _root.end(), root->begin());
+        return root;
+    }
+
+    const VersionedRoot spare = _spare_roots.back();
+    _spare_roots.pop_back();
+    Root &root = *spare.root;
+    if (_root_rewritten or spare.version < _patchable) {
+        copy(_root.begin(), _root.end(), root.begin());
+        return spare.root;
+    }
+    for (const auto &changes : _root_changes) {
+        if (changes.version > spare.version) {
+            for (const uint32_t i : changes.slots) {
+                root[i] = _root[i];
+            }
+        }
+    }
+    for (const uint32_t i : _changed_slots) {
+        root[i] = _root[i];
+    }
+    return spare.root;
+}
+
+void PrefixTable::_drop(const uint32_t slot) {
+    if (not(slot & CHILD)) {
+        return;
+    }
+    const uint32_t index = slot & ~CHILD;
+    for (const uint32_t below : _chunks[index]) {
+        _drop(below);
+    }
+    if (_chunk_published[index]) {
+        _replaced_chunks.push_back(index);
+    } else {
+        _free_chunks.push_back(index);
+    }
+}
+
+//! \details Lookups find the same entry either way; the slot takes the length its chunk's slots
+//! had, so that later changes overwrite it exactly when they would have overwritten them.
+void PrefixTable::_merge(uint32_t &slot, uint8_t &length) {
+    if (not(slot & CHILD)) {
+        return;
+    }
+    const uint32_t index = slot & ~CHILD;
+    const Slots &slots = _chunks[index];
+    const Lengths &lengths = _chunk_lengths[index];
+    if (slots[0] & CHILD) {
+        return;
+    }
+    for (size_t i = 1; i < CHUNK_SLOTS; i++) {
+        if (slots[i] != slots[0] or lengths[i] != lengths[0]) {
+            return;
+        }
+    }
+    const uint32_t chunk = slot;
+    slot = slots[0];
+    length = lengths[0];
+    _drop(chunk);
+}
+
+//! \details The third-level chunk (if any) is merged first, as that may leave the second-level
+//! one uniform too. _apply() has already noted the root slot as changed.
+void PrefixTable::_collapse(const uint32_t prefix, const uint8_t length) {
+    const size_t top = prefix >> 16;
+    if (length <= 16 or not(_root[top] & CHILD)) {
+        return;
+    }
+    if (length > 24) {
+        const uint32_t index = _root[top] & ~CHILD;
+        const size_t second = (prefix >> 8) & 0xff;
+        _merge(_chunks[index][second], _chunk_lengths[index][second]);
+    }
+    _merge(_root[top], _root_lengths[top]);
+}
+
+//! \details Reclaimed roots are kept (the newest few) to be recycled, and the root changes
+//! that neither they nor the retired roots need any more are forgotten.
+void PrefixTable::_reclaim() {
+    while (not _retired.empty() and _epochs.reclaimable(_retired.front().tag)) {
+        auto &retired = _retired.front();
+        _spare_roots.push_back(retired.root);
+        _free_chunks.insert(_free_chunks.end(), retired.chunks.begin(), retired.chunks.end());
+        _retired.pop_front();
+    }
+    if (_spare_roots.size() > MAX_SPARE_ROOTS) {
+        const auto extra = _spare_roots.size() - MAX_SPARE_ROOTS;
+        for (auto it = _spare_roots.begin(); it != _spare_roots.begin() + extra; it++) {
+            delete it->root;
+        }
+        _spare_roots.erase(_spare_roots.begin(), _spare_roots.begin() + extra);
+    }
+
+    uint64_t oldest = _version;
+    for (const auto &spare : _spare_roots) {
+        oldest = min(oldest, spare.version);
+    }
+    for (const auto &retired : _retired) {
+        oldest = min(oldest, retired.root.version);
+    }
+    while (not _root_changes.empty() and _root_changes.front().version <= oldest) {
+        _root_changes.pop_front();
+    }
+    _patchable = max(_patchable, oldest);
+}
+
+void PrefixTable::Snapshot::lookup(const uint32_t *addresses,
+                                   const size_t count,
+                                   optional<Value> *values) const {
+    array<uint32_t, LOOKUP_BATCH> slots;
+    for (size_t first = 0; first < count; first += LOOKUP_BATCH) {
+        const uint32_t *batch = addresses + first;
+        const size_t n = min(LOOKUP_BATCH, count - first);
+
+        for (size_t i = 0; i < n; i++) {
+            __builtin_prefetch(&(*_root)[batch[i] >> 16]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            slots[i] = (*_root)[batch[i] >> 16];
+            if (slots[i] & CHILD) {
+                __builtin_prefetch(&_chunks[slots[i] & ~CHILD][(batch[i] >> 8) & 0xff]);
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (slots[i] & CHILD) {
+                slots[i] = _chunks[slots[i] & ~CHILD][(batch[i] >> 8) & 0xff];
+                if (slots[i] & CHILD) {
+                    __builtin_prefetch(&_chunks[slots[i] & ~CHILD][batch[i] & 0xff]);
+                }
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (slots[i] & CHILD) {
+                slots[i] = _chunks[slots[i] & ~CHILD][batch[i] & 0xff];
+            }
+            values[first + i] = slots[i] == EMPTY ? optional<Value>{} : slots[i] - 1;
+        }
+    }
+}
+
+void PrefixTable::insert(const uint32_t prefix, const uint8_t length, const Value value) {
+    if (length > 32) {
+        throw runtime_error("PrefixTable: prefix longer than 32 bits");
+    }
+    if (value > MAX_VALUE) {
+        throw runtime_error("PrefixTable: value too big");
+    }
+
+    const uint32_t address = prefix & mask(length);
+    if (_prefixes[length].insert_or_assign(address, value).second) {
+        _size++;
+    }
+    _apply(address, length, {value + 1, length, 0, length});
+}
+
+//! \details The slots the prefix filled are exactly those it covers that are still marked
+//! with its length. They go to the longest shorter prefix that covers it (the same one for
+//! all of them), or become empty. Chunks that are left holding one entry throughout are
+//! merged back into the slot above them, so erasing what was inserted frees its chunks again.
+bool PrefixTable::erase(const uint32_t prefix, const uint8_t length) {
+    if (length > 32) {
+        return false;
+    }
+    const uint32_t address = prefix & mask(length);
+    if (_prefixes[length].erase(address) == 0) {
+        return false;
+    }
+    _size--;
+
+    Assignment assignment{EMPTY, 0, length, length};
+    for (uint8_t shorter = length; shorter-- > 0;) {
+        const auto it = _prefixes[shorter].find(address & mask(shorter));
+        if (it != _prefixes[shorter].end()) {
+            assignment.entry = it->second + 1;
+            assignment.length = shorter;
+            break;
+        }
+    }
+    _apply(address, length, assignment);
+    _collapse(address, length);
+    return true;
+}
+
+optional<PrefixTable::Value> PrefixTable::find(const uint32_t prefix, const uint8_t length) const {
+    if (length > 32) {
+        return {};
+    }
+    const auto it = _prefixes[length].find(prefix & mask(length));
+    if (it == _prefixes[length].end()) {
+        return {};
+    }
+    return it->second;
+}
+
+//! \details The chunks that were published stay as they are until no reader can see them;
+//! the fresh ones are part of no published version, and are reused right away.
+void PrefixTable::publish() {
+    for (const uint32_t index : _fresh_chunks) {
+        _chunk_published[index] = true;
+    }
+    _fresh_chunks.clear();
+
+    Root *root = _next_root();
+    _version++;
+    if (_root_rewritten) {
+        _root_changes.clear();
+        _patchable = _version;
+    } else {
+        _root_changes.push_back({_version, move(_changed_slots)});
+    }
+    _changed_slots.clear();
+    _root_rewritten = false;
+
+    Root *old = _published.exchange(root, memory_order_seq_cst);
+    _retired.push_back({_epochs.retire(), {old, _version - 1}, move(_replaced_chunks)});
+    _replaced_chunks.clear();
+    _reclaim();
+}
+
+void PrefixTable::replace(const vector<Entry> &entries) {
+    for (const uint32_t slot : _root) {
+        _drop(slot);
+    }
+    _fresh_chunks.clear();
+    fill(_root.begin(), _root.end(), EMPTY);
+    fill(_root_lengths.begin(), _root_lengths.end(), 0);
+    _root_rewritten = true;
+    _changed_slots.clear();
+    for (auto &prefixes : _prefixes) {
+        prefixes.clear();
+    }
+    _size = 0;
+
+    for (const auto &entry : entries) {
+        insert(entry.prefix, entry.length, entry.value);
+    }
+    publish();
+}
@@ -0,0 +1,268 @@
+#ifndef SPONGE_LIBSPONGE_PREFIX_TABLE_HH
+#define SPONGE_LIBSPONGE_PREFIX_TABLE_HH
+
+#include "epoch.hh"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//! \brief A longest-prefix-match table from IPv4 prefixes to small integers, which can be
+//! changed while other threads look up addresses in it
+//! \details A multibit trie with strides of 16, 8 and 8 bits: DIR-24-8 with its first level
+//! split in two, so that an empty table takes 256 KiB rather than 64 MiB. A prefix is
+//! expanded into every slot it covers on the level its length ends in, and a slot covered by
+//! a longer prefix points to a chunk of 256 slots on the level below. A lookup therefore reads
+//! at most three slots, one per level, whatever the number of prefixes. Each slot remembers
+//! the length of the prefix that filled it, so prefixes can be inserted in any order: a longer
+//! prefix overwrites a shorter one's slots, and never the other way around.
+//!
+//! Readers see an immutable version of the table, published by the writer with one atomic
+//! store of the root array's address. insert() and erase() change the next version, copying
+//! any published chunk before changing it, and publish() makes their changes visible all at
+//! once. Old versions are freed once no reader can still be using them, as tracked by
+//! epochs(). A reader never waits for the writer.
+//!
+//! Root arrays are recycled rather than copied whole: once no reader can see an old one, the
+//! next publish() brings it up to date by copying just the root slots changed since, so a
+//! small change costs a few slots and chunks, not 256 KiB.
+//!
+//! Threading rules: one thread at a time may call the non-const methods and lookup() (the
+//! writer). Any number of others may take a snapshot() and look up addresses in it, each
+//! within a Guard of its own EpochDomain::Reader.
+class PrefixTable {
+  public:
+    using Value = uint32_t;
+
+    static constexpr Value MAX_VALUE = (1U << 31) - 2;  //!< largest value the table can hold
+
+    static constexpr size_t DEFAULT_MAX_CHUNKS = 1 << 14;  //!< room for ~64k prefixes, twice
+    static constexpr size_t FULL_TABLE_CHUNKS = 1 << 18;   //!< room for ~1M prefixes, twice
+
+    //! A prefix and its value, for replace()
+    struct Entry {
+        uint32_t prefix;
+        uint8_t length;
+        Value value;
+    };
+
+  private:
+    static constexpr uint32_t CHILD = 1U << 31;  //!< slot points to a chunk, not a value
+    static constexpr uint32_t EMPTY = 0;         //!< slot matches no prefix
+    static constexpr size_t ROOT_SLOTS = 1 << 16;
+    static constexpr size_t CHUNK_SLOTS = 1 << 8;
+
+    //! Changed root slots past which publish() copies the whole root array
+    static constexpr size_t MAX_CHANGED_SLOTS = ROOT_SLOTS / 16;
+    static constexpr size_t MAX_SPARE_ROOTS = 4;  //!< retired root arrays kept for recycling
+    static constexpr size_t LOOKUP_BATCH = 64;    //!< addresses a batched lookup does together
+
+    //! One version's root slots, each holding `EMPTY`, `CHILD` plus a chunk index, or a value
+    //! plus one
+    using Root = std::array<uint32_t, ROOT_SLOTS>;
+
+    //! A chunk's slots, which hold the same as a root's
+    using Slots = std::array<uint32_t, CHUNK_SLOTS>;
+    using Lengths = std::array<uint8_t, CHUNK_SLOTS>;  //!< length of the prefix in each slot
+
+  public:
+    //! \brief One published version of the table
+    //! \note Valid only for as long as the reader that took it stays entered
+    class Snapshot {
+      private:
+        const Root *_root;
+        const Slots *_chunks;
+
+      public:
+        Snapshot(const Root *root, const Slots *chunks) : _root(root), _chunks(chunks) {}
+        Snapshot(const Snapshot &other) = default;
+        Snapshot &operator=(const Snapshot &other) = default;
+
+        //! The value of the longest prefix that matches `address`, if any does
+        std::optional<Value> lookup(const uint32_t address) const {
+            uint32_t slot = (*_root)[address >> 16];
+            if (slot & CHILD) {
+                slot = _chunks[slot & ~CHILD][(address >> 8) & 0xff];
+                if (slot & CHILD) {
+                    slot = _chunks[slot & ~CHILD][address & 0xff];
+                }
+            }
+            if (slot == EMPTY) {
+                return {};
+            }
+            return slot - 1;
+        }
+
+        //! \brief Look up `count` addresses at once, storing the values in `values`
+        //! \details Each level's slots are prefetched for every address before any of them is
+        //! read, so that their cache misses overlap rather than follow one another.
+        void lookup(const uint32_t *addresses,
+                    const size_t count,
+                    std::optional<Value> *values) const;
+    };
+
+  private:
+    //! What _assign() puts in the slots whose prefix length is in [min_length, max_length]
+    struct Assignment {
+        uint32_t entry;
+        uint8_t length;
+        uint8_t min_length;
+        uint8_t max_length;
+    };
+
+    //! A root array, and the version it holds
+    struct VersionedRoot {
+        Root *root;
+        uint64_t version;
+    };
+
+    //! A version that readers may still be using, and the chunks only it reaches
+    struct Retired {
+        uint64_t tag;
+        VersionedRoot root;
+        std::vector<uint32_t> chunks;
+    };
+
+    //! The root slots that one version changed
+    struct RootChanges {
+        uint64_t version;
+        std::vector<uint32_t> slots;
+    };
+
+    //! \name Chunks of 256 slots on the second and third levels
+    //! Reserved up front, so that they never move. Readers only see `_chunks`.
+    //!@{
+    std::vector<Slots> _chunks;
+    std::vector<Lengths> _chunk_lengths;
+    std::vector<bool> _chunk_published;  //!< reachable by readers, so copied to be changed
+    //!@}
+
+    std::vector<uint32_t> _free_chunks{};      //!< indices of unused chunks
+    std::vector<uint32_t> _fresh_chunks{};     //!< chunks allocated since the last publish()
+    std::vector<uint32_t> _replaced_chunks{};  //!< published chunks the next version drops
+
+    //! \name The next version's root
+    //!@{
+    std::vector<uint32_t> _root = std::vector<uint32_t>(ROOT_SLOTS, EMPTY);
+    std::vector<uint8_t> _root_lengths = std::vector<uint8_t>(ROOT_SLOTS, 0);
+    std::vector<uint32_t> _changed_slots{};  //!< root slots changed since the last publish()
+    bool _root_rewritten{false};             //!< too many to list: copy them all
+    //!@}
+
+    //! \name Published roots
+    //!@{
+    std::atomic<Root *> _published;  //!< the current version's root
+    uint64_t _version{0};            //!< the current version
+    std::deque<Retired> _retired{};
+    std::vector<VersionedRoot> _spare_roots{};  //!< retired roots that no reader can see
+    std::deque<RootChanges> _root_changes{};    //!< what each version after `_patchable` changed
+    uint64_t _patchable{0};  //!< oldest version a spare root can be brought up to date from
+    //!@}
+
+    EpochDomain _epochs{};
+
+    //! every prefix in the next version, by length
+    std::array<std::unordered_map<uint32_t, Value>, 33> _prefixes{};
+    size_t _size{0};
+
+    //! A new unpublished chunk with the given contents
+    uint32_t _allocate(const Slots &slots, const Lengths &lengths);
+
+    //! The chunk a `CHILD` slot points to, first replaced by a copy if it is published
+    uint32_t _writable(uint32_t &slot);
+
+    //! The chunk below a slot, made from the slot's contents if there is none yet
+    uint32_t _expand(uint32_t &slot, uint8_t &length);
+
+    //! Would _assign() change a slot, or the slots of the chunks below it?
+    bool _changes(const uint32_t slot, const uint8_t length, const Assignment &assignment) const;
+
+    //! Assign to a slot, or to the slots of the chunks below it
+    void _assign(uint32_t &slot, uint8_t &length, const Assignment &assignment);
+
+    //! Assign to every slot that `prefix`/`length` covers
+    void _apply(const uint32_t prefix, const uint8_t length, const Assignment &assignment);
+
+    //! Note that `count` root slots from `first` on may change in the next version
+    void _root_changed(const size_t first, const size_t count);
+
+    //! A root array holding the next version, recycled if one is spare
+    Root *_next_root();
+
+    //! Drop every chunk below a slot (freeing unpublished ones at once)
+    void _drop(const uint32_t slot);
+
+    //! Put a chunk's entry back in the slot above it, and drop it, if all its slots hold it
+    void _merge(uint32_t &slot, uint8_t &length);
+
+    //! Merge the chunks on the way to `prefix`/`length` that an erase() left uniform
+    void _collapse(const uint32_t prefix, const uint8_t length);
+
+    //! Free the versions that no reader can still be using
+    void _reclaim();
+
+  public:
+    //! \param[in] max_chunks is the most chunks the table can use, at 1280 bytes each (address
+    //! space for them is reserved up front, but memory is only used as they are); a table the
+    //! size of the Internet's needs FULL_TABLE_CHUNKS
+    explicit PrefixTable(const size_t max_chunks = DEFAULT_MAX_CHUNKS);
+    ~PrefixTable();
+
+    PrefixTable(const PrefixTable &other) = delete;
+    PrefixTable &operator=(const PrefixTable &other) = delete;
+
+    //! \name Changes, which take effect at the next publish()
+    //!@{
+
+    //! \brief Map `prefix`/`length` to `value`, replacing any value it had
+    //! \details Bits of `prefix` beyond `length` are ignored.
+    void insert(const uint32_t prefix, const uint8_t length, const Value value);
+
+    //! \brief Remove `prefix`/`length`, so that its addresses match the next longest prefix
+    //! \returns `false` if the table has no such prefix
+    bool erase(const uint32_t prefix, const uint8_t length);
+    //!@}
+
+    //! Make every change since the last publish() visible to readers, all at once
+    void publish();
+
+    //! Replace every prefix with `entries`, and publish()
+    void replace(const std::vector<Entry> &entries);
+
+    //! The domain that readers must enter before taking a snapshot()
+    EpochDomain &epochs() { return _epochs; }
+
+    //! The current version, for a reader inside epochs()
+    Snapshot snapshot() const {
+        return {_published.load(std::memory_order_seq_cst), _chunks.data()};
+    }
+
+    //! \brief Look up `address` in the current version
+    //! \note For the writer's thread; other threads need a snapshot()
+    std::optional<Value> lookup(const uint32_t address) const {
+        return snapshot().lookup(address);
+    }
+
+    //! \brief The value of exactly `prefix`/`length` in the next version, if the table has it
+    //! \note For the writer's thread
+    std::optional<Value> find(const uint32_t prefix, const uint8_t length) const;
+
+    //! Number of prefixes in the next version
+    size_t size() const { return _size; }
+
+    //! Number of chunks in use, by the next version or by versions readers may still see
+    size_t chunks() const { return _chunks.size() - _free_chunks.size(); }
+
+    //! Bytes taken by the next version's root and the chunks in use
+    size_t bytes() const {
+        return _root.size() * (sizeof(uint32_t) + sizeof(uint8_t)) +
+               chunks() * (sizeof(Slots) + sizeof(Lengths));
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_PREFIX_TABLE_HH
@@ -0,0 +1,129 @@
+#ifndef SPONGE_LIBSPONGE_SMALL_VECTOR_HH
+#define SPONGE_LIBSPONGE_SMALL_VECTOR_HH
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+//! \brief A sequence that keeps up to `N` elements inline, and more on the heap
+//! \details The elements are contiguous, so data() can be handed to e.g. writev(2). Elements can
+//! also be removed from the front, as from a queue: the front moves up, until the next
+//! push_back() that would otherwise need the heap moves the elements back down. `T` must be
+//! default-constructible; an unused inline slot holds a default-constructed `T`.
+template <typename T, size_t N>
+class SmallVector {
+  private:
+    std::array<T, N> _inline{};
+    std::vector<T> _heap{};  //!< the elements instead, once there are too many for `_inline`
+    bool _spilled{false};    //!< whether the elements are in `_heap`
+    size_t _begin{0};        //!< index of the front element (in `_inline` or `_heap`)
+    size_t _size{0};
+
+    T *_base() { return _spilled ? _heap.data() : _inline.data(); }
+    const T *_base() const { return _spilled ? _heap.data() : _inline.data(); }
+
+  public:
+    SmallVector() = default;
+
+    //! \name Copying and moving
+    //! A moved-from SmallVector is empty.
+    //!@{
+    SmallVector(const SmallVector &other) = default;
+    SmallVector &operator=(const SmallVector &other) = default;
+
+    SmallVector(SmallVector &&other) noexcept
+        : _inline(std::move(other._inline))
+        , _heap(std::move(other._heap))
+        , _spilled(std::exchange(other._spilled, false))
+        , _begin(std::exchange(other._begin, 0))
+        , _size(std::exchange(other._size, 0)) {}
+
+    SmallVector &operator=(SmallVector &&other) noexcept {
+        _inline = std::move(other._inline);
+        _heap = std::move(other._heap);
+        _spilled = std::exchange(other._spilled, false);
+        _begin = std::exchange(other._begin, 0);
+        _size = std::exchange(other._size, 0);
+        return *this;
+    }
+    //!@}
+
+    ~SmallVector() = default;
+
+    //! \name Element access
+    //!@{
+    T *data() { return _base() + _begin; }
+    const T *data() const { return _base() + _begin; }
+
+    T &operator[](const size_t i) { return data()[i]; }
+    const T &operator[](const size_t i) const { return data()[i]; }
+
+    T &front() { return data()[0]; }
+    const T &front() const { return data()[0]; }
+
+    T &back() { return data()[_size - 1]; }
+    const T &back() const { return data()[_size - 1]; }
+
+    T *begin() { return data(); }
+    const T *begin() const { return data(); }
+
+    T *end() { return data() + _size; }
+    const T *end() const { return data() + _size; }
+    //!@}
+
+    //! Number of elements
+    size_t size() const { return _size; }
+
+    //! Whether there are no elements
+    bool empty() const { return _size == 0; }
+
+    //! Add an element at the back
+    void push_back(T value) {
+        if (not _spilled and _begin + _size == N) {
+            if (_begin > 0) {
+                std::move(_inline.begin() + _begin, _inline.end(), _inline.begin());
+                std::fill(_inline.end() - _begin, _inline.end(), T{});
+                _begin = 0;
+            } else {
+                _heap.reserve(2 * N);
+                std::move(_inline.begin(), _inline.end(), std::back_inserter(_heap));
+                _inline.fill(T{});
+                _spilled = true;
+            }
+        }
+
+        if (_spilled) {
+            _heap.push_back(std::move(value));
+        } else {
+            _inline[_begin + _size] = std::move(value);
+        }
+        _size++;
+    }
+
+    //! Remove the front element
+    void pop_front() {
+        front() = T{};
+        _begin++;
+        _size--;
+        if (_size == 0) {
+            clear();
+        } else if (_spilled and _begin > _size) {
+            _heap.erase(_heap.begin(), _heap.begin() + _begin);
+            _begin = 0;
+        }
+    }
+
+    //! Remove every element (keeping any heap allocation for reuse)
+    void clear() {
+        std::fill(begin(), end(), T{});
+        _heap.clear();
+        _spilled = false;
+        _begin = 0;
+        _size = 0;
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_SMALL_VECTOR_HH
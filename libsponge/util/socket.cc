@@ -2,7 +2,12 @@
 
 #include "util.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <memory>
+#include <netinet/udp.h>
 #include <stdexcept>
 #include <unistd.h>
 
@@ -149,6 +154,220 @@ void UDPSocket::send(const BufferViewList &payload) {
     register_write();
 }
 
+//! \param[in] max_datagrams is the most datagrams to receive per call
+//! \param[in] mtu is the largest datagram expected
+UDPSocket::batch_storage::batch_storage(const size_t max_datagrams, const size_t mtu)
+    : _scratch(max_datagrams * mtu)
+    , _sources(max_datagrams)
+    , _iovecs(max_datagrams)
+    , _messages(max_datagrams)
+    , _mtu(mtu) {
+    for (size_t i = 0; i < max_datagrams; i++) {
+        _iovecs[i] = {_scratch.data() + i * mtu, mtu};
+        _messages[i].msg_hdr.msg_name = &_sources[i].storage;
+        _messages[i].msg_hdr.msg_iov = &_iovecs[i];
+        _messages[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+//! \param[out] datagrams gets the received datagrams appended to it
+//! \param[in,out] storage is where the datagrams are received before being copied out
+//! \returns the number of datagrams appended, which is 0 if none were waiting
+//! \details Uses [recvmmsg(2)](\ref man2::recvmmsg) with `MSG_DONTWAIT`, so only the datagrams
+//! already queued on the socket are returned. Each payload is copied out of its slot in
+//! `storage`, so a call allocates nothing but the payloads themselves.
+//!
+//! A datagram bigger than `storage.mtu()` arrives truncated. It is dropped and counted in
+//! `storage.truncated()`, like a datagram lost on the way, rather than failing the whole batch.
+size_t UDPSocket::recv_batch(vector<received_datagram> &datagrams, batch_storage &storage) {
+    auto &messages = storage._messages;
+    for (auto &message : messages) {
+        message.msg_hdr.msg_namelen = sizeof(Address::Raw::storage);  // the kernel overwrites it
+    }
+
+    const int n_received = SystemCall(
+        "recvmmsg",
+        ::recvmmsg(fd_num(), messages.data(), messages.size(), MSG_DONTWAIT, nullptr),
+        EAGAIN);
+    register_read();
+
+    const size_t size_before = datagrams.size();
+    for (int i = 0; i < n_received; i++) {
+        const msghdr &header = messages[i].msg_hdr;
+        if (header.msg_flags & MSG_TRUNC) {
+            storage._truncated++;
+            continue;
+        }
+        const char *const payload = storage._scratch.data() + i * storage._mtu;
+        datagrams.push_back(
+            {{storage._sources[i], header.msg_namelen}, string(payload, messages[i].msg_len)});
+    }
+
+    return datagrams.size() - size_before;
+}
+
+//! \details Each payload gets its own message, whose iovecs point straight into the
+//! BufferViewList. Sends with [sendmmsg(2)](\ref man2::sendmmsg) until every datagram is sent.
+void sendmmsg_helper(const int fd_num,
+                     const sockaddr *destination_address,
+                     const socklen_t destination_address_len,
+                     const vector<BufferViewList> &payloads) {
+    vector<BufferViewList::Iovecs> iovecs;
+    iovecs.reserve(payloads.size());
+    vector<mmsghdr> messages(payloads.size());
+    for (size_t i = 0; i < payloads.size(); i++) {
+        iovecs.push_back(payloads[i].as_iovecs());
+        msghdr &header = messages[i].msg_hdr;
+        header.msg_name = const_cast<sockaddr *>(destination_address);
+        header.msg_namelen = destination_address_len;
+        header.msg_iov = iovecs.back().data();
+        header.msg_iovlen = iovecs.back().size();
+    }
+
+    for (size_t sent = 0; sent < messages.size();) {
+        const size_t n_sent = SystemCall(
+            "sendmmsg", ::sendmmsg(fd_num, messages.data() + sent, messages.size() - sent, 0));
+        for (size_t i = sent; i < sent + n_sent; i++) {
+            if (messages[i].msg_len != payloads[i].size()) {
+                throw runtime_error("datagram payload too big for sendmmsg()");
+            }
+        }
+        sent += n_sent;
+    }
+}
+
+//! \param[in] destination is where to send every datagram
+//! \param[in] payloads are the datagrams' payloads
+void UDPSocket::send_batch(const Address &destination, const vector<BufferViewList> &payloads) {
+    sendmmsg_helper(fd_num(), destination, destination.size(), payloads);
+    register_write();
+}
+
+//! \param[in] payloads are the datagrams' payloads
+void UDPSocket::send_batch(const vector<BufferViewList> &payloads) {
+    sendmmsg_helper(fd_num(), nullptr, 0, payloads);
+    register_write();
+}
+
+//! \param[in] enabled is whether to accept coalesced datagrams
+//! \details With [UDP_GRO](\ref man7::udp), a receive may return several datagrams from one
+//! sender back to back, all but the last of the same size; recv_segments() splits them apart.
+void UDPSocket::set_gro(const bool enabled) { setsockopt(SOL_UDP, UDP_GRO, int(enabled)); }
+
+//! \param[out] segments is the sender and the received payloads
+//! \param[in] mtu is the largest receive expected, which for GRO is a whole run of datagrams
+//! \details Like recv_batch(), this does not wait: `segments.payloads` is left empty if nothing
+//! was queued on the socket. The payloads are pieces of one Buffer, so splitting a run copies
+//! nothing. They are received into `segments.storage`, which is reused by the next call if
+//! none of them is still held by then, and otherwise replaced with new (uninitialized) storage.
+//! \note If `mtu` is too small to hold the received data, this method throws a
+//! std::runtime_error
+void UDPSocket::recv_segments(received_segments &segments, const size_t mtu) {
+    segments.payloads.clear();
+    auto &storage = segments.storage;
+    if (storage.capacity < mtu or not storage.storage.unique()) {
+        storage = BufferPool::allocate_unpooled(mtu);
+    }
+
+    Address::Raw source;
+    iovec iov{storage.data, mtu};
+    alignas(cmsghdr) array<char, CMSG_SPACE(sizeof(int))> control{};
+
+    msghdr message{};
+    message.msg_name = &source.storage;
+    message.msg_namelen = sizeof(source.storage);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+
+    const ssize_t recv_len =
+        SystemCall("recvmsg", ::recvmsg(fd_num(), &message, MSG_DONTWAIT), EAGAIN);
+    register_read();
+    if (recv_len < 0) {
+        return;
+    }
+    if (message.msg_flags & MSG_TRUNC) {
+        throw runtime_error("recvmsg (oversized datagram)");
+    }
+
+    size_t segment_size = recv_len;
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO) {
+            int gso_size = 0;
+            memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+            segment_size = gso_size;
+        }
+    }
+
+    const Buffer whole{storage.storage, size_t(recv_len)};
+    segments.source_address = {source, message.msg_namelen};
+    for (size_t offset = 0; offset < size_t(recv_len); offset += segment_size) {
+        Buffer piece = whole;
+        piece.remove_prefix(offset);
+        piece.remove_suffix(piece.size() - min(segment_size, piece.size()));
+        segments.payloads.push_back(move(piece));
+    }
+}
+
+//! \param[in] destination is where to send every datagram
+//! \param[in] payloads are the datagrams' payloads
+//! \details Each run of equal-sized payloads (where the last may be shorter) goes to the kernel
+//! as one [sendmsg(2)](\ref man2::sendmsg) with [UDP_SEGMENT](\ref man7::udp) set to their size,
+//! and the kernel (or the NIC) cuts it back into datagrams.
+void UDPSocket::send_segmented(const Address &destination,
+                               const vector<BufferViewList> &payloads) {
+    constexpr size_t max_segments = 64;      // UDP_MAX_SEGMENTS in the kernel
+    constexpr size_t max_run_bytes = 65507;  // the most one IPv4 UDP datagram can carry
+
+    vector<iovec> iovecs;
+    alignas(cmsghdr) array<char, CMSG_SPACE(sizeof(uint16_t))> control{};
+    for (size_t first = 0; first < payloads.size();) {
+        const size_t segment_size = payloads[first].size();
+        size_t last = first + 1;
+        size_t run_bytes = segment_size;
+        while (last < payloads.size() and last - first < max_segments and
+               payloads[last].size() <= segment_size and
+               run_bytes + payloads[last].size() <= max_run_bytes) {
+            run_bytes += payloads[last].size();
+            last++;
+            if (payloads[last - 1].size() < segment_size) {
+                break;  // only the last datagram of a run may be short
+            }
+        }
+
+        iovecs.clear();
+        for (size_t i = first; i < last; i++) {
+            const auto payload_iovecs = payloads[i].as_iovecs();
+            iovecs.insert(iovecs.end(), payload_iovecs.begin(), payload_iovecs.end());
+        }
+
+        msghdr message{};
+        message.msg_name = const_cast<sockaddr *>(static_cast<const sockaddr *>(destination));
+        message.msg_namelen = destination.size();
+        message.msg_iov = iovecs.data();
+        message.msg_iovlen = iovecs.size();
+        if (last - first > 1) {
+            message.msg_control = control.data();
+            message.msg_controllen = control.size();
+            cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            const auto gso_size = static_cast<uint16_t>(segment_size);
+            memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+        }
+
+        const ssize_t bytes_sent = SystemCall("sendmsg", ::sendmsg(fd_num(), &message, 0));
+        if (size_t(bytes_sent) != run_bytes) {
+            throw runtime_error("datagram payloads too big for sendmsg()");
+        }
+        first = last;
+    }
+    register_write();
+}
+
 // mark the socket as listening for incoming connections
 //! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
 void TCPSocket::listen(const int backlog) { SystemCall("listen", ::listen(fd_num(), backlog)); }
@@ -2,12 +2,15 @@
 #define SPONGE_LIBSPONGE_SOCKET_HH
 
 #include "address.hh"
+#include "buffer_pool.hh"
 #include "file_descriptor.hh"
 
 #include <cstdint>
 #include <functional>
 #include <string>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -75,6 +78,72 @@ class UDPSocket : public Socket {
 
     //! Send datagram to the socket's connected address (must call connect() first)
     void send(const BufferViewList &payload);
+
+    //! \brief Where recv_batch() receives to, kept by the caller and reused from call to call
+    //! \details One slot of `mtu` bytes per datagram, and the message headers that point into
+    //! them, all allocated once by the constructor.
+    class batch_storage {
+        friend class UDPSocket;
+
+        std::vector<char> _scratch;
+        std::vector<Address::Raw> _sources;
+        std::vector<iovec> _iovecs;
+        std::vector<mmsghdr> _messages;
+        size_t _mtu;
+        size_t _truncated{0};
+
+      public:
+        //! Slot size if none is given: a datagram on a link with a 1500-byte MTU, with room left
+        static constexpr size_t DEFAULT_MTU = 2048;
+
+        //! \param[in] max_datagrams is the most datagrams to receive per call
+        //! \param[in] mtu is the largest datagram expected
+        explicit batch_storage(const size_t max_datagrams, const size_t mtu = DEFAULT_MTU);
+
+        //! \name
+        //! The message headers point into the storage, so it cannot be copied
+
+        //!@{
+        batch_storage(const batch_storage &other) = delete;
+        batch_storage &operator=(const batch_storage &other) = delete;
+        batch_storage(batch_storage &&other) = default;
+        batch_storage &operator=(batch_storage &&other) = default;
+        //!@}
+
+        //! The most datagrams received per call
+        size_t max_datagrams() const { return _messages.size(); }
+
+        //! The largest datagram expected
+        size_t mtu() const { return _mtu; }
+
+        //! Datagrams dropped so far for being bigger than mtu()
+        size_t truncated() const { return _truncated; }
+    };
+
+    //! Receive as many waiting datagrams as `storage` has room for in one syscall, without blocking
+    size_t recv_batch(std::vector<received_datagram> &datagrams, batch_storage &storage);
+
+    //! Send datagrams to the specified Address, as few syscalls as possible
+    void send_batch(const Address &destination, const std::vector<BufferViewList> &payloads);
+
+    //! Send datagrams to the socket's connected address (must call connect() first)
+    void send_batch(const std::vector<BufferViewList> &payloads);
+
+    //! Returned by UDPSocket::recv_segments; carries the datagrams of one receive
+    struct received_segments {
+        Address source_address;        //!< Address from which the datagrams were received
+        std::vector<Buffer> payloads;  //!< UDP datagram payloads, sharing one Buffer's storage
+        BufferPool::Allocation storage{{}, nullptr, 0};  //!< reused once no payload holds it
+    };
+
+    //! Let the kernel coalesce runs of datagrams from one sender ([UDP_GRO](\ref man7::udp))
+    void set_gro(const bool enabled);
+
+    //! Receive a datagram, or a run of them coalesced by GRO, split back into payloads
+    void recv_segments(received_segments &segments, const size_t mtu = 65536);
+
+    //! Send datagrams to the specified Address, with each run of equal-sized ones in one send
+    void send_segmented(const Address &destination, const std::vector<BufferViewList> &payloads);
 };
 
 //! \class UDPSocket
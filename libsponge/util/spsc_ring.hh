@@ -0,0 +1,63 @@
+#ifndef SPONGE_LIBSPONGE_SPSC_RING_HH
+#define SPONGE_LIBSPONGE_SPSC_RING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+//! \brief A bounded lock-free queue between exactly one producer thread and one consumer thread
+//! \details The producer only writes `_tail` and the consumer only writes `_head`; each
+//! publishes with a release store that the other side reads with an acquire load. The two
+//! indices live on separate cache lines so the threads don't contend on one.
+template <typename T>
+class SPSCRing {
+  private:
+    std::vector<T> _slots;
+    size_t _mask;
+    alignas(64) std::atomic<size_t> _head{0};  //!< next slot to pop (written by the consumer)
+    alignas(64) std::atomic<size_t> _tail{0};  //!< next slot to push (written by the producer)
+
+  public:
+    //! \param[in] capacity is the maximum number of queued elements (must be a power of two)
+    explicit SPSCRing(const size_t capacity) : _slots(capacity), _mask(capacity - 1) {
+        if (capacity == 0 or (capacity & _mask) != 0) {
+            throw std::invalid_argument("SPSCRing capacity must be a power of two");
+        }
+    }
+
+    //! \brief Enqueue `value` (producer only)
+    //! \returns `false`, leaving `value` untouched, if the ring is full
+    bool push(T &&value) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) == _slots.size()) {
+            return false;
+        }
+        _slots[tail & _mask] = std::move(value);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Dequeue into `value` (consumer only)
+    //! \returns `false` if the ring is empty
+    bool pop(T &value) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(_slots[head & _mask]);
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \returns `true` if nothing is queued (exact only when called by producer or consumer)
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    //! Maximum number of queued elements
+    size_t capacity() const { return _slots.size(); }
+};
+
+#endif  // SPONGE_LIBSPONGE_SPSC_RING_HH
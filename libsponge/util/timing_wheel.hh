@@ -0,0 +1,192 @@
+#ifndef SPONGE_LIBSPONGE_TIMING_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMING_WHEEL_HH
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+//! \brief A hierarchical timing wheel: O(1) schedule and cancel, with work on advance()
+//! proportional to the timers that expire
+//! \details Time is measured in milliseconds. Level 0 has one slot per millisecond for the
+//! next 64 ms; each higher level has 64 slots, each covering 64 times the span of a slot on the
+//! level below. When time reaches the start of a higher-level slot, its timers are "cascaded"
+//! down to the level matching their remaining delay, so every timer fires on exactly the
+//! millisecond it was scheduled for. Timers beyond the top level's range wait in its last slot
+//! and are re-placed each time it comes around.
+//!
+//! Timers are nodes of intrusive doubly-linked slot lists, held in one vector and recycled
+//! through a free list, so steady-state rescheduling does not allocate.
+template <typename T>
+class TimingWheel {
+  public:
+    //! Identifies a scheduled timer, for cancel()
+    using Handle = uint32_t;
+
+    //! A Handle that refers to no timer
+    static constexpr Handle NONE = UINT32_MAX;
+
+  private:
+    static constexpr unsigned LEVEL_BITS = 6;
+    static constexpr unsigned SLOTS = 1 << LEVEL_BITS;
+    static constexpr unsigned LEVELS = 4;
+
+    struct Node {
+        T value{};
+        uint64_t expiry{0};
+        Handle prev{NONE};
+        Handle next{NONE};
+        uint16_t slot{0};  //!< index into `_heads`
+        bool live{false};
+    };
+
+    std::vector<Node> _nodes{};
+    std::vector<Handle> _free{};
+    std::array<Handle, SLOTS * LEVELS> _heads{};
+    uint64_t _now;
+    size_t _size{0};
+
+    void _link(const Handle h) {
+        Node &node = _nodes[h];
+        unsigned level = 0;
+        while (level + 1 < LEVELS and
+               (node.expiry >> (LEVEL_BITS * level)) - (_now >> (LEVEL_BITS * level)) >= SLOTS) {
+            level++;
+        }
+        uint64_t index = node.expiry >> (LEVEL_BITS * level);
+        if (index - (_now >> (LEVEL_BITS * level)) >= SLOTS) {
+            // past the top level's range: park in its furthest slot
+            index = (_now >> (LEVEL_BITS * level)) + SLOTS - 1;
+        }
+        node.slot = static_cast<uint16_t>(level * SLOTS + (index & (SLOTS - 1)));
+        node.prev = NONE;
+        node.next = _heads[node.slot];
+        if (node.next != NONE) {
+            _nodes[node.next].prev = h;
+        }
+        _heads[node.slot] = h;
+    }
+
+    void _unlink(const Handle h) {
+        Node &node = _nodes[h];
+        if (node.prev != NONE) {
+            _nodes[node.prev].next = node.next;
+        } else {
+            _heads[node.slot] = node.next;
+        }
+        if (node.next != NONE) {
+            _nodes[node.next].prev = node.prev;
+        }
+    }
+
+    //! Move the timers of one higher-level slot down to where they now belong
+    void _cascade(const unsigned level) {
+        const size_t slot = level * SLOTS + ((_now >> (LEVEL_BITS * level)) & (SLOTS - 1));
+        Handle h = _heads[slot];
+        _heads[slot] = NONE;
+        while (h != NONE) {
+            const Handle next = _nodes[h].next;
+            _link(h);
+            h = next;
+        }
+    }
+
+  public:
+    //! \param[in] now is the starting time
+    explicit TimingWheel(const uint64_t now = 0) : _now(now) { _heads.fill(NONE); }
+
+    //! The time as of the last advance()
+    uint64_t now() const { return _now; }
+
+    //! Number of scheduled timers
+    size_t size() const { return _size; }
+
+    //! \brief Schedule `value` to expire at time `expiry`
+    //! \note A timer due at or before now() expires on the next advance()
+    Handle schedule(const uint64_t expiry, T value) {
+        Handle h;
+        if (_free.empty()) {
+            h = static_cast<Handle>(_nodes.size());
+            _nodes.emplace_back();
+        } else {
+            h = _free.back();
+            _free.pop_back();
+        }
+        Node &node = _nodes[h];
+        node.value = std::move(value);
+        node.expiry = std::max(expiry, _now + 1);
+        node.live = true;
+        _link(h);
+        _size++;
+        return h;
+    }
+
+    //! Cancel a scheduled timer (a no-op for NONE)
+    void cancel(const Handle h) {
+        if (h == NONE or not _nodes.at(h).live) {
+            return;
+        }
+        _unlink(h);
+        _nodes[h].live = false;
+        _free.push_back(h);
+        _size--;
+    }
+
+    //! \brief The earliest time at which advance() has work to do, or nothing if no timers
+    //! \details Exact when the next timer is within 64 ms; otherwise a lower bound, being
+    //! the time its higher-level slot is cascaded.
+    std::optional<uint64_t> next_expiry() const {
+        if (_size == 0) {
+            return {};
+        }
+        // the earliest non-empty slot of each level; a higher level's slot can come due
+        // before a lower level's, since its span starts at a boundary
+        std::optional<uint64_t> earliest{};
+        for (unsigned level = 0; level < LEVELS; level++) {
+            const uint64_t base = _now >> (LEVEL_BITS * level);
+            for (uint64_t offset = 1; offset <= SLOTS; offset++) {
+                if (_heads[level * SLOTS + ((base + offset) & (SLOTS - 1))] != NONE) {
+                    const uint64_t due = (base + offset) << (LEVEL_BITS * level);
+                    earliest = earliest.has_value() ? std::min(*earliest, due) : due;
+                    break;
+                }
+            }
+        }
+        return earliest;
+    }
+
+    //! \brief Move time forward to `now`, calling `on_expire(value)` for each timer due by then
+    //! \details Timers fire in order of expiry. `on_expire` may schedule and cancel timers.
+    //! Stretches of time with nothing to do are skipped rather than stepped through.
+    template <typename F>
+    void advance(const uint64_t now, F &&on_expire) {
+        while (_now < now) {
+            const auto next = next_expiry();
+            if (not next.has_value() or *next > now) {
+                _now = now;
+                return;
+            }
+            _now = *next;
+
+            for (unsigned level = LEVELS - 1; level > 0; level--) {
+                if ((_now & ((uint64_t{1} << (LEVEL_BITS * level)) - 1)) == 0) {
+                    _cascade(level);
+                }
+            }
+            Handle &head = _heads[_now & (SLOTS - 1)];
+            while (head != NONE) {
+                const Handle h = head;
+                _unlink(h);
+                _nodes[h].live = false;
+                _free.push_back(h);
+                _size--;
+                T value = std::move(_nodes[h].value);
+                on_expire(std::as_const(value));
+            }
+        }
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_TIMING_WHEEL_HH
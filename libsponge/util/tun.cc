@@ -14,18 +14,38 @@ using namespace std;
 
 //! \param[in] devname is the name of the TUN or TAP device, specified at its creation.
 //! \param[in] is_tun is `true` for a TUN device (expects IP datagrams), or `false` for a TAP device (expects Ethernet frames)
+//! \param[in] multi_queue is `true` to open one more queue of a multi-queue device
+//! \param[in] vnet_hdr is `true` to exchange packets with checksum and segmentation offload,
+//! each preceded by a `struct virtio_net_hdr`
 //!
 //! To create a TUN device, you should already have run
 //!
 //!     ip tuntap add mode tun user `username` name `devname`
 //!
-//! as root before calling this function.
-
-TunTapFD::TunTapFD(const string &devname, const bool is_tun)
+//! as root before calling this function (adding `multi_queue` for a multi-queue device).
+//!
+//! Each TunTapFD opened with `multi_queue` set is a separate queue of the device. The kernel
+//! sends each flow's packets to one queue, picked by hashing the flow until the flow is written
+//! through some queue, and from then on to the queue that last wrote it.
+//!
+//! With `vnet_hdr`, the kernel may hand over TCP packets whose checksum is not filled in
+//! (`VIRTIO_NET_HDR_F_NEEDS_CSUM`) and TCP segments of up to 64 KB that were never cut to the
+//! MTU (`VIRTIO_NET_HDR_GSO_TCPV4`), and it accepts the same from the reader.
+
+TunTapFD::TunTapFD(const string &devname,
+                   const bool is_tun,
+                   const bool multi_queue,
+                   const bool vnet_hdr)
     : FileDescriptor(SystemCall("open", open(CLONEDEV, O_RDWR))) {
     struct ifreq tun_req {};
 
     tun_req.ifr_flags = (is_tun ? IFF_TUN : IFF_TAP) | IFF_NO_PI;  // tun device with no packetinfo
+    if (multi_queue) {
+        tun_req.ifr_flags |= IFF_MULTI_QUEUE;
+    }
+    if (vnet_hdr) {
+        tun_req.ifr_flags |= IFF_VNET_HDR;
+    }
 
     // copy devname to ifr_name, making sure to null terminate
 
@@ -33,4 +53,9 @@ TunTapFD::TunTapFD(const string &devname, const bool is_tun)
     tun_req.ifr_name[IFNAMSIZ - 1] = '\0';
 
     SystemCall("ioctl", ioctl(fd_num(), TUNSETIFF, static_cast<void *>(&tun_req)));
+
+    // the device keeps its offloads after the reader that asked for them is gone, so a reader
+    // without `vnet_hdr` (which could not tell an unfinished packet from a whole one) resets them
+    const unsigned long offloads = vnet_hdr ? TUN_F_CSUM | TUN_F_TSO4 : 0;
+    SystemCall("ioctl", ioctl(fd_num(), TUNSETOFFLOAD, offloads));
 }
@@ -1,13 +1,20 @@
 #include "util.hh"
 
 #include <array>
+#include <atomic>
 #include <cctype>
 #include <chrono>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <sys/socket.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 //! \returns the number of milliseconds since the program started
@@ -86,25 +93,227 @@ mt19937 get_random_generator() {
 //! on the Internet checksum, and consult the [IP](\ref rfc::rfc791) and [TCP](\ref rfc::rfc793) RFCs.
 InternetChecksum::InternetChecksum(const uint32_t initial_sum) : _sum(initial_sum) {}
 
-void InternetChecksum::add(std::string_view data) {
-    for (size_t i = 0; i < data.size(); i++) {
-        uint16_t val = uint8_t(data[i]);
-        if (not _parity) {
-            val <<= 8;
+//! \name Checksum kernels
+//! Each returns the ones-complement sum of `len` bytes (an even number), taken as big-endian
+//! 16-bit words, folded to 16 bits. Since the sum does not depend on byte order
+//! (RFC 1071), the faster ones sum native words and swap the result. With `copy`, each also
+//! copies the data to `destination` as it goes, so the data is read only once.
+//!@{
+
+//! Add two ones-complement partial sums, with end-around carry
+static uint64_t add_with_carry(const uint64_t a, const uint64_t b) {
+    const uint64_t sum = a + b;
+    return sum + (sum < a);
+}
+
+//! Fold a sum of 16-bit words to 16 bits, with end-around carry
+static uint16_t fold(uint64_t sum) {
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return sum;
+}
+
+//! Fold a sum of native-order 16-bit words, and convert it to the sum of big-endian ones
+static uint16_t fold_native(const uint64_t sum) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap16(fold(sum));
+#else
+    return fold(sum);
+#endif
+}
+
+//! Add native-order 64-bit words (then 16-bit ones) to `sum`
+template <bool copy>
+static uint64_t add_words(uint64_t sum, const char *data, size_t len, char *destination) {
+    for (; len >= 8; data += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        sum = add_with_carry(sum, word);
+        if constexpr (copy) {
+            memcpy(destination, &word, sizeof(word));
+            destination += sizeof(word);
+        }
+    }
+    for (; len >= 2; data += 2, len -= 2) {
+        uint16_t word;
+        memcpy(&word, data, sizeof(word));
+        sum = add_with_carry(sum, word);
+        if constexpr (copy) {
+            memcpy(destination, &word, sizeof(word));
+            destination += sizeof(word);
+        }
+    }
+    return sum;
+}
+
+template <bool copy>
+static uint16_t sum_bytewise(const char *data, const size_t len, char *destination) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        const uint8_t byte = data[i];
+        sum += (i % 2 == 0) ? byte << 8 : byte;
+        if constexpr (copy) {
+            destination[i] = data[i];
         }
-        _sum += val;
-        _parity = !_parity;
     }
+    return fold(sum);
 }
 
-uint16_t InternetChecksum::value() const {
-    uint32_t ret = _sum;
+template <bool copy>
+static uint16_t sum_words(const char *data, const size_t len, char *destination) {
+    return fold_native(add_words<copy>(0, data, len, destination));
+}
 
-    while (ret > 0xffff) {
-        ret = (ret >> 16) + (ret & 0xffff);
+#if defined(__x86_64__)
+//! \details Each 32 bits of data is added to a 64-bit lane, which cannot overflow before 64 GiB.
+template <bool copy>
+__attribute__((target("sse4.1"))) static uint16_t sum_sse4(const char *data,
+                                                            size_t len,
+                                                            char *destination) {
+    __m128i sums = _mm_setzero_si128();
+    for (; len >= 16; data += 16, len -= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        sums = _mm_add_epi64(sums, _mm_cvtepu32_epi64(block));
+        sums = _mm_add_epi64(sums, _mm_cvtepu32_epi64(_mm_unpackhi_epi64(block, block)));
+        if constexpr (copy) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(destination), block);
+            destination += 16;
+        }
     }
+    const uint64_t sum = add_with_carry(_mm_extract_epi64(sums, 0), _mm_extract_epi64(sums, 1));
+    return fold_native(add_words<copy>(sum, data, len, destination));
+}
 
-    return ~ret;
+//! \details Each 32 bits of data is added to a 64-bit lane, which cannot overflow before 64 GiB.
+template <bool copy>
+__attribute__((target("avx2"))) static uint16_t sum_avx2(const char *data,
+                                                         size_t len,
+                                                         char *destination) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sums = zero;
+    for (; len >= 32; data += 32, len -= 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+        sums = _mm256_add_epi64(sums, _mm256_unpacklo_epi32(block, zero));
+        sums = _mm256_add_epi64(sums, _mm256_unpackhi_epi32(block, zero));
+        if constexpr (copy) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(destination), block);
+            destination += 32;
+        }
+    }
+    const uint64_t low =
+        add_with_carry(_mm256_extract_epi64(sums, 0), _mm256_extract_epi64(sums, 1));
+    const uint64_t high =
+        add_with_carry(_mm256_extract_epi64(sums, 2), _mm256_extract_epi64(sums, 3));
+    const uint64_t sum = add_with_carry(low, high);
+    return fold_native(add_words<copy>(sum, data, len, destination));
+}
+#endif
+//!@}
+
+using SumFunction = uint16_t (*)(const char *data, const size_t len, char *destination);
+
+template <bool copy>
+static SumFunction sum_function(const InternetChecksum::Kernel kernel) {
+    switch (kernel) {
+        case InternetChecksum::Kernel::Bytewise:
+            return sum_bytewise<copy>;
+#if defined(__x86_64__)
+        case InternetChecksum::Kernel::SSE4:
+            return sum_sse4<copy>;
+        case InternetChecksum::Kernel::AVX2:
+            return sum_avx2<copy>;
+#endif
+        default:
+            return sum_words<copy>;
+    }
+}
+
+//! The kernel every InternetChecksum uses: at first, the fastest one this CPU supports
+static atomic<InternetChecksum::Kernel> &active_kernel() {
+    using Kernel = InternetChecksum::Kernel;
+    static atomic<Kernel> active{InternetChecksum::supported(Kernel::AVX2)   ? Kernel::AVX2
+                                 : InternetChecksum::supported(Kernel::SSE4) ? Kernel::SSE4
+                                                                             : Kernel::Word};
+    return active;
+}
+
+//! \brief Add `data` to `sum`, continuing from `parity` (and copying it, with `copy`)
+//! \details Data may be added in pieces of any size. A piece that follows one of odd length
+//! starts by finishing that piece's last 16-bit word; the rest is summed a word (or more) at a
+//! time, whatever the parity.
+template <bool copy>
+static void accumulate(uint64_t &sum, bool &parity, string_view data, char *destination) {
+    if (parity and not data.empty()) {
+        sum += uint8_t(data.front());
+        if constexpr (copy) {
+            *destination++ = data.front();
+        }
+        data.remove_prefix(1);
+        parity = false;
+    }
+
+    const size_t even_size = data.size() & ~size_t{1};
+    sum += sum_function<copy>(InternetChecksum::kernel())(data.data(), even_size, destination);
+
+    if (even_size < data.size()) {
+        sum += uint8_t(data.back()) << 8;
+        if constexpr (copy) {
+            destination[even_size] = data.back();
+        }
+        parity = true;
+    }
+}
+
+void InternetChecksum::add(std::string_view data) {
+    accumulate<false>(_sum, _parity, data, nullptr);
+}
+
+//! \param[out] destination is where to copy `data` to, which must have room for all of it
+//! \param[in] data is the data to add
+void InternetChecksum::copy_and_add(char *destination, std::string_view data) {
+    accumulate<true>(_sum, _parity, data, destination);
+}
+
+uint16_t InternetChecksum::value() const { return ~fold(_sum); }
+
+//! \details This is equation 3 of RFC 1624, `HC' = ~(~HC + ~m + m')`, which (unlike the older
+//! equation of RFC 1141) never yields 0xffff in place of zero.
+uint16_t InternetChecksum::update(const uint16_t checksum,
+                                  const uint16_t old_word,
+                                  const uint16_t new_word) {
+    const uint16_t not_checksum = ~checksum;
+    const uint16_t not_old_word = ~old_word;
+    return InternetChecksum(not_checksum + not_old_word + new_word).value();
+}
+
+bool InternetChecksum::supported(const Kernel kernel) {
+    switch (kernel) {
+        case Kernel::Bytewise:
+        case Kernel::Word:
+            return true;
+#if defined(__x86_64__)
+        case Kernel::SSE4:
+            return __builtin_cpu_supports("sse4.1") != 0;
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2") != 0;
+#endif
+        default:
+            return false;
+    }
+}
+
+InternetChecksum::Kernel InternetChecksum::kernel() {
+    return active_kernel().load(memory_order_relaxed);
+}
+
+//! \details Meant for tests and benchmarks: later checksums use the new kernel, but the choice
+//! is not synchronized with checksums computed concurrently.
+void InternetChecksum::use_kernel(const Kernel kernel) {
+    if (not supported(kernel)) {
+        throw runtime_error("InternetChecksum: kernel not supported by this CPU");
+    }
+    active_kernel().store(kernel, memory_order_relaxed);
 }
 
 //! \param[in] data is a pointer to the bytes to show
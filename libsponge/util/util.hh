@@ -56,14 +56,39 @@ uint64_t timestamp_ms();
 
 //! The internet checksum algorithm
 class InternetChecksum {
+  public:
+    //! Ways add() can sum the bulk of its data, slowest first
+    enum class Kernel {
+        Bytewise,  //!< one byte at a time
+        Word,      //!< 64-bit words, with end-around carry
+        SSE4,      //!< 16 bytes at a time, with SSE4.1
+        AVX2       //!< 32 bytes at a time, with AVX2
+    };
+
   private:
-    uint32_t _sum;
+    uint64_t _sum;
     bool _parity{};
 
   public:
     InternetChecksum(const uint32_t initial_sum = 0);
     void add(std::string_view data);
     uint16_t value() const;
+
+    //! Copy `data` to `destination` while adding it, reading it just once
+    void copy_and_add(char *destination, std::string_view data);
+
+    //! \brief Patch a checksum (as value() returned it) for one 16-bit word of the data changing
+    //! from `old_word` to `new_word`, without summing the data again
+    static uint16_t update(const uint16_t checksum, const uint16_t old_word, const uint16_t new_word);
+
+    //! Whether this CPU can run `kernel`
+    static bool supported(const Kernel kernel);
+
+    //! The kernel add() uses: the fastest supported one, unless use_kernel() said otherwise
+    static Kernel kernel();
+
+    //! Make add() use `kernel` from now on (e.g., to test or benchmark the slower ones)
+    static void use_kernel(const Kernel kernel);
 };
 
 //! Hexdump the contents of a packet (or any other sequence of bytes)
@@ -0,0 +1,94 @@
+#include "buffer.hh"
+#include "buffer_pool.hh"
+#include "file_descriptor.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace std;
+
+Buffer pooled_string(BufferPool &pool, const string &str) {
+    auto allocation = pool.allocate(str.size());
+    memcpy(allocation.data, str.data(), str.size());
+    return {move(allocation.storage), str.size()};
+}
+
+int main() {
+    try {
+        // blocks are sized by bucket, and anything bigger comes from the heap
+        {
+            BufferPool pool;
+            test_should_be(pool.allocate(1).capacity, BufferPool::MTU_BYTES);
+            test_should_be(pool.allocate(BufferPool::MTU_BYTES).capacity, BufferPool::MTU_BYTES);
+            test_should_be(pool.allocate(1500 * 4).capacity, BufferPool::JUMBO_BYTES);
+            test_should_be(pool.allocate(BufferPool::JUMBO_BYTES + 1).capacity,
+                           BufferPool::JUMBO_BYTES + 1);
+            test_should_be(pool.arena().in_use(), size_t{0});
+        }
+
+        // copies and pieces of a pooled Buffer share its block, which goes back with the last
+        {
+            BufferPool pool;
+            optional<Buffer> whole = pooled_string(pool, "abcdefghij");
+            Buffer middle = *whole;
+            middle.remove_prefix(3);
+            middle.remove_suffix(4);
+            test_should_be(pool.arena().in_use(), size_t{1});
+            whole.reset();
+            test_err_if(middle.str() != "def", "piece of pooled Buffer wrong");
+            test_should_be(pool.arena().in_use(), size_t{1});
+            middle.remove_prefix(3);
+            test_should_be(pool.arena().in_use(), size_t{0});
+        }
+
+        // in a steady state, blocks are recycled rather than allocated
+        {
+            BufferPool pool;
+            vector<Buffer> in_flight;
+            for (size_t i = 0; i < 100000; i++) {
+                in_flight.push_back(pooled_string(pool, string(1 + i % 1400, char(i))));
+                if (in_flight.size() > 20) {
+                    in_flight.erase(in_flight.begin());
+                }
+            }
+            test_should_be(pool.arena().chunks(), size_t{1});
+            test_should_be(pool.arena().in_use(), size_t{20});
+            test_should_be(in_flight.back().size(), size_t{1 + 99999 % 1400});
+        }
+
+        // the blocks outlive the pool while Buffers still use them
+        {
+            optional<BufferPool> pool{in_place};
+            const Buffer survivor = pooled_string(*pool, "survivor");
+            pool.reset();
+            test_err_if(survivor.str() != "survivor", "Buffer did not outlive its pool");
+        }
+
+        // reads go straight into pooled storage
+        {
+            int fds[2];
+            SystemCall("socketpair", ::socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+            FileDescriptor a{fds[0]}, b{fds[1]};
+            BufferPool pool;
+            a.write(string("datagram"));
+            const Buffer received = b.read(pool, BufferPool::MTU_BYTES);
+            test_err_if(received.str() != "datagram", "pooled read wrong");
+            test_should_be(pool.arena().in_use(), size_t{1});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+#include "byte_stream.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+using Kernel = InternetChecksum::Kernel;
+
+//! The checksum as the Internet checksum is defined: a ones-complement sum of big-endian words
+uint16_t reference_checksum(const uint32_t initial_sum, const string &data) {
+    uint64_t sum = initial_sum;
+    for (size_t i = 0; i < data.size(); i++) {
+        sum += (i % 2 == 0) ? uint8_t(data[i]) << 8 : uint8_t(data[i]);
+    }
+    while (sum > 0xffff) {
+        sum = (sum >> 16) + (sum & 0xffff);
+    }
+    return ~sum;
+}
+
+//! Checksum `data` added in random pieces, some of them empty, many of odd length
+uint16_t piecewise_checksum(const uint32_t initial_sum, const string &data, mt19937 &rd) {
+    InternetChecksum check(initial_sum);
+    const string_view view = data;
+    size_t offset = 0;
+    while (offset < data.size()) {
+        const size_t len = uniform_int_distribution<size_t>{0, 80}(rd);
+        check.add(view.substr(offset, len));
+        offset += len;
+    }
+    return check.value();
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // the default is the fastest kernel this CPU supports
+        test_should_be(InternetChecksum::supported(Kernel::Bytewise), true);
+        test_should_be(InternetChecksum::supported(Kernel::Word), true);
+        test_should_be(InternetChecksum::supported(InternetChecksum::kernel()), true);
+        test_should_be(InternetChecksum::kernel() == Kernel::Bytewise, false);
+
+        for (const auto kernel : {Kernel::Bytewise, Kernel::Word, Kernel::SSE4, Kernel::AVX2}) {
+            if (not InternetChecksum::supported(kernel)) {
+                continue;
+            }
+            InternetChecksum::use_kernel(kernel);
+            test_should_be(InternetChecksum::kernel() == kernel, true);
+
+            for (size_t size = 0; size < 300; size++) {
+                string data(size, 0);
+                for (auto &c : data) {
+                    c = char(rd());
+                }
+                const uint32_t initial_sum = rd() % 0x30000;
+                const uint16_t expected = reference_checksum(initial_sum, data);
+
+                InternetChecksum whole(initial_sum);
+                whole.add(data);
+                test_should_be(whole.value(), expected);
+                test_should_be(piecewise_checksum(initial_sum, data, rd), expected);
+
+                // copying while summing, in pieces
+                string copy(size, 0);
+                InternetChecksum copied(initial_sum);
+                for (size_t offset = 0; offset < size;) {
+                    const size_t len = min(size - offset, size_t{rd() % 40});
+                    const string_view piece = string_view(data).substr(offset, len);
+                    copied.copy_and_add(copy.data() + offset, piece);
+                    offset += len;
+                }
+                test_should_be(copied.value(), expected);
+                test_err_if(copy != data, "copy_and_add copied wrong");
+
+                // unaligned data
+                if (size > 0) {
+                    const string tail = data.substr(1);
+                    InternetChecksum shifted(initial_sum);
+                    shifted.add(string_view(data).substr(1));
+                    test_should_be(shifted.value(), reference_checksum(initial_sum, tail));
+                }
+            }
+
+            // words that sum to a multiple of 0xffff, and all-ones words
+            const string ones(64, char(0xff));
+            for (const auto &data : {string(64, char(0)), ones, string("\xff\x00\x00\xff", 4)}) {
+                InternetChecksum check;
+                check.add(data);
+                test_should_be(check.value(), reference_checksum(0, data));
+            }
+        }
+
+        // patching a checksum for a changed word gives the checksum of the changed data
+        for (size_t i = 0; i < 10000; i++) {
+            string data(20, 0);
+            for (auto &c : data) {
+                c = char(rd());
+            }
+            if (i % 4 == 0) {
+                data.replace(0, 4, string(4, 0));  // sums around zero
+            }
+            const uint16_t old_checksum = reference_checksum(0, data);
+
+            const size_t word = 2 * (rd() % 10);
+            const uint16_t old_word = uint8_t(data[word]) << 8 | uint8_t(data[word + 1]);
+            const uint16_t new_word = i % 3 == 0 ? 0 : rd();
+            data[word] = char(new_word >> 8);
+            data[word + 1] = char(new_word);
+
+            const uint16_t patched = InternetChecksum::update(old_checksum, old_word, new_word);
+            test_should_be(patched, reference_checksum(0, data));
+        }
+
+        // a forwarded datagram keeps a good header checksum
+        {
+            IPv4Datagram dgram;
+            dgram.header().src = 0x0a000001;
+            dgram.header().dst = 0xc0a80102;
+            dgram.header().ttl = 64;
+            dgram.header().len = IPv4Header::LENGTH;
+            IPv4Datagram parsed;
+            test_err_if(parsed.parse(dgram.serialize().concatenate()) != ParseResult::NoError,
+                        "datagram did not parse");
+            for (uint8_t ttl = 63; ttl > 0; ttl--) {
+                parsed.decrement_ttl();
+                IPv4Datagram reparsed;
+                const ParseResult result = reparsed.parse(parsed.serialize().concatenate());
+                test_err_if(result != ParseResult::NoError, "forwarded datagram did not parse");
+                test_should_be(reparsed.header().ttl, ttl);
+                parsed = reparsed;
+            }
+        }
+
+        // reading from a ByteStream sums what is read, even where the stream wraps around
+        {
+            ByteStream stream{100};
+            string written;
+            for (size_t round = 0; round < 50; round++) {
+                const string data(rd() % 60 + 1, char(rd()));
+                written += data.substr(0, stream.write(data));
+                const size_t len = min(stream.buffer_size(), size_t{rd() % 60});
+                string read(len, 0);
+                InternetChecksum check;
+                stream.read(read.data(), len, check);
+                test_err_if(read != written.substr(0, len), "ByteStream read wrong bytes");
+                test_should_be(check.value(), reference_checksum(0, read));
+                written.erase(0, len);
+            }
+        }
+
+        // a segment whose payload sum is known serializes the same as one whose is not
+        {
+            TCPSegment known;
+            known.set_payload(string("odd-length payload"));
+            TCPSegment unknown = known;
+            unknown.mutable_payload() = string("odd-length payload");
+            for (uint16_t win = 0; win < 1000; win += 7) {
+                known.header().win = unknown.header().win = win;
+                known.header().ackno = unknown.header().ackno = WrappingInt32{uint32_t(rd())};
+                test_err_if(known.serialize(0x1234).concatenate() !=
+                                unknown.serialize(0x1234).concatenate(),
+                            "serialization with a known payload sum differs");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
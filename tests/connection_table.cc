@@ -0,0 +1,65 @@
+#include "connection_table.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // compare against std::unordered_map under random inserts and erases,
+        // drawing from a small key space so probe chains collide and wrap
+        ConnectionTable<uint64_t> table{4};
+        unordered_map<uint64_t, uint64_t> reference;
+        vector<FourTuple> keys;
+        for (uint16_t i = 0; i < 512; i++) {
+            keys.push_back({0x0a000001, uint32_t(0x0a000002 + i % 7), i, uint16_t(80 + i % 3)});
+        }
+        auto ref_key = [](const FourTuple &key) {
+            return (uint64_t(key.local_port) << 32) | key.remote_ip;
+        };
+
+        for (size_t n = 0; n < 100000; n++) {
+            const auto &key = keys[rd() % keys.size()];
+            switch (rd() % 3) {
+                case 0: {
+                    const uint64_t value = rd();
+                    const bool inserted = table.emplace(key, value).second;
+                    test_should_be(inserted, reference.emplace(ref_key(key), value).second);
+                } break;
+                case 1:
+                    test_should_be(table.erase(key), reference.erase(ref_key(key)) == 1);
+                    break;
+                default: {
+                    const auto *value = table.find(key);
+                    const auto it = reference.find(ref_key(key));
+                    test_should_be(value != nullptr, it != reference.end());
+                    if (value) {
+                        test_should_be(*value, it->second);
+                    }
+                } break;
+            }
+            test_should_be(table.size(), reference.size());
+        }
+
+        size_t visited = 0;
+        table.for_each([&](const FourTuple &key, uint64_t &value) {
+            test_should_be(value, reference.at(ref_key(key)));
+            ++visited;
+        });
+        test_should_be(visited, reference.size());
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
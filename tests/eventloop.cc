@@ -0,0 +1,151 @@
+#include "eventloop.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+pair<FileDescriptor, FileDescriptor> make_pipe() {
+    int fds[2];
+    SystemCall("pipe", ::pipe(fds));
+    return {FileDescriptor(fds[0]), FileDescriptor(fds[1])};
+}
+
+void check_backend(const EventLoop::Backend backend) {
+    // a readable fd runs its callback; an idle one times out
+    {
+        EventLoop loop{backend};
+        auto [reader, writer] = make_pipe();
+        string received;
+        loop.add_rule(reader, Direction::In, [&] { received += reader.read(); });
+
+        test_should_be(static_cast<int>(loop.wait_next_event(0)),
+                       static_cast<int>(EventLoop::Result::Timeout));
+        writer.write("hello");
+        test_should_be(static_cast<int>(loop.wait_next_event(0)),
+                       static_cast<int>(EventLoop::Result::Success));
+        test_err_if(received != "hello", "callback did not read the data");
+    }
+
+    // interest can be switched off and on between waits; with nothing interested, Exit
+    {
+        EventLoop loop{backend};
+        auto [reader, writer] = make_pipe();
+        bool interested = false;
+        size_t calls = 0;
+        loop.add_rule(
+            reader,
+            Direction::In,
+            [&] {
+                reader.read();
+                calls++;
+            },
+            [&] { return interested; });
+
+        writer.write("x");
+        test_should_be(static_cast<int>(loop.wait_next_event(0)),
+                       static_cast<int>(EventLoop::Result::Exit));
+        interested = true;
+        loop.wait_next_event(0);
+        test_should_be(calls, size_t{1});
+    }
+
+    // rules in both directions, and EOF cancels the reader
+    {
+        EventLoop loop{backend};
+        auto [reader, writer] = make_pipe();
+        size_t writes = 0;
+        bool reader_canceled = false;
+        loop.add_rule(
+            writer,
+            Direction::Out,
+            [&] {
+                writer.write("y");
+                if (++writes == 3) {
+                    writer.close();
+                }
+            },
+            [&] { return writes < 3; });
+        loop.add_rule(
+            reader, Direction::In, [&] { reader.read(); }, {}, [&] { reader_canceled = true; });
+
+        for (size_t i = 0; i < 10 and not reader_canceled; i++) {
+            loop.wait_next_event(0);
+        }
+        test_should_be(writes, size_t{3});
+        test_should_be(reader_canceled, true);
+        test_should_be(static_cast<int>(loop.wait_next_event(0)),
+                       static_cast<int>(EventLoop::Result::Exit));
+    }
+
+    // a callback that neither reads nor loses interest is a busy wait
+    {
+        EventLoop loop{backend};
+        auto [reader, writer] = make_pipe();
+        loop.add_rule(reader, Direction::In, [] {});
+        writer.write("z");
+        bool threw = false;
+        try {
+            loop.wait_next_event(0);
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        test_should_be(threw, true);
+    }
+
+    // a closed fd's number, reused before the next wait, is watched for the new file
+    {
+        EventLoop loop{backend};
+        auto [old_reader, old_writer] = make_pipe();
+        loop.add_rule(old_reader, Direction::In, [&] { old_reader.read(); });
+        test_should_be(static_cast<int>(loop.wait_next_event(0)),
+                       static_cast<int>(EventLoop::Result::Timeout));
+        const int fd_num = old_reader.fd_num();
+        old_reader.close();
+
+        auto [reader, writer] = make_pipe();
+        test_should_be(reader.fd_num(), fd_num);
+        string received;
+        loop.add_rule(reader, Direction::In, [&] { received += reader.read(); });
+        writer.write("reused");
+        for (size_t i = 0; i < 10 and received.empty(); i++) {
+            loop.wait_next_event(100);
+        }
+        test_err_if(received != "reused", "reused fd number was not watched");
+    }
+
+    // regular files are always ready, even though epoll can't watch them
+    {
+        EventLoop loop{backend};
+        char name[] = "/tmp/eventloop_test_XXXXXX";
+        FileDescriptor file{SystemCall("mkstemp", ::mkstemp(name))};
+        SystemCall("unlink", ::unlink(name));
+        file.write("contents");
+        SystemCall("lseek", static_cast<int>(::lseek(file.fd_num(), 0, SEEK_SET)));
+
+        string received;
+        loop.add_rule(file, Direction::In, [&] { received += file.read(); });
+        while (loop.wait_next_event(-1) != EventLoop::Result::Exit) {
+        }
+        test_err_if(received != "contents", "regular file was not read to EOF");
+    }
+}
+
+int main() {
+    try {
+        check_backend(EventLoop::Backend::Poll);
+        check_backend(EventLoop::Backend::Epoll);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "tcp_header.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+//! Check that every proper prefix of `header` is reported as PacketTooShort by `parse`
+template <typename ParseFn>
+void check_truncations(const string &name, const string &header, const ParseFn &parse) {
+    for (size_t length = 0; length < header.size(); length++) {
+        test_err_if(parse(Buffer{header.substr(0, length)}) != ParseResult::PacketTooShort,
+                    name + " header cut to " + to_string(length) + " bytes was not too short");
+    }
+    test_err_if(parse(Buffer{string(header)}) != ParseResult::NoError,
+                name + " header did not parse");
+}
+
+int main() {
+    try {
+        TCPHeader tcp{};
+        tcp.sport = 1234;
+        tcp.dport = 80;
+        tcp.seqno = WrappingInt32{0x01020304};
+        tcp.ackno = WrappingInt32{0x05060708};
+        tcp.ack = true;
+        tcp.win = 1000;
+        const string tcp_bytes = tcp.serialize();
+
+        IPv4Header ip{};
+        ip.len = IPv4Header::LENGTH;
+        ip.src = 0x0a000001;
+        ip.dst = 0x0a000002;
+        ip.cksum = 0;
+        {
+            InternetChecksum check;
+            check.add(ip.serialize());
+            ip.cksum = check.value();
+        }
+        const string ip_bytes = ip.serialize();
+
+        EthernetHeader ethernet{};
+        ethernet.dst = ETHERNET_BROADCAST;
+        ethernet.src = {2, 0, 0, 0, 0, 1};
+        ethernet.type = EthernetHeader::TYPE_ARP;
+        const string ethernet_bytes = ethernet.serialize();
+
+        ARPMessage arp{};
+        arp.opcode = ARPMessage::OPCODE_REQUEST;
+        arp.sender_ethernet_address = ethernet.src;
+        arp.sender_ip_address = ip.src;
+        arp.target_ip_address = ip.dst;
+        const string arp_bytes = arp.serialize();
+
+        // every length short of the fixed header is too short, before any field is read
+        check_truncations("TCP", tcp_bytes, [](const Buffer &buffer) {
+            NetParser p{buffer};
+            TCPHeader header{};
+            return header.parse(p);
+        });
+        check_truncations("IPv4", ip_bytes, [](const Buffer &buffer) {
+            NetParser p{buffer};
+            IPv4Header header{};
+            return header.parse(p);
+        });
+        check_truncations("Ethernet", ethernet_bytes, [](const Buffer &buffer) {
+            EthernetFrame frame{};
+            return frame.parse(buffer);
+        });
+        check_truncations("ARP", arp_bytes, [](const Buffer &buffer) {
+            ARPMessage message{};
+            return message.parse(buffer);
+        });
+
+        // a header that takes the whole Buffer leaves the parser its only owner; the bytes must
+        // outlive the header's view of them
+        {
+            NetParser p{Buffer{string(tcp_bytes)}};
+            TCPHeader header{};
+            test_err_if(header.parse(p) != ParseResult::NoError, "whole-buffer TCP header");
+            test_should_be(p.buffer().size(), size_t{0});
+            test_should_be(header.sport, tcp.sport);
+            test_should_be(header.dport, tcp.dport);
+            test_should_be(header.seqno, tcp.seqno);
+            test_should_be(header.ackno, tcp.ackno);
+            test_should_be(header.win, tcp.win);
+        }
+        {
+            NetParser p{Buffer{string(ip_bytes)}};
+            IPv4Header header{};
+            test_err_if(header.parse(p) != ParseResult::NoError, "whole-buffer IPv4 header");
+            test_should_be(header.src, ip.src);
+            test_should_be(header.dst, ip.dst);
+        }
+        {
+            NetParser p{Buffer{string(ethernet_bytes)}};
+            const HeaderView h = p.header(EthernetHeader::LENGTH);
+            const string filler(EthernetHeader::LENGTH, '\xff');  // tempt the allocator
+            test_err_if(h.str() != ethernet_bytes, "whole-buffer header view changed");
+            test_should_be(h.u16(12), EthernetHeader::TYPE_ARP);
+        }
+        {
+            NetParser p{Buffer{string("\x01\x02\x03\x04", 4)}};
+            test_should_be(p.u32(), uint32_t{0x01020304});
+            test_should_be(p.error(), false);
+            p.u8();
+            test_err_if(p.get_error() != ParseResult::PacketTooShort, "read past the end");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#include "sharded_tcp_engine.hh"
+#include "socket.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <linux/if.h>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static constexpr const char *DEVNAME = "sponge-mq-test";
+static constexpr size_t N_QUEUES = 2;
+static constexpr size_t N_CONNECTIONS = 32;
+
+//! Give the device `address`/24 and bring it up
+void configure(const string &devname, const string &address) {
+    UDPSocket sock;
+    struct ifreq req {};
+    strncpy(static_cast<char *>(req.ifr_name), devname.data(), IFNAMSIZ - 1);
+
+    auto *const addr = reinterpret_cast<sockaddr_in *>(&req.ifr_addr);
+    addr->sin_family = AF_INET;
+    SystemCall("inet_pton", ::inet_pton(AF_INET, address.c_str(), &addr->sin_addr));
+    SystemCall("ioctl", ::ioctl(sock.fd_num(), SIOCSIFADDR, &req));
+    SystemCall("inet_pton", ::inet_pton(AF_INET, "255.255.255.0", &addr->sin_addr));
+    SystemCall("ioctl", ::ioctl(sock.fd_num(), SIOCSIFNETMASK, &req));
+
+    SystemCall("ioctl", ::ioctl(sock.fd_num(), SIOCGIFFLAGS, &req));
+    req.ifr_flags |= IFF_UP;
+    SystemCall("ioctl", ::ioctl(sock.fd_num(), SIOCSIFFLAGS, &req));
+}
+
+int main() {
+    try {
+        // each shard accepts its own connections and counts the bytes it reads from them
+        vector<vector<FourTuple>> accepted(N_QUEUES);
+        atomic<size_t> bytes_read{0};
+        const auto serve = [&](const size_t shard, TCPEngine &engine) {
+            while (const auto id = engine.accept(80)) {
+                accepted[shard].push_back(*id);
+            }
+            for (const auto &id : accepted[shard]) {
+                if (engine.contains(id)) {
+                    auto &stream = engine.connection(id).inbound_stream();
+                    bytes_read += stream.read(stream.buffer_size()).size();
+                }
+            }
+        };
+
+        // skip where a multi-queue TUN device cannot be created (not root, no /dev/net/tun)
+        unique_ptr<MultiQueueTCPOverIPv4Engine> mq;
+        try {
+            mq = make_unique<MultiQueueTCPOverIPv4Engine>(DEVNAME, N_QUEUES, serve);
+            configure(DEVNAME, "169.254.150.1");
+        } catch (const unix_error &e) {
+            cerr << "cannot set up a multi-queue TUN device (" << e.what() << "); skipping\n";
+            return EXIT_SUCCESS;
+        }
+        ShardedTCPEngine &engine = mq->engine();
+        engine.listen(80, {}, N_CONNECTIONS);
+        engine.start();
+
+        // the kernel picks each SYN's queue by its own hash, so some SYNs arrive on the wrong
+        // shard; every handshake still completes, and every connection's bytes are read
+        const timeval timeout{5, 0};
+        vector<TCPSocket> clients(N_CONNECTIONS);
+        string sent;
+        for (size_t i = 0; i < N_CONNECTIONS; i++) {
+            SystemCall("setsockopt",
+                       ::setsockopt(
+                           clients[i].fd_num(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)));
+            clients[i].connect(Address{"169.254.150.2", 80});
+            const string data = "hello from connection " + to_string(i);
+            clients[i].write(data);
+            sent += data;
+        }
+
+        const auto give_up = chrono::steady_clock::now() + chrono::seconds(5);
+        while (bytes_read < sent.size() and chrono::steady_clock::now() < give_up) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        engine.stop();
+
+        test_should_be(bytes_read.load(), sent.size());
+        test_err_if(engine.forwarded() == 0, "no segment was forwarded between shards");
+        size_t n_accepted = 0;
+        for (const auto &ids : accepted) {
+            test_err_if(ids.empty(), "a shard accepted no connections");
+            n_accepted += ids.size();
+        }
+        test_should_be(n_accepted, N_CONNECTIONS);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include "ethernet_frame.hh"
+#include "packet_builder.hh"
+#include "tcp_over_ip.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // headers go in front of the payload, in place
+        {
+            PacketBuilder packet{64, 8};
+            packet.append("payload");
+            packet.prepend(3)[0] = 'x';
+            test_should_be(packet.size(), size_t{10});
+            test_err_if(packet.str().substr(3) != "payload", "prepend moved the payload");
+
+            bool threw = false;
+            try {
+                packet.prepend(6);
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+        }
+
+        // the allocation is reused once the released packet is gone, and not before
+        {
+            PacketBuilder packet;
+            packet.append("first");
+            const char *first_storage = packet.str().data();
+            Buffer first = packet.release();
+            packet.append("second");
+            test_should_be(packet.str().data() == first_storage, false);
+            test_err_if(first.str() != "first", "released packet was overwritten");
+
+            const char *second_storage = packet.str().data();
+            packet.release();
+            packet.append("third");
+            test_should_be(packet.str().data() == second_storage, true);
+        }
+
+        // a payload too big for the allocation grows it, keeping what was there
+        {
+            PacketBuilder packet;
+            packet.append("abc");
+            packet.append(string(5000, 'd'));
+            packet.prepend(16);
+            test_should_be(packet.size(), size_t{5019});
+            test_err_if(packet.str().substr(16, 4) != "abcd", "growing lost the payload");
+            packet.append(string(60000, 'e'));
+            test_err_if(packet.str().substr(16, 4) != "abcd", "growing past the pool lost it");
+            test_should_be(packet.release().size(), size_t{65019});
+        }
+
+        // each layer serializes just as it does into a BufferList
+        PacketBuilder packet;
+        for (size_t i = 0; i < 200; i++) {
+            TCPSegment seg;
+            seg.header().seqno = WrappingInt32{uint32_t(rd())};
+            seg.header().ackno = WrappingInt32{uint32_t(rd())};
+            seg.header().win = rd();
+            seg.header().ack = true;
+            seg.header().doff = 5 + i % 3;  // with some (zeroed) options
+            string payload(uniform_int_distribution<size_t>{0, 1460}(rd), 0);
+            for (auto &ch : payload) {
+                ch = rd();
+            }
+            if (i % 2) {
+                seg.mutable_payload() = Buffer{move(payload)};
+            } else {
+                seg.set_payload(Buffer{move(payload)});
+            }
+
+            const FourTuple id{uint32_t(rd()), uint32_t(rd()), uint16_t(rd()), uint16_t(rd())};
+            TCPOverIPv4Adapter::wrap_tcp_in_ip(seg, id, packet);
+            const Buffer built = packet.release();
+            InternetDatagram dgram = TCPOverIPv4Adapter::wrap_tcp_in_ip(seg, id);
+            test_err_if(built.str() != dgram.serialize().concatenate(),
+                        "datagram built in place differs");
+
+            // a parsed datagram keeps its checksum, and is copied in whole if the packet is empty
+            InternetDatagram parsed;
+            test_err_if(parsed.parse(built) != ParseResult::NoError, "built datagram is invalid");
+            EthernetFrame frame;
+            frame.header().type = EthernetHeader::TYPE_IPv4;
+            frame.header().src = {0x02, 0, 0, 0, 0, uint8_t(rd())};
+            frame.header().dst = {0x02, 0, 0, 0, 0, uint8_t(rd())};
+            frame.payload() = parsed.serialize();
+            parsed.serialize(packet);
+            frame.serialize(packet);
+            test_err_if(packet.release().str() != frame.serialize().concatenate(),
+                        "frame built in place differs");
+        }
+
+        // wrapping a segment uses the payload sum it was given rather than summing again: with
+        // the sum of some other payload, every wrap carries the checksum that sum makes
+        {
+            TCPSegment seg;
+            InternetChecksum other;
+            other.add("not the payload");
+            seg.set_payload(string("the payload"), other);
+            const FourTuple id{0x0a000001, 0x0a000002, 80, 1024};
+            for (size_t i = 0; i < 2; i++) {
+                const InternetDatagram dgram = TCPOverIPv4Adapter::wrap_tcp_in_ip(seg, id);
+                TCPOverIPv4Adapter::wrap_tcp_in_ip(seg, id, packet);
+                test_err_if(packet.release().str() != dgram.serialize().concatenate(),
+                            "datagram built in place differs");
+                TCPSegment parsed;
+                test_err_if(
+                    parsed.parse(dgram.payload().concatenate(), dgram.header().pseudo_cksum()) !=
+                        ParseResult::BadChecksum,
+                    "wrapping summed the payload again");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
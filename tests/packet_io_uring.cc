@@ -0,0 +1,138 @@
+#include "eventloop.hh"
+#include "io_uring.hh"
+#include "socket.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+UDPSocket bound_socket() {
+    UDPSocket sock;
+    sock.bind(Address{"127.0.0.1", 0});
+    return sock;
+}
+
+//! Receive `count` packets, in order, from `sender`
+void receive_all(UringPacketIO &io, const Address &sender, const size_t first, const size_t count) {
+    EventLoop loop;
+    size_t received = 0;
+    loop.add_rule(io.event_fd(), Direction::In, [&] {
+        while (auto packet = io.receive()) {
+            test_err_if(packet->source != sender, "wrong source address");
+            test_err_if(packet->payload != "packet " + to_string(first + received),
+                        "packets out of order or corrupted");
+            received++;
+        }
+    });
+    while (received < count) {
+        const auto result = loop.wait_next_event(1000);
+        test_err_if(result == EventLoop::Result::Timeout, "timed out");
+        test_err_if(result == EventLoop::Result::Exit, "the wait was interrupted");
+    }
+    test_should_be(received, count);
+}
+
+int main() {
+    try {
+        // skip where io_uring is not available (old kernels, seccomp filters)
+        if (::syscall(__NR_io_uring_setup, 0, nullptr) < 0 and
+            (errno == ENOSYS or errno == EPERM)) {
+            cerr << "io_uring is not available; skipping\n";
+            return EXIT_SUCCESS;
+        }
+
+        UDPSocket a = bound_socket();
+        UDPSocket b = bound_socket();
+        const Address a_address = a.local_address();
+        const Address b_address = b.local_address();
+
+        // many batches of datagrams between two rings, in both directions, for far fewer syscalls
+        {
+            UringPacketIO a_io{a, UringPacketIO::Kind::Socket};
+            UringPacketIO b_io{b, UringPacketIO::Kind::Socket};
+            constexpr size_t batch = 100;
+            constexpr size_t rounds = 20;
+            for (size_t round = 0; round < rounds; round++) {
+                for (size_t i = 0; i < batch; i++) {
+                    a_io.send(string("packet " + to_string(round * batch + i)), b_address);
+                }
+                a_io.flush();
+                receive_all(b_io, a_address, round * batch, batch);
+
+                for (size_t i = 0; i < batch; i++) {
+                    b_io.send(string("packet " + to_string(round * batch + i)), a_address);
+                }
+                b_io.flush();
+                receive_all(a_io, b_address, round * batch, batch);
+            }
+            test_should_be(a_io.packets_sent(), batch * rounds);
+            test_should_be(b_io.packets_received(), batch * rounds);
+            test_err_if(a_io.syscalls() + b_io.syscalls() > batch * rounds / 4,
+                        "expected well under one syscall per packet");
+        }
+
+        // a burst larger than the provided buffers ends the multishot receive, which is re-posted
+        {
+            UringPacketIO b_io{b, UringPacketIO::Kind::Socket, 8, 256};
+            for (size_t i = 0; i < 50; i++) {
+                a.sendto(b_address, "packet " + to_string(i));
+            }
+            receive_all(b_io, a_address, 0, 50);
+        }
+
+        // packets arriving while the EventLoop sleeps: the completion work interrupts its wait
+        {
+            UringPacketIO b_io{b, UringPacketIO::Kind::Socket};
+            thread sender([&] {
+                for (size_t i = 0; i < 20; i++) {
+                    this_thread::sleep_for(chrono::milliseconds(2));
+                    a.sendto(b_address, "packet " + to_string(i));
+                }
+            });
+            try {
+                receive_all(b_io, a_address, 0, 20);
+            } catch (...) {
+                sender.join();
+                throw;
+            }
+            sender.join();
+        }
+
+        // a submission polling thread, where the kernel allows one
+        {
+            unique_ptr<UringPacketIO> b_io;
+            try {
+                b_io = make_unique<UringPacketIO>(b,
+                                                  UringPacketIO::Kind::Socket,
+                                                  UringPacketIO::DEFAULT_DEPTH,
+                                                  UringPacketIO::DEFAULT_BUFFER_SIZE,
+                                                  true);
+            } catch (const unix_error &e) {
+                cerr << "no submission polling thread (" << e.what() << "); skipping\n";
+            }
+            if (b_io) {
+                for (size_t i = 0; i < 20; i++) {
+                    a.sendto(b_address, "packet " + to_string(i));
+                }
+                receive_all(*b_io, a_address, 0, 20);
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
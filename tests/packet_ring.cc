@@ -0,0 +1,123 @@
+#include "buffer.hh"
+#include "packet_ring.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cerrno>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! Raw sockets need CAP_NET_RAW; without it there is nothing to test
+bool can_open_packet_sockets() {
+    const int fd = ::socket(AF_PACKET, SOCK_RAW, 0);
+    if (fd < 0) {
+        return errno != EPERM and errno != EACCES;
+    }
+    ::close(fd);
+    return true;
+}
+
+//! Receive frames for a while, counting the copies of `frame`
+size_t receive_copies(PacketRing &ring, const string &frame) {
+    size_t copies = 0;
+    for (size_t attempt = 0; attempt < 20; attempt++) {
+        while (const auto received = ring.receive()) {
+            if (received->frame.str() == frame) {
+                copies++;
+            }
+        }
+        pollfd pfd{ring.fd_num(), POLLIN, 0};
+        SystemCall("poll", ::poll(&pfd, 1, 10));
+    }
+    return copies;
+}
+
+int main() {
+    try {
+        // a Buffer can view storage it does not own, and keeps it alive
+        {
+            bool released = false;
+            const auto release = [&](const char *) { released = true; };
+            auto storage = shared_ptr<const char>("external storage", release);
+            Buffer whole{storage, 8};
+            storage.reset();
+            test_err_if(whole.str() != "external", "Buffer over external storage wrong");
+            Buffer tail = whole;
+            tail.remove_prefix(2);
+            test_err_if(tail.str() != "ternal", "remove_prefix over external storage wrong");
+            whole = Buffer{};
+            test_should_be(released, false);
+            tail = Buffer{};
+            test_should_be(released, true);
+        }
+
+        if (not can_open_packet_sockets()) {
+            cerr << "skipping: packet sockets need CAP_NET_RAW\n";
+            return EXIT_SUCCESS;
+        }
+
+        PacketRing sender{"lo"};
+        PacketRing receiver{"lo"};
+
+        // broadcast frame with a local experimental EtherType, so nothing on lo answers it
+        string frame(6, char(0xff));
+        frame += string(6, char(0x02));
+        frame += string("\x88\xb5", 2);
+        frame += "CS144 packet ring test frame";
+
+        for (size_t i = 0; i < 3; i++) {
+            test_should_be(sender.send(frame), true);
+        }
+        sender.flush();
+
+        // the frames arrive once each: loopback's outgoing copies are skipped
+        test_should_be(receive_copies(receiver, frame), size_t{3});
+
+        // frames bigger than a transmit slot are an error
+        bool threw = false;
+        try {
+            sender.send(string(PacketRing::FRAME_SIZE, 'x'));
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        test_should_be(threw, true);
+
+        // a received Buffer outlives the ring that received it
+        sender.send(frame);
+        sender.flush();
+        optional<Buffer> kept;
+        {
+            PacketRing late{"lo"};
+            for (size_t attempt = 0; attempt < 100 and not kept.has_value(); attempt++) {
+                pollfd pfd{late.fd_num(), POLLIN, 0};
+                SystemCall("poll", ::poll(&pfd, 1, 10));
+                while (auto received = late.receive()) {
+                    if (received->frame.str() == frame) {
+                        kept = move(received->frame);
+                        break;
+                    }
+                }
+                if (not kept.has_value()) {
+                    sender.send(frame);
+                    sender.flush();
+                }
+            }
+        }
+        test_err_if(not kept.has_value() or kept->str() != frame, "lost frame after ring closed");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+#include "epoch.hh"
+#include "prefix_table.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+uint32_t mask(const uint8_t length) { return length == 0 ? 0 : ~0U << (32 - length); }
+
+//! prefixes by (length, address)
+using Reference = map<pair<uint8_t, uint32_t>, PrefixTable::Value>;
+
+//! The value of the longest prefix that matches, by scanning them all
+optional<PrefixTable::Value> scan(const Reference &prefixes, const uint32_t address) {
+    optional<PrefixTable::Value> ret;
+    for (const auto &[prefix, value] : prefixes) {
+        if (((address ^ prefix.second) & mask(prefix.first)) == 0) {
+            ret = value;  // in order of length, so the last match is the longest
+        }
+    }
+    return ret;
+}
+
+uint32_t random_address(mt19937 &rd) {
+    // half of them in 10/8, where the prefixes are
+    const uint32_t address = rd();
+    return address % 2 ? address : 0x0a000000 | (address & 0x00ffffff);
+}
+
+int main() {
+    try {
+        // the default route, a host route, and the nesting in between
+        {
+            PrefixTable table;
+            test_should_be(table.lookup(0x01020304).has_value(), false);
+            table.insert(0x0a000000, 8, 1);
+            table.insert(0x0a010203, 32, 3);
+            table.insert(0x0a010000, 16, 2);
+            table.insert(0, 0, 0);
+            test_should_be(table.lookup(0x01020304).has_value(), false);  // not published yet
+            table.publish();
+            test_should_be(table.lookup(0x01020304).value(), 0U);
+            test_should_be(table.lookup(0x0a020304).value(), 1U);
+            test_should_be(table.lookup(0x0a010204).value(), 2U);
+            test_should_be(table.lookup(0x0a010203).value(), 3U);
+            test_should_be(table.size(), size_t{4});
+            test_should_be(table.chunks(), size_t{2});
+
+            // bits past the prefix length are ignored, and a prefix can be replaced
+            table.insert(0x0a01ffff, 16, 4);
+            table.publish();
+            test_should_be(table.lookup(0x0a010204).value(), 4U);
+            test_should_be(table.lookup(0x0a010203).value(), 3U);
+            test_should_be(table.size(), size_t{4});
+
+            // an erased prefix's addresses fall back to the next longest prefix
+            test_should_be(table.erase(0x0a010000, 16), true);
+            test_should_be(table.erase(0x0a010000, 16), false);
+            table.publish();
+            test_should_be(table.lookup(0x0a010204).value(), 1U);
+            test_should_be(table.lookup(0x0a010203).value(), 3U);
+            test_should_be(table.erase(0, 0), true);
+            table.publish();
+            test_should_be(table.lookup(0x01020304).has_value(), false);
+        }
+
+        // random prefixes, inserted and erased in random order, agree with a linear scan
+        {
+            mt19937 rd{144};
+            Reference prefixes;
+            PrefixTable table;
+            EpochDomain::Reader reader{table.epochs()};
+            for (size_t i = 0; i < 3000; i++) {
+                // holding old versions for a while makes the table recycle older root arrays
+                if (i == 1000) {
+                    reader.enter();
+                } else if (i == 1500) {
+                    reader.exit();
+                }
+                const uint8_t length = uniform_int_distribution<int>{0, 32}(rd);
+                const uint32_t address = random_address(rd) & mask(length);
+                if (i % 3 == 2 and not prefixes.empty()) {
+                    const auto victim = next(prefixes.begin(), rd() % prefixes.size());
+                    test_should_be(table.erase(victim->first.second, victim->first.first), true);
+                    prefixes.erase(victim);
+                } else {
+                    prefixes[{length, address}] = i;
+                    table.insert(address, length, i);
+                }
+                if (i % 10 == 0) {
+                    table.publish();
+                    const uint32_t probe = random_address(rd);
+                    test_err_if(table.lookup(probe) != scan(prefixes, probe),
+                                "lookup disagrees with linear scan for " + to_string(probe));
+                }
+            }
+            table.publish();
+            test_should_be(table.size(), prefixes.size());
+            for (size_t i = 0; i < 100000; i++) {
+                const uint32_t address = random_address(rd);
+                test_err_if(table.lookup(address) != scan(prefixes, address),
+                            "lookup disagrees with linear scan for " + to_string(address));
+            }
+
+            // a batched lookup finds what one lookup at a time does
+            vector<uint32_t> addresses(1000);
+            for (auto &address : addresses) {
+                address = random_address(rd);
+            }
+            vector<optional<PrefixTable::Value>> values(addresses.size());
+            table.snapshot().lookup(addresses.data(), addresses.size(), values.data());
+            for (size_t i = 0; i < addresses.size(); i++) {
+                test_err_if(values[i] != table.lookup(addresses[i]),
+                            "batched lookup disagrees for " + to_string(addresses[i]));
+            }
+
+            // replace() starts over
+            table.replace({{0x0a000000, 8, 7}});
+            test_should_be(table.size(), size_t{1});
+            test_should_be(table.lookup(0x0a010203).value(), 7U);
+            test_should_be(table.lookup(0x0b010203).has_value(), false);
+            test_should_be(table.chunks(), size_t{0});
+        }
+
+        // a reader's snapshot stays as it was, and its chunks stay allocated, until it exits
+        {
+            PrefixTable table;
+            table.insert(0x0a000000, 24, 1);
+            table.publish();
+            EpochDomain::Reader reader{table.epochs()};
+            size_t chunks_while_reading = 0;
+            {
+                const EpochDomain::Guard guard{reader};
+                const auto old = table.snapshot();
+                table.erase(0x0a000000, 24);
+                table.insert(0x0a000100, 24, 2);
+                table.publish();
+                test_should_be(old.lookup(0x0a000001).value(), 1U);
+                test_should_be(old.lookup(0x0a000101).has_value(), false);
+                test_should_be(table.snapshot().lookup(0x0a000001).has_value(), false);
+                test_should_be(table.snapshot().lookup(0x0a000101).value(), 2U);
+                chunks_while_reading = table.chunks();
+            }
+            table.publish();
+            test_should_be(chunks_while_reading, size_t{2});
+            test_should_be(table.chunks(), size_t{1});
+        }
+
+        // erasing what was inserted gives its chunks back, so churn never runs out of them
+        {
+            PrefixTable table{16};
+            table.insert(0x0a000000, 8, 1);
+            table.insert(0x0a010100, 24, 2);
+            table.publish();
+            const size_t baseline = table.chunks();
+            for (uint32_t i = 0; i < 1000; i++) {
+                const uint32_t host = 0x0a000000 | (i << 8) | (i & 0xff);
+                table.insert(host, 32, 3);
+                table.publish();
+                test_should_be(table.lookup(host).value(), 3U);
+                test_should_be(table.erase(host, 32), true);
+                table.publish();
+                test_should_be(table.lookup(host).value(), host >> 8 == 0x0a0101 ? 2U : 1U);
+                test_should_be(table.chunks(), baseline);
+            }
+            test_should_be(table.erase(0x0a010100, 24), true);
+            table.publish();
+            test_should_be(table.chunks(), size_t{0});
+            test_should_be(table.lookup(0x0a010101).value(), 1U);
+        }
+
+        // a table runs out of chunks at the capacity it was given, and can still be read
+        {
+            PrefixTable table{2};
+            table.insert(0x0a000000, 24, 1);
+            table.insert(0x0a010000, 24, 2);
+            bool threw = false;
+            try {
+                table.insert(0x0a020000, 24, 3);
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+            table.publish();
+            test_should_be(table.lookup(0x0a010001).value(), 2U);
+        }
+
+        // readers on other threads always find a route while the writer churns (and the
+        // versions they hold on to keep thousands of chunks in use)
+        {
+            PrefixTable table{PrefixTable::FULL_TABLE_CHUNKS};
+            table.insert(0, 0, 0);
+            table.publish();
+            atomic<bool> stop{false};
+            atomic<size_t> bad{0};
+            vector<thread> readers;
+            for (size_t i = 0; i < 3; i++) {
+                readers.emplace_back([&, seed = i] {
+                    mt19937 rd(seed);
+                    EpochDomain::Reader reader{table.epochs()};
+                    while (not stop) {
+                        const EpochDomain::Guard guard{reader};
+                        const auto snapshot = table.snapshot();
+                        for (size_t j = 0; j < 64; j++) {
+                            const uint32_t address = random_address(rd);
+                            const auto value = snapshot.lookup(address);
+                            // each prefix's value is its length
+                            if (not value.has_value() or *value > 32 or
+                                snapshot.lookup(address & mask(*value)) < value) {
+                                bad++;
+                            }
+                        }
+                    }
+                });
+            }
+
+            mt19937 rd{2021};
+            vector<pair<uint32_t, uint8_t>> live;
+            for (size_t i = 0; i < 20000; i++) {
+                if (live.size() > 200) {
+                    const size_t victim = rd() % live.size();
+                    table.erase(live[victim].first, live[victim].second);
+                    live[victim] = live.back();
+                    live.pop_back();
+                } else {
+                    const uint8_t length = uniform_int_distribution<int>{8, 32}(rd);
+                    const uint32_t address = random_address(rd) & mask(length);
+                    table.insert(address, length, length);
+                    live.emplace_back(address, length);
+                }
+                table.publish();
+            }
+            stop = true;
+            for (auto &reader : readers) {
+                reader.join();
+            }
+            test_should_be(bad.load(), size_t{0});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -254,7 +254,7 @@ struct SegmentArrives : public ReceiverAction {
 
     TCPSegment build_segment() const {
         TCPSegment seg;
-        seg.payload() = std::string(data);
+        seg.mutable_payload() = std::string(data);
         seg.header().ack = ack;
         seg.header().fin = fin;
         seg.header().syn = syn;
@@ -0,0 +1,143 @@
+#include "epoch.hh"
+#include "ipv4_datagram.hh"
+#include "route_table.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t n_flows = 10'000;
+
+uint32_t gateway_ip(const size_t n) { return 0x0a000002 | static_cast<uint32_t>(n) << 16; }
+
+//! A UDP datagram to somewhere in 8/8, from a random address and port
+InternetDatagram random_flow(mt19937 &rd) {
+    InternetDatagram dgram;
+    dgram.header().proto = IPv4Header::PROTO_UDP;
+    dgram.header().src = rd();
+    dgram.header().dst = 0x08000000 | (rd() & 0x00ffffff);
+    const uint32_t ports = rd();
+    dgram.payload() = string{char(ports >> 24), char(ports >> 16), char(ports >> 8), char(ports)};
+    return dgram;
+}
+
+//! The interface each flow goes out on
+vector<size_t> paths_taken(RouteTable &routes, const vector<InternetDatagram> &flows) {
+    EpochDomain::Reader reader{routes.epochs()};
+    const EpochDomain::Guard guard{reader};
+    const auto table = routes.snapshot();
+    vector<size_t> ret;
+    for (const auto &dgram : flows) {
+        const auto value = table.lookup(dgram.header().dst);
+        test_err_if(not value.has_value(), "no route");
+        const auto &next_hop = routes.next_hop(*value, dgram);
+        test_should_be(next_hop.ip.value(), gateway_ip(next_hop.interface_num));
+        ret.push_back(next_hop.interface_num);
+    }
+    return ret;
+}
+
+vector<RouteTable::Path> paths(const vector<size_t> &interfaces) {
+    vector<RouteTable::Path> ret;
+    for (const size_t n : interfaces) {
+        ret.push_back({Address::from_ipv4_numeric(gateway_ip(n)), n});
+    }
+    return ret;
+}
+
+int main() {
+    try {
+        mt19937 rd{144};
+        vector<InternetDatagram> flows;
+        for (size_t i = 0; i < n_flows; i++) {
+            flows.push_back(random_flow(rd));
+        }
+
+        RouteTable routes;
+        routes.add(0x08000000, 8, Address::from_ipv4_numeric(gateway_ip(0)), 0);
+        for (const size_t n : paths_taken(routes, flows)) {
+            test_should_be(n, size_t{0});
+        }
+
+        // from one path to four: the flows are spread evenly, each always on the same path
+        routes.add_multipath(0x08000000, 8, paths({0, 1, 2, 3}));
+        const auto four = paths_taken(routes, flows);
+        array<size_t, 4> counts{};
+        for (const size_t n : four) {
+            counts.at(n)++;
+        }
+        for (const size_t count : counts) {
+            test_err_if(count < n_flows / 5 or count > n_flows * 3 / 10, "uneven spread");
+        }
+        test_err_if(four != paths_taken(routes, flows), "flows changed paths");
+
+        // one path goes: only its flows move
+        routes.add_multipath(0x08000000, 8, paths({0, 1, 3}));
+        const auto three = paths_taken(routes, flows);
+        for (size_t i = 0; i < n_flows; i++) {
+            test_err_if(three[i] == 2, "flow on a removed path");
+            test_err_if(four[i] != 2 and three[i] != four[i], "flow moved off a remaining path");
+        }
+
+        // a new one comes: only the flows it takes move
+        routes.add_multipath(0x08000000, 8, paths({0, 1, 3, 4}));
+        const auto again = paths_taken(routes, flows);
+        size_t moved = 0;
+        for (size_t i = 0; i < n_flows; i++) {
+            if (again[i] != three[i]) {
+                test_should_be(again[i], size_t{4});
+                moved++;
+            }
+        }
+        test_err_if(moved < n_flows / 5 or moved > n_flows * 3 / 10, "wrong flows moved");
+
+        // a fragment without the ports takes the same path as one without them at all
+        InternetDatagram fragment = flows[0];
+        fragment.header().offset = 1;
+        InternetDatagram portless = flows[0];
+        portless.payload() = string{};
+        {
+            EpochDomain::Reader reader{routes.epochs()};
+            const EpochDomain::Guard guard{reader};
+            const auto value = routes.snapshot().lookup(fragment.header().dst).value();
+            test_should_be(routes.next_hop(value, fragment).interface_num,
+                           routes.next_hop(value, portless).interface_num);
+        }
+
+        // single-path routes are unaffected, and a longer one still wins
+        routes.add(0x08080000, 16, {}, 5);
+        {
+            EpochDomain::Reader reader{routes.epochs()};
+            const EpochDomain::Guard guard{reader};
+            const auto value = routes.snapshot().lookup(0x08080808).value();
+            const auto &next_hop = routes.next_hop(value, flows[0]);
+            test_should_be(next_hop.interface_num, size_t{5});
+            test_should_be(next_hop.ip.has_value(), false);
+        }
+
+        bool threw = false;
+        try {
+            routes.add_multipath(0x09000000, 8, {});
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        test_err_if(not threw, "multipath route with no paths");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "router.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+using namespace std;
+
+EthernetAddress interface_ethernet_address(const size_t n) {
+    return {0x02, 0, 0, 0, 0, static_cast<uint8_t>(n)};
+}
+
+uint32_t interface_ip(const size_t n) { return 0x0a000001 | static_cast<uint32_t>(n) << 16; }
+
+uint32_t gateway_ip(const size_t n) { return 0x0a000002 | static_cast<uint32_t>(n) << 16; }
+
+//! An ARP reply telling interface `n` that `ethernet_address` is its gateway's
+EthernetFrame arp_reply(const size_t n, const EthernetAddress &ethernet_address) {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = ethernet_address;
+    arp.sender_ip_address = gateway_ip(n);
+    arp.target_ethernet_address = interface_ethernet_address(n);
+    arp.target_ip_address = interface_ip(n);
+
+    EthernetFrame frame;
+    frame.header().src = ethernet_address;
+    frame.header().dst = interface_ethernet_address(n);
+    frame.header().type = EthernetHeader::TYPE_ARP;
+    frame.payload() = arp.serialize();
+    return frame;
+}
+
+class Harness {
+    Router _router{};
+
+  public:
+    Harness() {
+        auto *const log = cerr.rdbuf(nullptr);  // interfaces and routes print themselves
+        for (size_t n = 0; n < 3; n++) {
+            _router.add_interface(
+                {interface_ethernet_address(n), Address::from_ipv4_numeric(interface_ip(n))});
+        }
+        _router.add_route(0x08000000, 8, Address::from_ipv4_numeric(gateway_ip(1)), 1);
+        cerr.rdbuf(log);
+    }
+
+    Router &router() { return _router; }
+
+    //! Add a route, without it printing itself
+    void add_route(const uint32_t prefix, const uint8_t length, const size_t interface_num) {
+        auto *const log = cerr.rdbuf(nullptr);
+        _router.add_route(prefix, length, {}, interface_num);
+        cerr.rdbuf(log);
+    }
+
+    //! Forward a datagram to `dst` that arrives on interface 0, and return the frames it
+    //! causes interface `out` to send
+    vector<EthernetFrame> forward(const uint32_t dst, const size_t out = 1) {
+        InternetDatagram dgram;
+        dgram.header().src = 0xc0a80001;
+        dgram.header().dst = dst;
+        dgram.header().ttl = 64;
+        dgram.header().len = IPv4Header::LENGTH;
+        _router.interface(0).datagrams_out().push(dgram);
+        _router.route();
+
+        vector<EthernetFrame> ret;
+        auto &frames = _router.interface(out).frames_out();
+        while (not frames.empty()) {
+            ret.push_back(frames.front());
+            frames.pop();
+        }
+        return ret;
+    }
+
+    //! Forward a datagram to `dst`, checking that it goes to `ethernet_address` and whether it
+    //! hit in the flow cache
+    void expect(const uint32_t dst, const EthernetAddress &ethernet_address, const bool hit) {
+        const size_t hits = _router.flow_cache_hits();
+        const size_t misses = _router.flow_cache_misses();
+        const auto frames = forward(dst);
+        test_should_be(frames.size(), size_t{1});
+        test_should_be(frames[0].header().type, EthernetHeader::TYPE_IPv4);
+        test_err_if(frames[0].header().dst != ethernet_address, "wrong destination");
+        test_err_if(frames[0].header().src != interface_ethernet_address(1), "wrong source");
+        InternetDatagram dgram;
+        test_err_if(dgram.parse(frames[0].payload().concatenate()) != ParseResult::NoError,
+                    "bad datagram");
+        test_should_be(dgram.header().dst, dst);
+        test_should_be(dgram.header().ttl, uint8_t{63});
+        test_should_be(_router.flow_cache_hits(), hits + hit);
+        test_should_be(_router.flow_cache_misses(), misses + not hit);
+    }
+};
+
+int main() {
+    try {
+        const EthernetAddress gateway{0x02, 0, 0, 0, 1, 1};
+        const EthernetAddress moved_gateway{0x02, 0, 0, 0, 1, 2};
+
+        // nothing is cached while the next hop's address is unknown
+        {
+            Harness harness;
+            const auto frames = harness.forward(0x08080808);
+            test_should_be(frames.size(), size_t{1});
+            test_should_be(frames[0].header().type, EthernetHeader::TYPE_ARP);
+            harness.router().interface(1).recv_frame(arp_reply(1, gateway));
+            harness.router().interface(1).frames_out() = {};
+            harness.expect(0x08080808, gateway, false);
+            harness.expect(0x08080808, gateway, true);
+            harness.expect(0x08080808, gateway, true);
+            harness.expect(0x08080404, gateway, false);
+            harness.expect(0x08080404, gateway, true);
+        }
+
+        // a route change makes every entry miss once
+        {
+            Harness harness;
+            harness.router().interface(1).recv_frame(arp_reply(1, gateway));
+            harness.expect(0x08080808, gateway, false);
+            harness.expect(0x08080808, gateway, true);
+            harness.add_route(0x09000000, 8, 2);
+            harness.expect(0x08080808, gateway, false);
+            harness.expect(0x08080808, gateway, true);
+
+            // and the new route is followed, not the cached one
+            harness.add_route(0x08080000, 16, 2);
+            const auto frames = harness.forward(0x08080808, 2);
+            test_should_be(frames.size(), size_t{1});
+            test_should_be(frames[0].header().type, EthernetHeader::TYPE_ARP);
+        }
+
+        // so does a change to the next hop's Ethernet address, or forgetting it
+        {
+            Harness harness;
+            harness.router().interface(1).recv_frame(arp_reply(1, gateway));
+            harness.expect(0x08080808, gateway, false);
+            harness.expect(0x08080808, gateway, true);
+            harness.router().interface(1).recv_frame(arp_reply(1, gateway));  // a refresh
+            harness.expect(0x08080808, gateway, true);
+            harness.router().interface(1).recv_frame(arp_reply(1, moved_gateway));
+            harness.expect(0x08080808, moved_gateway, false);
+            harness.expect(0x08080808, moved_gateway, true);
+
+            harness.router().interface(1).tick(30'001);
+            const auto frames = harness.forward(0x08080808);
+            test_should_be(frames.size(), size_t{1});
+            test_should_be(frames[0].header().type, EthernetHeader::TYPE_ARP);
+        }
+
+        // multipath routes choose by flow, so they are never cached
+        {
+            Harness harness;
+            harness.router().interface(1).recv_frame(arp_reply(1, gateway));
+            harness.router().interface(2).recv_frame(arp_reply(2, gateway));
+            harness.router().add_multipath_route(
+                0x08000000,
+                8,
+                {{Address::from_ipv4_numeric(gateway_ip(1)), 1},
+                 {Address::from_ipv4_numeric(gateway_ip(2)), 2}});
+            for (size_t i = 0; i < 3; i++) {
+                harness.forward(0x08080808);
+                harness.router().interface(2).frames_out() = {};
+            }
+            test_should_be(harness.router().flow_cache_hits(), size_t{0});
+            test_should_be(harness.router().flow_cache_misses(), size_t{3});
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,77 @@
+#include "segment_queue.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+TCPSegment segment(const string &payload) {
+    TCPSegment seg;
+    seg.set_payload(Buffer{string(payload)});
+    return seg;
+}
+
+int main() {
+    try {
+        // first in, first out, and a popped segment lets go of its payload right away
+        {
+            SegmentQueue queue;
+            const Buffer shared{string("shared")};
+            TCPSegment seg;
+            seg.set_payload(shared);
+            queue.push(seg);
+            queue.push(segment("b"));
+            test_should_be(queue.size(), size_t{2});
+            test_err_if(queue.front().payload().copy() != "shared", "wrong front");
+            test_err_if(queue.back().payload().copy() != "b", "wrong back");
+            queue.pop();
+            test_should_be(queue.size(), size_t{1});
+            test_err_if(queue.front().payload().copy() != "b", "wrong front after pop");
+            queue.pop();
+            test_should_be(queue.empty(), true);
+        }
+
+        // drain() takes everything, in order, and the queue is reusable afterwards
+        {
+            SegmentQueue queue;
+            for (size_t round = 0; round < 3; round++) {
+                for (size_t i = 0; i < 10; i++) {
+                    queue.push(segment(to_string(i)));
+                }
+                queue.pop();
+                const auto drained = queue.drain();
+                test_should_be(queue.empty(), true);
+                test_should_be(drained.size(), size_t{9});
+                size_t i = 1;
+                for (auto &seg : drained) {
+                    test_err_if(seg.payload().copy() != to_string(i++), "drained out of order");
+                }
+                test_should_be(queue.drain().empty(), true);
+            }
+        }
+
+        // a queue that never empties still stays in order
+        {
+            SegmentQueue queue;
+            size_t next = 0;
+            for (size_t i = 0; i < 1000; i++) {
+                queue.push(segment(to_string(i)));
+                if (i % 3 != 0) {
+                    test_err_if(queue.front().payload().copy() != to_string(next++),
+                                "long-lived queue out of order");
+                    queue.pop();
+                }
+            }
+            test_should_be(queue.size(), 1000 - next);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -13,6 +13,7 @@
 #include <exception>
 #include <iostream>
 #include <optional>
+#include <queue>
 #include <sstream>
 #include <string>
 
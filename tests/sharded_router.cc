@@ -0,0 +1,189 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface.hh"
+#include "sharded_router.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t n_interfaces = 3;
+
+EthernetAddress interface_ethernet_address(const size_t n) {
+    return {0x02, 0, 0, 0, 0, static_cast<uint8_t>(n)};
+}
+
+uint32_t interface_ip(const size_t n) { return 0x0a000001 | static_cast<uint32_t>(n) << 16; }
+
+const EthernetAddress gateway_ethernet_address{0x02, 0, 0, 0, 1, 2};
+const uint32_t gateway_ip = 0x0a020002;  // on interface 2, the default route's next hop
+const EthernetAddress host_ethernet_address{0x02, 0, 0, 0, 2, 1};
+const uint32_t host_ip = 0x0a010203;  // directly attached to interface 1
+
+//! A frame carrying an IPv4 datagram to `dst`, with `seq` as its payload, to interface `n`
+EthernetFrame datagram_frame(const size_t n, const uint32_t dst, const uint32_t seq) {
+    InternetDatagram dgram;
+    dgram.header().src = 0xc0a80001 + static_cast<uint32_t>(n);
+    dgram.header().dst = dst;
+    dgram.header().ttl = 64;
+    dgram.payload() = to_string(seq);
+    dgram.header().len = IPv4Header::LENGTH + dgram.payload().size();
+
+    EthernetFrame frame;
+    frame.header().src = {0x02, 0, 0, 0, 3, static_cast<uint8_t>(n)};
+    frame.header().dst = interface_ethernet_address(n);
+    frame.header().type = EthernetHeader::TYPE_IPv4;
+    frame.payload() = dgram.serialize().concatenate();
+    return frame;
+}
+
+//! An ARP reply from `ethernet_address`/`ip` to interface `n`
+EthernetFrame arp_reply(const size_t n,
+                        const EthernetAddress &ethernet_address,
+                        const uint32_t ip) {
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REPLY;
+    arp.sender_ethernet_address = ethernet_address;
+    arp.sender_ip_address = ip;
+    arp.target_ethernet_address = interface_ethernet_address(n);
+    arp.target_ip_address = interface_ip(n);
+
+    EthernetFrame frame;
+    frame.header().src = ethernet_address;
+    frame.header().dst = interface_ethernet_address(n);
+    frame.header().type = EthernetHeader::TYPE_ARP;
+    frame.payload() = arp.serialize();
+    return frame;
+}
+
+int main() {
+    try {
+        mutex sent_mutex;
+        array<vector<EthernetFrame>, n_interfaces> sent;
+        ShardedRouter router{[&](const size_t interface_num, ShardedRouter::Frames &frames) {
+            lock_guard<mutex> lock(sent_mutex);
+            for (auto &frame : frames) {
+                sent.at(interface_num).push_back(move(frame));
+            }
+        }};
+
+        auto *const log = cerr.rdbuf(nullptr);  // interfaces and routes print themselves
+        for (size_t n = 0; n < n_interfaces; n++) {
+            router.add_interface(
+                {interface_ethernet_address(n), Address::from_ipv4_numeric(interface_ip(n))});
+        }
+        cerr.rdbuf(log);
+        router.add_route(0x0a010000, 16, {}, 1);
+        router.add_route(0, 0, Address::from_ipv4_numeric(gateway_ip), 2);
+        router.start();
+
+        const auto deliver = [&](const size_t n, EthernetFrame &&frame) {
+            while (not router.deliver(n, move(frame))) {
+                this_thread::yield();
+            }
+        };
+        // wait for interface `n` to have sent `count` frames of type `type`
+        const auto wait_for = [&](const size_t n, const uint16_t type, const size_t count) {
+            const auto give_up = chrono::steady_clock::now() + chrono::seconds(10);
+            while (chrono::steady_clock::now() < give_up) {
+                {
+                    lock_guard<mutex> lock(sent_mutex);
+                    if (count_if(sent.at(n).begin(), sent.at(n).end(), [&](const auto &frame) {
+                            return frame.header().type == type;
+                        }) >= ptrdiff_t(count)) {
+                        return;
+                    }
+                }
+                this_thread::yield();
+            }
+        };
+
+        // the egress interface's worker asks for the next hop's Ethernet address, and sends
+        // the datagram once it has the answer
+        deliver(0, datagram_frame(0, host_ip, 0));
+        wait_for(1, EthernetHeader::TYPE_ARP, 1);
+        {
+            lock_guard<mutex> lock(sent_mutex);
+            test_should_be(sent[1].size(), size_t{1});
+            test_should_be(sent[1][0].header().type, EthernetHeader::TYPE_ARP);
+            test_err_if(sent[1][0].header().dst != ETHERNET_BROADCAST, "request not broadcast");
+        }
+        deliver(1, arp_reply(1, host_ethernet_address, host_ip));
+        wait_for(1, EthernetHeader::TYPE_IPv4, 1);
+        {
+            lock_guard<mutex> lock(sent_mutex);
+            test_should_be(sent[1].size(), size_t{2});
+            test_should_be(sent[1][1].header().type, EthernetHeader::TYPE_IPv4);
+            test_err_if(sent[1][1].header().dst != host_ethernet_address, "wrong destination");
+            InternetDatagram dgram;
+            test_err_if(dgram.parse(sent[1][1].payload().concatenate()) != ParseResult::NoError,
+                        "bad datagram");
+            test_should_be(dgram.header().ttl, uint8_t{63});
+            test_should_be(dgram.header().dst, host_ip);
+        }
+
+        // datagrams from two interfaces converge on a third, each stream in order (the ARP
+        // reply may reach the third interface's worker after the first datagrams do, in which
+        // case it asks for the address too)
+        deliver(2, arp_reply(2, gateway_ethernet_address, gateway_ip));
+        constexpr uint32_t count = 5000;  // more than a ring holds, so senders may stall
+        thread second_sender([&] {
+            for (uint32_t seq = 0; seq < count; seq++) {
+                deliver(1, datagram_frame(1, 0x08080000 + seq, seq));
+            }
+        });
+        for (uint32_t seq = 0; seq < count; seq++) {
+            deliver(0, datagram_frame(0, 0x08080000 + seq, seq));
+        }
+        second_sender.join();
+        wait_for(2, EthernetHeader::TYPE_IPv4, 2 * count);
+        router.stop();
+
+        array<uint32_t, n_interfaces> next_seq{};
+        for (const auto &frame : sent[2]) {
+            if (frame.header().type == EthernetHeader::TYPE_ARP) {
+                continue;
+            }
+            test_err_if(frame.header().dst != gateway_ethernet_address, "wrong destination");
+            InternetDatagram dgram;
+            test_err_if(dgram.parse(frame.payload().concatenate()) != ParseResult::NoError,
+                        "bad datagram");
+            const size_t from = dgram.header().src - 0xc0a80001;
+            const uint32_t seq = stoul(string(Buffer(dgram.payload()).str()));
+            test_should_be(seq, next_seq.at(from));
+            test_should_be(dgram.header().dst, 0x08080000 + seq);
+            next_seq.at(from)++;
+        }
+        test_should_be(next_seq[0], count);
+        test_should_be(next_seq[1], count);
+
+        // the workers can be started again, and still wake up for new frames
+        router.start();
+        deliver(0, datagram_frame(0, host_ip, 1));
+        wait_for(1, EthernetHeader::TYPE_IPv4, 2);
+        router.stop();
+        test_should_be(sent[1].size(), size_t{3});
+        test_should_be(sent[1][2].header().type, EthernetHeader::TYPE_IPv4);
+        test_err_if(sent[1][2].header().dst != host_ethernet_address, "wrong destination");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#include "flow_hash.hh"
+#include "sharded_tcp_engine.hh"
+#include "spsc_ring.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        // verification suite from Microsoft's RSS specification (IPv4 with TCP ports)
+        struct Vector {
+            const char *dst_ip;
+            uint16_t dst_port;
+            const char *src_ip;
+            uint16_t src_port;
+            uint32_t hash;
+        };
+        const vector<Vector> vectors = {
+            {"161.142.100.80", 1766, "66.9.149.187", 2794, 0x51ccc178},
+            {"65.69.140.83", 4739, "199.92.111.2", 14230, 0xc626b0ea},
+            {"12.22.207.184", 38024, "24.19.198.95", 12898, 0x5c2b394a},
+            {"209.142.163.6", 2217, "38.27.205.30", 48228, 0xafc7327f},
+            {"202.188.127.2", 1303, "153.39.163.191", 44251, 0x10e828a2},
+        };
+        const ToeplitzHash toeplitz;
+        for (const auto &v : vectors) {
+            const auto id = FourTuple::from_addresses(Address{v.dst_ip, v.dst_port},
+                                                      Address{v.src_ip, v.src_port});
+            test_should_be(toeplitz(id), v.hash);
+        }
+
+        // the ring preserves order across threads, including when it fills up
+        SPSCRing<uint64_t> ring{64};
+        constexpr uint64_t count = 200000;
+        thread producer([&] {
+            for (uint64_t i = 0; i < count; i++) {
+                while (not ring.push(uint64_t{i})) {
+                    this_thread::yield();
+                }
+            }
+        });
+        for (uint64_t expected = 0; expected < count;) {
+            uint64_t value = 0;
+            if (ring.pop(value)) {
+                test_should_be(value, expected);
+                expected++;
+            } else {
+                this_thread::yield();
+            }
+        }
+        producer.join();
+        test_should_be(ring.empty(), true);
+
+        // every shard gets a share of the flows
+        ShardedTCPEngine engine{4, [](const size_t, ShardedTCPEngine::Batch &) {}};
+        vector<size_t> per_shard(engine.size());
+        for (uint16_t port = 1024; port < 5120; port++) {
+            per_shard.at(engine.shard_of({0x0a000001, 0x0a000002, 80, port}))++;
+        }
+        for (const auto n : per_shard) {
+            test_err_if(n < 512, "flows are not spread across shards");
+        }
+
+        // a segment read by one shard is forwarded to the shard that owns its connection
+        mutex replies_mutex;
+        vector<pair<size_t, TCPSegment>> replies;
+        ShardedTCPEngine watching{2, [&](const size_t shard, ShardedTCPEngine::Batch &batch) {
+                                      lock_guard<mutex> lock(replies_mutex);
+                                      for (auto &[id, seg] : batch) {
+                                          replies.emplace_back(shard, move(seg));
+                                      }
+                                  }};
+        watching.listen(80);
+
+        FourTuple id{0x0a000001, 0x0a000002, 80, 1024};
+        while (watching.shard_of(id) != 1) {
+            id.remote_port++;
+        }
+        TCPSegment syn;
+        syn.header().syn = true;
+        syn.header().seqno = WrappingInt32{1234};
+
+        FileDescriptor doorbell{SystemCall("eventfd", ::eventfd(0, EFD_NONBLOCK))};
+        bool forwarded = false;
+        watching.watch(0, doorbell, [&] {
+            doorbell.read(sizeof(uint64_t));
+            forwarded = watching.receive_on(0, id, move(syn));
+        });
+        watching.start();
+        const uint64_t one = 1;
+        SystemCall("write", ::write(doorbell.fd_num(), &one, sizeof(one)));
+
+        const auto give_up = chrono::steady_clock::now() + chrono::seconds(5);
+        const auto replied = [&] {
+            lock_guard<mutex> lock(replies_mutex);
+            return not replies.empty();
+        };
+        while (not replied() and chrono::steady_clock::now() < give_up) {
+            this_thread::yield();
+        }
+        watching.stop();
+        test_should_be(forwarded, true);
+        test_should_be(replies.size(), size_t{1});
+        test_should_be(replies.front().first, size_t{1});
+        test_should_be(replies.front().second.header().syn, true);
+        test_should_be(replies.front().second.header().ack, true);
+
+        // the shards can be started again, and still wake up when rung
+        atomic<bool> ran{false};
+        watching.start();
+        test_should_be(watching.run_on(1, [&](TCPEngine &) { ran = true; }), true);
+        const auto give_up_again = chrono::steady_clock::now() + chrono::seconds(5);
+        while (not ran and chrono::steady_clock::now() < give_up_again) {
+            this_thread::yield();
+        }
+        watching.stop();
+        test_should_be(ran.load(), true);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
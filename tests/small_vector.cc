@@ -0,0 +1,86 @@
+#include "buffer.hh"
+#include "small_vector.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+int main() {
+    try {
+        // a queue that never holds more than N elements stays inline, however long it runs
+        {
+            SmallVector<size_t, 4> queue;
+            for (size_t i = 0; i < 1000; i++) {
+                queue.push_back(i);
+                if (queue.size() == 4) {
+                    test_should_be(queue.front(), i - 3);
+                    queue.pop_front();
+                }
+            }
+            test_should_be(queue.size(), size_t{3});
+            test_should_be(queue.back(), size_t{999});
+            test_should_be(queue.data()[0], size_t{997});
+        }
+
+        // more than N elements spill to the heap, in order, and still drain from the front
+        {
+            SmallVector<string, 2> strings;
+            for (size_t i = 0; i < 10; i++) {
+                strings.push_back(to_string(i));
+            }
+            test_should_be(strings.size(), size_t{10});
+            for (size_t i = 0; i < 10; i++) {
+                test_err_if(strings.front() != to_string(i), "spilled elements out of order");
+                strings.pop_front();
+            }
+            test_should_be(strings.empty(), true);
+            strings.push_back("again");
+            test_err_if(strings[0] != "again", "reuse after draining wrong");
+
+            SmallVector<string, 2> moved = move(strings);
+            test_should_be(strings.size(), size_t{0});
+            test_err_if(moved.front() != "again", "move lost the element");
+        }
+
+        // BufferList keeps its size across appends and removals, inline or not
+        {
+            BufferList list;
+            string expected;
+            for (size_t i = 0; i < 2 * BufferList::INLINE_BUFFERS + 1; i++) {
+                list.append(string(i + 1, char('a' + i)));
+                expected.append(string(i + 1, char('a' + i)));
+            }
+            test_should_be(list.size(), expected.size());
+            list.remove_prefix(4);
+            expected.erase(0, 4);
+            test_should_be(list.size(), expected.size());
+            test_err_if(list.concatenate() != expected, "BufferList contents wrong");
+
+            BufferViewList views{list};
+            views.remove_prefix(7);
+            expected.erase(0, 7);
+            test_should_be(views.size(), expected.size());
+            string gathered;
+            for (const auto &iov : views.as_iovecs()) {
+                gathered.append(static_cast<const char *>(iov.iov_base), iov.iov_len);
+            }
+            test_err_if(gathered != expected, "iovecs wrong");
+
+            BufferList taken;
+            taken.append(move(list));
+            test_should_be(list.size(), size_t{0});
+            test_should_be(taken.size(), expected.size() + 7);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
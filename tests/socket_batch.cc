@@ -0,0 +1,87 @@
+#include "socket.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+UDPSocket bound_socket() {
+    UDPSocket sock;
+    sock.bind(Address{"127.0.0.1", 0});
+    return sock;
+}
+
+void wait_readable(const UDPSocket &sock) {
+    pollfd pfd{sock.fd_num(), POLLIN, 0};
+    test_should_be(SystemCall("poll", ::poll(&pfd, 1, 1000)), 1);
+}
+
+int main() {
+    try {
+        UDPSocket a = bound_socket();
+        UDPSocket b = bound_socket();
+        const Address a_address = a.local_address();
+        const Address b_address = b.local_address();
+
+        // nothing waiting: an empty batch, without blocking
+        vector<UDPSocket::received_datagram> received;
+        UDPSocket::batch_storage storage{16};
+        test_should_be(b.recv_batch(received, storage), size_t{0});
+
+        // payloads made of several buffers each, sent with one call and received in batches
+        vector<BufferList> payloads;
+        for (size_t i = 0; i < 200; i++) {
+            BufferList payload{string("header ")};
+            payload.append(BufferList{"datagram " + to_string(i)});
+            payloads.push_back(move(payload));
+        }
+        a.send_batch(b_address, {payloads.begin(), payloads.end()});
+
+        while (received.size() < payloads.size()) {
+            wait_readable(b);
+            const size_t n = b.recv_batch(received, storage);
+            test_err_if(n == 0 or n > 16, "bad batch size");
+        }
+        test_should_be(received.size(), payloads.size());
+        for (size_t i = 0; i < received.size(); i++) {
+            test_err_if(received[i].source_address != a_address, "wrong source address");
+            test_err_if(received[i].payload != "header datagram " + to_string(i),
+                        "datagrams out of order or corrupted");
+        }
+
+        // connected sockets can send batches without an address
+        a.connect(b_address);
+        a.send_batch({string("one"), string("two")});
+        received.clear();
+        while (received.size() < 2) {
+            wait_readable(b);
+            b.recv_batch(received, storage);
+        }
+        test_err_if(received[0].payload != "one" or received[1].payload != "two",
+                    "connected batch corrupted");
+
+        // a datagram larger than the mtu is dropped and counted, and the rest still arrive
+        a.send_batch({string("before"), string(3072, 'x'), string("after")});
+        received.clear();
+        while (received.size() < 2) {
+            wait_readable(b);
+            b.recv_batch(received, storage);
+        }
+        test_should_be(received.size(), size_t{2});
+        test_err_if(received[0].payload != "before" or received[1].payload != "after",
+                    "datagrams around an oversized one corrupted");
+        test_should_be(storage.truncated(), size_t{1});
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,114 @@
+#include "buffer.hh"
+#include "socket.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+UDPSocket bound_socket() {
+    UDPSocket sock;
+    sock.bind(Address{"127.0.0.1", 0});
+    return sock;
+}
+
+void wait_readable(const UDPSocket &sock) {
+    pollfd pfd{sock.fd_num(), POLLIN, 0};
+    test_should_be(SystemCall("poll", ::poll(&pfd, 1, 1000)), 1);
+}
+
+//! Receive until `count` payloads have arrived, however the kernel grouped them
+vector<Buffer> receive_all(UDPSocket &sock, const Address &expected_source, const size_t count) {
+    vector<Buffer> payloads;
+    UDPSocket::received_segments segments{{nullptr, 0}, {}};
+    while (payloads.size() < count) {
+        sock.recv_segments(segments);
+        if (segments.payloads.empty()) {
+            wait_readable(sock);
+            continue;
+        }
+        test_err_if(segments.source_address != expected_source, "wrong source address");
+        payloads.insert(payloads.end(), segments.payloads.begin(), segments.payloads.end());
+    }
+    test_should_be(payloads.size(), count);
+    return payloads;
+}
+
+int main() {
+    try {
+        // pieces of one Buffer share its storage
+        {
+            const Buffer whole{string("abcdefghij")};
+            Buffer middle = whole;
+            middle.remove_prefix(3);
+            middle.remove_suffix(4);
+            test_err_if(middle.str() != "def", "remove_suffix wrong");
+            test_err_if(middle.copy() != "def", "copy of trimmed Buffer wrong");
+            test_err_if(whole.str() != "abcdefghij", "remove_suffix changed a copy");
+            test_should_be(middle.size(), size_t{3});
+            middle.remove_suffix(3);
+            test_should_be(middle.size(), size_t{0});
+        }
+
+        UDPSocket a = bound_socket();
+        UDPSocket b = bound_socket();
+        b.set_gro(true);
+        const Address a_address = a.local_address();
+        const Address b_address = b.local_address();
+
+        // nothing waiting: no payloads, without blocking
+        UDPSocket::received_segments segments{{nullptr, 0}, {}};
+        b.recv_segments(segments);
+        test_should_be(segments.payloads.size(), size_t{0});
+
+        // and another empty poll, or a receive whose payloads are all gone, reuses the storage
+        const char *const storage = segments.storage.data;
+        b.recv_segments(segments);
+        test_err_if(segments.storage.data != storage, "empty poll allocated");
+        a.send_segmented(b_address, {string("reused")});
+        wait_readable(b);
+        b.recv_segments(segments);
+        test_err_if(segments.payloads.at(0).str() != "reused", "datagram corrupted");
+        test_err_if(segments.storage.data != storage, "receive allocated");
+        b.recv_segments(segments);
+        test_err_if(segments.storage.data != storage, "storage not reused after payloads gone");
+
+        // runs of equal-sized payloads, ending with a short one, then a change of size
+        vector<string> sent;
+        for (size_t i = 0; i < 150; i++) {
+            const size_t size = i < 100 ? 500 : (i == 100 ? 123 : 700);
+            sent.push_back(string(size, char('a' + i % 26)));
+        }
+        a.send_segmented(b_address, {sent.begin(), sent.end()});
+
+        const auto received = receive_all(b, a_address, sent.size());
+        for (size_t i = 0; i < sent.size(); i++) {
+            test_err_if(received[i].str() != sent[i], "segments out of order or corrupted");
+        }
+
+        // a lone datagram is sent without segmentation
+        a.send_segmented(b_address, {string("solo")});
+        test_err_if(receive_all(b, a_address, 1).front().str() != "solo",
+                    "lone datagram corrupted");
+
+        // without GRO, each datagram still arrives alone
+        UDPSocket c = bound_socket();
+        a.send_segmented(c.local_address(), {sent.begin(), sent.begin() + 10});
+        const auto separate = receive_all(c, a_address, 10);
+        for (size_t i = 0; i < separate.size(); i++) {
+            test_err_if(separate[i].str() != sent[i], "segments without GRO corrupted");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+#include "tcp_engine.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static constexpr uint32_t CLIENT_IP = 0x0a000001;
+static constexpr uint32_t SERVER_IP = 0x0a000002;
+static constexpr uint16_t SERVER_PORT = 80;
+static constexpr uint16_t N_CONNECTIONS = 300;
+
+static FourTuple reversed(const FourTuple &id) {
+    return {id.remote_ip, id.local_ip, id.remote_port, id.local_port};
+}
+
+// deliver everything queued on `from` to `to`; returns the number of segments moved
+static size_t deliver(TCPEngine &from, TCPEngine &to) {
+    size_t count = 0;
+    auto &segs = from.segments_out();
+    while (not segs.empty()) {
+        auto [id, seg] = move(segs.front());
+        segs.pop();
+        to.segment_received(reversed(id), seg);
+        ++count;
+    }
+    return count;
+}
+
+static void exchange(TCPEngine &a, TCPEngine &b) {
+    while (deliver(a, b) + deliver(b, a) > 0) {
+    }
+}
+
+int main() {
+    try {
+        TCPEngine client, server;
+        server.listen(SERVER_PORT);
+
+        // connect in batches, accepting as we go so the server's backlog never fills up
+        vector<FourTuple> ids, accepted;
+        for (uint16_t i = 0; i < N_CONNECTIONS; i++) {
+            ids.push_back({CLIENT_IP, SERVER_IP, uint16_t(10000 + i), SERVER_PORT});
+            client.connect(ids.back());
+            if (i % 8 == 7 or i + 1 == N_CONNECTIONS) {
+                exchange(client, server);
+                while (auto id = server.accept(SERVER_PORT)) {
+                    accepted.push_back(id.value());
+                }
+            }
+        }
+        test_should_be(accepted.size(), size_t(N_CONNECTIONS));
+        test_should_be(server.size(), size_t(N_CONNECTIONS));
+
+        // a segment for a port nobody is listening on is dropped
+        TCPSegment stray;
+        stray.header().syn = true;
+        server.segment_received({SERVER_IP, CLIENT_IP, 81, 9999}, stray);
+        test_should_be(server.segments_out().empty(), true);
+
+        // once the backlog is full, further SYNs are dropped
+        for (uint16_t i = 0; i < 20; i++) {
+            client.connect({CLIENT_IP, SERVER_IP, uint16_t(20000 + i), SERVER_PORT});
+        }
+        exchange(client, server);
+        test_should_be(server.size(), size_t(N_CONNECTIONS + 16));
+        for (uint16_t i = 0; i < 20; i++) {
+            client.close({CLIENT_IP, SERVER_IP, uint16_t(20000 + i), SERVER_PORT});
+        }
+        exchange(client, server);
+        while (auto id = server.accept(SERVER_PORT)) {
+            server.close(id.value());
+        }
+        exchange(client, server);
+
+        // each client says hello on its own connection
+        for (const auto &id : ids) {
+            client.write(id, "hello from " + to_string(id.local_port));
+        }
+        exchange(client, server);
+        for (const auto &id : accepted) {
+            auto &inbound = server.connection(id).inbound_stream();
+            const string expected = "hello from " + to_string(id.remote_port);
+            test_err_if(inbound.read(inbound.buffer_size()) != expected,
+                        "wrong data on connection from port " + to_string(id.remote_port));
+        }
+
+        // both sides close; after lingering, both tables are empty
+        for (const auto &id : ids) {
+            client.close(id);
+        }
+        exchange(client, server);
+        for (const auto &id : accepted) {
+            server.close(id);
+        }
+        exchange(client, server);
+        // (the clients whose SYNs were dropped retransmit them and get accepted late)
+        for (unsigned i = 0; i < 100 and client.size() + server.size() > 0; i++) {
+            client.tick(1000);
+            server.tick(1000);
+            exchange(client, server);
+            while (auto id = server.accept(SERVER_PORT)) {
+                server.close(id.value());
+            }
+            exchange(client, server);
+        }
+        test_should_be(client.size(), size_t(0));
+        test_should_be(server.size(), size_t(0));
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -464,7 +464,7 @@ struct SendSegment : public TCPAction {
 
     TCPSegment get_segment() const {
         TCPSegment data_seg;
-        data_seg.payload() = std::string(data);
+        data_seg.mutable_payload() = std::string(data);
         auto &data_hdr = data_seg.header();
         data_hdr.ack = ack;
         data_hdr.rst = rst;
@@ -0,0 +1,80 @@
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "timing_wheel.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+
+        // schedule and cancel at random, with delays spanning every level of the wheel,
+        // and check each timer fires on exactly its millisecond
+        TimingWheel<uint64_t> wheel{12345};
+        map<uint64_t, uint64_t> expiry_of;  // timer id -> expiry, for timers still pending
+        map<uint64_t, TimingWheel<uint64_t>::Handle> handle_of;
+        uint64_t next_id = 0;
+        uint64_t now = wheel.now();
+        size_t fired = 0;
+
+        const auto on_expire = [&](const uint64_t &id) {
+            const auto it = expiry_of.find(id);
+            test_err_if(it == expiry_of.end(), "a cancelled or unknown timer fired");
+            test_should_be(wheel.now(), it->second);
+            expiry_of.erase(it);
+            handle_of.erase(id);
+            fired++;
+        };
+
+        for (size_t round = 0; round < 20000; round++) {
+            const auto action = uniform_int_distribution<unsigned>{0, 9}(rd);
+            if (action < 5) {
+                const unsigned shift = uniform_int_distribution<unsigned>{0, 25}(rd);
+                const uint64_t delay = 1 + uniform_int_distribution<uint64_t>{0, 1ULL << shift}(rd);
+                expiry_of[next_id] = now + delay;
+                handle_of[next_id] = wheel.schedule(now + delay, next_id);
+                next_id++;
+            } else if (action < 7 and not handle_of.empty()) {
+                auto it = handle_of.begin();
+                advance(it, uniform_int_distribution<size_t>{0, handle_of.size() - 1}(rd));
+                wheel.cancel(it->second);
+                expiry_of.erase(it->first);
+                handle_of.erase(it);
+            } else {
+                now += uniform_int_distribution<uint64_t>{0, 5000}(rd);
+                wheel.advance(now, on_expire);
+                for (const auto &[id, expiry] : expiry_of) {
+                    test_err_if(expiry <= now, "a timer did not fire when due");
+                }
+            }
+            test_should_be(wheel.size(), expiry_of.size());
+
+            const auto next = wheel.next_expiry();
+            test_should_be(next.has_value(), not expiry_of.empty());
+            for (const auto &[id, expiry] : expiry_of) {
+                test_err_if(expiry < next.value(), "next_expiry() is later than a pending timer");
+            }
+        }
+
+        // drain everything that is left
+        now += uint64_t{1} << 32;
+        wheel.advance(now, on_expire);
+        test_should_be(wheel.size(), size_t{0});
+        test_should_be(expiry_of.empty(), true);
+        test_err_if(fired == 0, "no timers fired");
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "tcp_config.hh"
+#include "tcp_header.hh"
+#include "tcp_segment.hh"
+#include "test_err_if.hh"
+#include "test_should_be.hh"
+#include "tuntap_adapter.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+using Adapter = TCPOverIPv4OverTunOffloadAdapter;
+
+//! A data segment at `seqno` with `size` bytes of payload
+TCPSegment segment(const uint32_t seqno, const size_t size) {
+    TCPSegment seg;
+    seg.header().seqno = WrappingInt32{seqno};
+    seg.header().ack = true;
+    seg.set_payload(string(size, 'x'));
+    return seg;
+}
+
+//! `count` back-to-back segments of `size` bytes, starting at `seqno`
+vector<TCPSegment> run(const uint32_t seqno, const size_t size, const size_t count) {
+    vector<TCPSegment> ret;
+    for (size_t i = 0; i < count; i++) {
+        ret.push_back(segment(seqno + i * size, size));
+    }
+    return ret;
+}
+
+//! A frame split into its virtio-net header, IPv4 header, and TCP header and payload
+struct Frame {
+    VirtioNetHeader vnet{};
+    IPv4Header ip{};
+    TCPHeader tcp{};
+    size_t payload_size{};
+};
+
+Frame parse_frame(const BufferList &frame) {
+    Frame ret;
+    string bytes = frame.concatenate();
+    test_err_if(bytes.size() < sizeof(ret.vnet), "frame shorter than its virtio-net header");
+    memcpy(&ret.vnet, bytes.data(), sizeof(ret.vnet));
+
+    NetParser p{Buffer{bytes.substr(sizeof(ret.vnet))}};
+    test_err_if(ret.ip.parse(p) != ParseResult::NoError, "bad IPv4 header");
+    test_err_if(ret.tcp.parse(p) != ParseResult::NoError, "bad TCP header");
+    ret.payload_size = p.buffer().size();
+    return ret;
+}
+
+int main() {
+    try {
+        FdAdapterConfig config{};
+        config.source = {"10.0.0.1", 1234};
+        config.destination = {"10.0.0.2", 80};
+
+        // a run takes a short tail segment as its last, and nothing after it
+        {
+            auto segments = run(1000, 1000, 3);
+            segments.push_back(segment(4000, 400));
+            segments.push_back(segment(4400, 1000));
+            test_should_be(Adapter::run_end(segments, 0), size_t{4});
+            test_should_be(Adapter::run_end(segments, 4), size_t{5});
+
+            // ... and the frame's header fields describe the whole run
+            const Frame frame = parse_frame(Adapter::run_frame(segments, 0, 4, config));
+            test_should_be(frame.vnet.flags, VirtioNetHeader::F_NEEDS_CSUM);
+            test_should_be(frame.vnet.gso_type, VirtioNetHeader::GSO_TCPV4);
+            test_should_be(frame.vnet.gso_size, uint16_t{1000});
+            test_should_be(frame.vnet.hdr_len, uint16_t{IPv4Header::LENGTH + TCPHeader::LENGTH});
+            test_should_be(frame.vnet.csum_start, uint16_t{IPv4Header::LENGTH});
+            test_should_be(frame.vnet.csum_offset, uint16_t{16});
+            test_should_be(frame.ip.len, uint16_t{IPv4Header::LENGTH + TCPHeader::LENGTH + 3400});
+            test_should_be(frame.ip.src, config.source.ipv4_numeric());
+            test_should_be(frame.ip.dst, config.destination.ipv4_numeric());
+            test_should_be(frame.tcp.seqno, WrappingInt32{1000});
+            test_should_be(frame.payload_size, size_t{3400});
+        }
+
+        // a single segment goes out as it is, with only the checksum left to the kernel
+        {
+            const auto segments = run(1000, 1000, 1);
+            const Frame frame = parse_frame(Adapter::run_frame(segments, 0, 1, config));
+            test_should_be(frame.vnet.flags, VirtioNetHeader::F_NEEDS_CSUM);
+            test_should_be(frame.vnet.gso_type, uint8_t{0});
+            test_should_be(frame.vnet.gso_size, uint16_t{0});
+            test_should_be(frame.vnet.hdr_len, uint16_t{0});
+            test_should_be(frame.payload_size, size_t{1000});
+        }
+
+        // a FIN ends the run, and FIN and PSH come from the run's last segment only
+        {
+            auto segments = run(1000, 1000, 4);
+            segments[0].header().psh = true;
+            segments[1].header().psh = true;
+            segments[2].header().fin = true;
+            test_should_be(Adapter::run_end(segments, 0), size_t{3});
+            test_should_be(Adapter::run_end(segments, 3), size_t{4});
+
+            const Frame frame = parse_frame(Adapter::run_frame(segments, 0, 3, config));
+            test_should_be(frame.tcp.fin, true);
+            test_should_be(frame.tcp.psh, false);
+            test_should_be(frame.tcp.seqno, WrappingInt32{1000});
+
+            segments[2].header().psh = true;
+            test_should_be(parse_frame(Adapter::run_frame(segments, 0, 3, config)).tcp.psh, true);
+        }
+
+        // a gap in sequence space splits the run
+        {
+            auto segments = run(1000, 1000, 3);
+            segments[2].header().seqno = segments[2].header().seqno + 1;
+            test_should_be(Adapter::run_end(segments, 0), size_t{2});
+            test_should_be(Adapter::run_end(segments, 2), size_t{3});
+        }
+
+        // so does a different header length, since the kernel copies one header into every piece
+        {
+            auto segments = run(1000, 1000, 3);
+            segments[1].header().doff = 6;
+            test_should_be(Adapter::run_end(segments, 0), size_t{1});
+            test_should_be(Adapter::run_end(segments, 1), size_t{2});
+        }
+
+        // and SYN, RST and URG segments go out alone
+        {
+            auto segments = run(1000, 1000, 3);
+            segments[1].header().urg = true;
+            test_should_be(Adapter::run_end(segments, 0), size_t{1});
+            test_should_be(Adapter::run_end(segments, 1), size_t{2});
+        }
+
+        // a frame holds as many segments as fit in MAX_DATAGRAM, and no more
+        {
+            constexpr size_t mss = 1460;
+            constexpr size_t per_frame =
+                (Adapter::MAX_DATAGRAM - IPv4Header::LENGTH - TCPHeader::LENGTH) / mss;
+            const auto segments = run(1000, mss, per_frame + 5);
+            test_should_be(Adapter::run_end(segments, 0), per_frame);
+            test_should_be(Adapter::run_end(segments, per_frame), per_frame + 5);
+
+            const Frame frame = parse_frame(Adapter::run_frame(segments, 0, per_frame, config));
+            test_should_be(size_t{frame.ip.len},
+                           IPv4Header::LENGTH + TCPHeader::LENGTH + per_frame * mss);
+            test_err_if(frame.ip.len + mss <= Adapter::MAX_DATAGRAM,
+                        "the frame had room for another segment");
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}